@@ -0,0 +1,167 @@
+// Copyright (C) 2021 lmc
+// 
+// This file is part of VideoEditor.
+// 
+// VideoEditor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+// 
+// VideoEditor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with VideoEditor.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "Test.h"
+#include <math.h>
+#include <vector>
+#include <VideoEditor/DecodePlan.hpp>
+#include <VideoEditor/Util.hpp>
+
+using namespace ks;
+
+namespace
+{
+	MediaTime gridTime(const double seconds)
+	{
+		return MediaTime(static_cast<int>(lround(seconds * 600.0)), 600);
+	}
+
+	MediaTimeMapping makeMapping(const double sourceStart, const double sourceEnd, const double targetStart, const double targetEnd)
+	{
+		return MediaTimeMapping(MediaTimeRange(gridTime(sourceStart), gridTime(sourceEnd)), MediaTimeRange(gridTime(targetStart), gridTime(targetEnd)));
+	}
+
+	// Display times of a source at sourceFps, in composition time and rounded to 1/600 like decoded frames.
+	std::vector<MediaTime> displayTimes(const MediaTimeMapping& mapping, const double sourceFps)
+	{
+		std::vector<MediaTime> times;
+		const double speed = mapping.source.duration().seconds() / mapping.target.duration().seconds();
+		for (int i = 0; i / sourceFps < mapping.source.duration().seconds(); i++)
+		{
+			times.push_back(gridTime(mapping.target.start.seconds() + i / sourceFps / speed));
+		}
+		return times;
+	}
+
+	std::vector<bool> shownFrames(const DecodePlan& plan, const std::vector<MediaTime>& times)
+	{
+		std::vector<bool> shown;
+		for (size_t i = 0; i < times.size(); i++)
+		{
+			shown.push_back(i + 1 == times.size() || plan.isShown(times[i], times[i + 1]));
+		}
+		return shown;
+	}
+
+	// Whether every time on the grid the player and export ask for finds the frame covering it shown.
+	bool isEveryRequestCovered(const MediaTimeMapping& mapping, const MediaTime& frameDuration, const std::vector<MediaTime>& times, const std::vector<bool>& shown)
+	{
+		for (int k = 0; k * frameDuration.timeValue() < mapping.target.end.timeValue(); k++)
+		{
+			const MediaTime time(k * frameDuration.timeValue(), 600);
+			if (time < mapping.target.start)
+			{
+				continue;
+			}
+			int covering = -1;
+			for (size_t i = 0; i < times.size() && times[i].seconds() <= time.seconds() + 1e-9; i++)
+			{
+				covering = static_cast<int>(i);
+			}
+			if (covering < 0 || shown[covering] == false)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	int countShown(const std::vector<bool>& shown)
+	{
+		int count = 0;
+		for (const bool isShown : shown)
+		{
+			count += isShown ? 1 : 0;
+		}
+		return count;
+	}
+
+	int countShownUntil(const std::vector<bool>& shown, const std::vector<MediaTime>& times, const MediaTime& time)
+	{
+		int count = 0;
+		for (size_t i = 0; i < times.size() && times[i] <= time; i++)
+		{
+			count += shown[i] ? 1 : 0;
+		}
+		return count;
+	}
+}
+
+TEST_CASE(frameDurationIsOnTheRequestGrid)
+{
+	TEST_CHECK(getFrameDuration(24.0f).timeValue() == 25);
+	TEST_CHECK(getFrameDuration(30.0f).timeValue() == 20);
+	TEST_CHECK(getFrameDuration(29.97f).timeValue() == 20);
+	TEST_CHECK(getFrameDuration(23.976f).timeValue() == 25);
+	TEST_CHECK(getFrameDuration(60.0f).timeValue() == 10);
+}
+
+TEST_CASE(fastForwardShowsOneFramePerOutputFrame)
+{
+	// 8 s of 60 fps source on 2 s of composition at 24 fps.
+	const MediaTimeMapping mapping = makeMapping(0.0, 8.0, 0.0, 2.0);
+	const MediaTime frameDuration = getFrameDuration(24.0f);
+	const DecodePlan plan(mapping, frameDuration);
+	const std::vector<MediaTime> times = displayTimes(mapping, 60.0);
+	const std::vector<bool> shown = shownFrames(plan, times);
+	TEST_CHECK(isEveryRequestCovered(mapping, frameDuration, times, shown));
+	// One per output frame, the frames after the last output time are kept whatever they show.
+	TEST_CHECK(countShownUntil(shown, times, MediaTime(47 * frameDuration.timeValue(), 600)) == 48);
+	TEST_CHECK(countShown(shown) < 60);
+}
+
+TEST_CASE(sameRateShowsEveryFrame)
+{
+	const MediaTimeMapping mapping = makeMapping(0.0, 1.0, 1.0, 2.0);
+	const MediaTime frameDuration = getFrameDuration(24.0f);
+	const DecodePlan plan(mapping, frameDuration);
+	const std::vector<MediaTime> times = displayTimes(mapping, 24.0);
+	const std::vector<bool> shown = shownFrames(plan, times);
+	TEST_CHECK(countShown(shown) == static_cast<int>(times.size()));
+}
+
+TEST_CASE(ntscRateFollowsTheRequestGrid)
+{
+	// 29.97 fps renders step by 20/600, a plan on the exact 1001/30000 grid dropped frames the player asks for.
+	const MediaTimeMapping mapping = makeMapping(0.0, 10.0, 0.0, 10.0);
+	const MediaTime frameDuration = getFrameDuration(29.97f);
+	const DecodePlan plan(mapping, frameDuration);
+	const std::vector<MediaTime> times = displayTimes(mapping, 30000.0 / 1001.0);
+	const std::vector<bool> shown = shownFrames(plan, times);
+	TEST_CHECK(isEveryRequestCovered(mapping, frameDuration, times, shown));
+
+	// Slow motion leaves frames shown for several output frames, none of them is dropped.
+	const MediaTimeMapping slowMapping = makeMapping(0.0, 2.0, 0.0, 5.0);
+	const DecodePlan slowPlan(slowMapping, frameDuration);
+	const std::vector<MediaTime> slowTimes = displayTimes(slowMapping, 30000.0 / 1001.0);
+	TEST_CHECK(countShown(shownFrames(slowPlan, slowTimes)) == static_cast<int>(slowTimes.size()));
+}
+
+TEST_CASE(nextTimeIsOnTheRequestGrid)
+{
+	const MediaTimeMapping mapping = makeMapping(0.0, 4.0, 1.0, 3.0);
+	const MediaTime frameDuration = getFrameDuration(29.97f);
+	const DecodePlan plan(mapping, frameDuration);
+	MediaTime time;
+	TEST_CHECK(plan.nextTime(gridTime(1.5), time));
+	TEST_CHECK(time.timeValue() % frameDuration.timeValue() == 0);
+	TEST_CHECK(time.seconds() > 1.5 && time.seconds() <= 1.5 + frameDuration.seconds());
+	// Before the clip the first output time inside it comes next.
+	TEST_CHECK(plan.nextTime(gridTime(0.2), time));
+	TEST_CHECK(time.timeValue() == 600);
+	TEST_CHECK(plan.nextTime(gridTime(2.99), time) == false);
+}
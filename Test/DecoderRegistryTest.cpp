@@ -0,0 +1,96 @@
+// Copyright (C) 2021 lmc
+// 
+// This file is part of VideoEditor.
+// 
+// VideoEditor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+// 
+// VideoEditor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with VideoEditor.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "Test.h"
+#include <VideoEditor/DecoderRegistry.hpp>
+
+using namespace ks;
+
+namespace
+{
+	class FakeDecoderOwner : public IDecoderOwner
+	{
+	public:
+		bool isOpen = true;
+		bool isBusy = false;
+
+		virtual bool tryCloseDecoder() override
+		{
+			if (isBusy)
+			{
+				return false;
+			}
+			isOpen = false;
+			return true;
+		}
+	};
+}
+
+TEST_CASE(registryClosesLeastRecentlyUsed)
+{
+	DecoderRegistry registry(2);
+	FakeDecoderOwner video;
+	FakeDecoderOwner audio;
+	FakeDecoderOwner next;
+	registry.opened(&video);
+	registry.opened(&audio);
+	registry.used(&video);
+	registry.opened(&next);
+	TEST_CHECK(video.isOpen);
+	TEST_CHECK(audio.isOpen == false);
+	TEST_CHECK(next.isOpen);
+	registry.closed(&video);
+	registry.closed(&next);
+}
+
+TEST_CASE(registrySkipsBusyTracks)
+{
+	DecoderRegistry registry(1);
+	FakeDecoderOwner busy;
+	FakeDecoderOwner idle;
+	FakeDecoderOwner next;
+	busy.isBusy = true;
+	registry.opened(&busy);
+	registry.opened(&idle);
+	TEST_CHECK(busy.isOpen);
+	TEST_CHECK(idle.isOpen);
+	registry.opened(&next);
+	TEST_CHECK(busy.isOpen);
+	TEST_CHECK(idle.isOpen == false);
+	registry.closed(&busy);
+	registry.closed(&next);
+}
+
+TEST_CASE(registryReserveOnlyRaisesCapacity)
+{
+	DecoderRegistry registry(4);
+	registry.reserve(2);
+	TEST_CHECK(registry.getCapacity() == 4);
+	registry.reserve(6);
+	TEST_CHECK(registry.getCapacity() == 6);
+
+	FakeDecoderOwner owners[6];
+	for (FakeDecoderOwner& owner : owners)
+	{
+		registry.opened(&owner);
+	}
+	for (FakeDecoderOwner& owner : owners)
+	{
+		TEST_CHECK(owner.isOpen);
+		registry.closed(&owner);
+	}
+}
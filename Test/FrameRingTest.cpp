@@ -0,0 +1,107 @@
+// Copyright (C) 2021 lmc
+// 
+// This file is part of VideoEditor.
+// 
+// VideoEditor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+// 
+// VideoEditor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with VideoEditor.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include "Test.h"
+#include <VideoEditor/FrameRing.hpp>
+
+using namespace ks;
+
+namespace
+{
+	SourceFrame makeFrame(const int timeValue)
+	{
+		SourceFrame frame;
+		frame.displayTime = MediaTime(timeValue, 600);
+		return frame;
+	}
+
+	bool isInDisplayOrder(const FrameRing& ring, const int firstTimeValue, const int step)
+	{
+		for (size_t i = 0; i < ring.getCount(); i++)
+		{
+			if (ring[i].displayTime.timeValue() != firstTimeValue + static_cast<int>(i) * step)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+}
+
+TEST_CASE(frameRingKeepsDisplayOrderAcrossWrapAndGrowth)
+{
+	FrameRing ring(4);
+	for (int i = 0; i < 4; i++)
+	{
+		ring.pushBack(makeFrame(i * 25));
+	}
+	// The next two wrap around the end of the storage.
+	ring.popFront();
+	ring.popFront();
+	ring.pushBack(makeFrame(100));
+	ring.pushBack(makeFrame(125));
+	TEST_CHECK(ring.getCount() == 4);
+	TEST_CHECK(isInDisplayOrder(ring, 50, 25));
+
+	// A full ring that wrapped grows without reordering.
+	ring.pushBack(makeFrame(150));
+	ring.pushBack(makeFrame(175));
+	TEST_CHECK(ring.getCount() == 6);
+	TEST_CHECK(isInDisplayOrder(ring, 50, 25));
+	TEST_CHECK(ring.front().displayTime.timeValue() == 50);
+	TEST_CHECK(ring.back().displayTime.timeValue() == 175);
+}
+
+TEST_CASE(frameRingFindsTheCoveringFrame)
+{
+	FrameRing ring(2);
+	for (int i = 0; i < 5; i++)
+	{
+		ring.pushBack(makeFrame(60 + i * 60));
+	}
+	ring.popFront();
+	// Frames at 120, 180, 240, 300.
+	TEST_CHECK(ring.frameAt(MediaTime(60, 600)) == -1);
+	TEST_CHECK(ring.frameAt(MediaTime(120, 600)) == 0);
+	TEST_CHECK(ring.frameAt(MediaTime(150, 600)) == 0);
+	TEST_CHECK(ring.frameAt(MediaTime(180, 600)) == 1);
+	TEST_CHECK(ring.frameAt(MediaTime(299, 600)) == 2);
+	// The last frame covers every later time.
+	TEST_CHECK(ring.frameAt(MediaTime(6000, 600)) == 3);
+}
+
+TEST_CASE(frameRingCountsFramesAfter)
+{
+	FrameRing ring(8);
+	for (int i = 0; i < 5; i++)
+	{
+		ring.pushBack(makeFrame(i * 20));
+	}
+	TEST_CHECK(ring.countAfter(MediaTime(-1, 600)) == 5);
+	// The frame displayed at time is not after it.
+	TEST_CHECK(ring.countAfter(MediaTime(40, 600)) == 2);
+	TEST_CHECK(ring.countAfter(MediaTime(50, 600)) == 2);
+	TEST_CHECK(ring.countAfter(MediaTime(80, 600)) == 0);
+
+	ring.clear();
+	TEST_CHECK(ring.isEmpty());
+	TEST_CHECK(ring.frameAt(MediaTime(40, 600)) == -1);
+	TEST_CHECK(ring.countAfter(MediaTime(40, 600)) == 0);
+	ring.pushBack(makeFrame(10));
+	TEST_CHECK(ring.frameAt(MediaTime(10, 600)) == 0);
+}
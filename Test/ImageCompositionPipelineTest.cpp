@@ -0,0 +1,141 @@
+// Copyright (C) 2021 lmc
+// 
+// This file is part of VideoEditor.
+// 
+// VideoEditor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+// 
+// VideoEditor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with VideoEditor.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include "Test.h"
+#include <memory>
+#include <VideoEditor/GeneratorTrack.hpp>
+#include <VideoEditor/ImageCompositionPipeline.hpp>
+
+using namespace ks;
+
+namespace
+{
+	struct CompositionFixture
+	{
+		VideoRenderContext renderContext;
+		GeneratorTrack track;
+
+		CompositionFixture()
+		{
+			renderContext.renderSize = FSize(64, 64);
+			renderContext.renderScale = 1.0f;
+			renderContext.fps = 24.0f;
+			renderContext.format = PixelBuffer::FormatType::rgba8;
+			track.trackID = 1;
+			track.rect = Rect(0, 0, 64, 64);
+			track.prepare(renderContext);
+		}
+
+		AsyncImageCompositionRequest makeRequest(const SourceFrameHandle& handle)
+		{
+			AsyncImageCompositionRequest request;
+			request.compositionTime = MediaTime::zero;
+			request.instruction.timeRange = MediaTimeRange(MediaTime::zero, MediaTime(6000, 600));
+			request.instruction.imageTracks = { &track };
+			request.sourceFrames[track.trackID] = handle.get();
+			request.sourceFrameHandles[track.trackID] = handle;
+			request.sourceFrameDisplayTimes[track.trackID] = MediaTime::zero;
+			request.videoRenderContext = &renderContext;
+			request.pixelBufferFormat = renderContext.format;
+			// Banded, the filter graph needs a render engine.
+			request.isLowLatency = true;
+			return request;
+		}
+	};
+
+	PixelBuffer* compose(ImageCompositionPipeline& pipeline, AsyncImageCompositionRequest request, PixelBufferPool* pool)
+	{
+		pipeline.composition(request, [pool]()
+		{
+			return pool->pixelBuffer();
+		}, pool);
+		return request.getPixelBuffer();
+	}
+}
+
+TEST_CASE(compositionReusesOutputsOfTheSamePoolOnly)
+{
+	CompositionFixture fixture;
+	const SourceFrameHandle handle = fixture.track.retainSourceFrame(MediaTime::zero, fixture.renderContext);
+	PixelBufferPool firstPool(64, 64, 4, PixelBuffer::FormatType::rgba8);
+	PixelBufferPool secondPool(64, 64, 4, PixelBuffer::FormatType::rgba8);
+	ImageCompositionPipeline pipeline;
+
+	PixelBuffer* output = compose(pipeline, fixture.makeRequest(handle), &firstPool);
+	TEST_CHECK(compose(pipeline, fixture.makeRequest(handle), &firstPool) == output);
+	TEST_CHECK(pipeline.getReusedFrameCount() == 1);
+
+	// The same composition drawing from another pool gets a buffer of its own.
+	TEST_CHECK(compose(pipeline, fixture.makeRequest(handle), &secondPool) != output);
+	TEST_CHECK(pipeline.getReusedFrameCount() == 1);
+
+	// Without a pool the buffers may not outlive the call, nothing is kept or reused.
+	PixelBufferPool unnamedPool(64, 64, 4, PixelBuffer::FormatType::rgba8);
+	AsyncImageCompositionRequest request = fixture.makeRequest(handle);
+	for (int i = 0; i < 2; i++)
+	{
+		pipeline.composition(request, [&unnamedPool]()
+		{
+			return unnamedPool.pixelBuffer();
+		});
+		request.getPixelBuffer();
+	}
+	TEST_CHECK(pipeline.getReusedFrameCount() == 1);
+}
+
+TEST_CASE(compositionFlushForgetsEarlierOutputs)
+{
+	CompositionFixture fixture;
+	const SourceFrameHandle handle = fixture.track.retainSourceFrame(MediaTime::zero, fixture.renderContext);
+	ImageCompositionPipeline pipeline;
+	{
+		PixelBufferPool pool(64, 64, 4, PixelBuffer::FormatType::rgba8);
+		compose(pipeline, fixture.makeRequest(handle), &pool);
+		// The pool goes away, as it does at the end of an export.
+		pipeline.flush();
+	}
+	PixelBufferPool pool(64, 64, 4, PixelBuffer::FormatType::rgba8);
+	compose(pipeline, fixture.makeRequest(handle), &pool);
+	TEST_CHECK(pipeline.getReusedFrameCount() == 0);
+}
+
+TEST_CASE(renderedCompositionReleasesItsSourceFrames)
+{
+	CompositionFixture fixture;
+	const PixelBuffer* sourceFrame = fixture.track.sourceFrame(MediaTime::zero, fixture.renderContext);
+	bool isReleased = false;
+	PixelBufferPool pool(64, 64, 4, PixelBuffer::FormatType::rgba8);
+	ImageCompositionPipeline pipeline;
+
+	AsyncImageCompositionRequest request = fixture.makeRequest(SourceFrameHandle(sourceFrame, [&isReleased](const PixelBuffer*)
+	{
+		isReleased = true;
+	}));
+	pipeline.composition(request, [&pool]()
+	{
+		return pool.pixelBuffer();
+	}, &pool);
+	request.sourceFrameHandles.clear();
+	// The queued batch holds the frame until it is rendered.
+	TEST_CHECK(isReleased == false);
+
+	TEST_CHECK(request.getPixelBuffer() != nullptr);
+	// The memo of the output is still there, the frame is not held by it.
+	TEST_CHECK(isReleased);
+	TEST_CHECK(compose(pipeline, fixture.makeRequest(fixture.track.retainSourceFrame(MediaTime::zero, fixture.renderContext)), &pool) == request.getPixelBuffer());
+}
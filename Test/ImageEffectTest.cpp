@@ -0,0 +1,222 @@
+// Copyright (C) 2021 lmc
+// 
+// This file is part of VideoEditor.
+// 
+// VideoEditor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+// 
+// VideoEditor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with VideoEditor.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include "Test.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include <VideoEditor/ImageEffect.hpp>
+#include <VideoEditor/PixelKernels.hpp>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define VideoEditorTest_CycleCounter
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define VideoEditorTest_CycleCounter
+#endif
+
+using namespace ks;
+
+namespace
+{
+	void fillRandom(unsigned char* data, const size_t size)
+	{
+		for (size_t i = 0; i < size; i++)
+		{
+			data[i] = static_cast<unsigned char>(rand() & 255);
+		}
+	}
+
+	// The SSE2 path rounds halves to even, the scalar one away from zero. Anything else must match exactly.
+	bool isMatrixChannelCorrect(const std::array<float, 12>& matrix, const unsigned char* input, const int channel, const unsigned char output)
+	{
+		const double value = matrix[channel * 4 + 0] * input[0] + matrix[channel * 4 + 1] * input[1] +
+			matrix[channel * 4 + 2] * input[2] + matrix[channel * 4 + 3] * 255.0;
+		const double clamped = std::min(std::max(value, 0.0), 255.0);
+		const double fraction = clamped - floor(clamped);
+		if (fabs(fraction - 0.5) < 1e-3)
+		{
+			return output == floor(clamped) || output == ceil(clamped);
+		}
+		return output == lround(clamped);
+	}
+
+	std::string writeIdentityCube(const std::filesystem::path& path, const int size)
+	{
+		std::ofstream file(path, std::ios::trunc);
+		file << "LUT_3D_SIZE " << size << "\n";
+		for (int b = 0; b < size; b++)
+		{
+			for (int g = 0; g < size; g++)
+			{
+				for (int r = 0; r < size; r++)
+				{
+					file << static_cast<float>(r) / (size - 1) << " " << static_cast<float>(g) / (size - 1) << " " << static_cast<float>(b) / (size - 1) << "\n";
+				}
+			}
+		}
+		return path.string();
+	}
+
+	unsigned long long cycleCount()
+	{
+#ifdef VideoEditorTest_CycleCounter
+		return __rdtsc();
+#else
+		return static_cast<unsigned long long>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+	}
+
+	// Throughput of one kernel over a 1080p rgba8 frame. Without a cycle counter the unit is nanoseconds.
+	void benchmarkKernel(const char* name, PixelBuffer& frame, const std::function<void(const PixelPlane&)>& kernel)
+	{
+		const PixelPlane plane = PixelKernels::plane(frame, PixelBuffer::FormatType::rgba8, 0);
+		const double frameBytes = static_cast<double>(plane.bytesPerRow) * plane.height;
+		const int runCount = 10;
+		kernel(plane);
+		const unsigned long long begin = cycleCount();
+		for (int i = 0; i < runCount; i++)
+		{
+			kernel(plane);
+		}
+		const unsigned long long cycles = cycleCount() - begin;
+#ifdef VideoEditorTest_CycleCounter
+		printf("%-16s %6.2f bytes per cycle\n", name, frameBytes * runCount / cycles);
+#else
+		printf("%-16s %6.2f bytes per ns\n", name, frameBytes * runCount / cycles);
+#endif
+	}
+}
+
+TEST_CASE(colorMatrixMatchesScalarFormula)
+{
+	srand(3);
+	// Widths around the four pixel vector body exercise the one pixel tail.
+	for (const int width : { 1, 3, 4, 5, 8, 13, 64 })
+	{
+		for (int trial = 0; trial < 8; trial++)
+		{
+			std::array<float, 12> matrix;
+			for (float& value : matrix)
+			{
+				// Up to 1.5 and below 0, so that results also saturate.
+				value = static_cast<float>(rand() % 2000 - 500) / 1000.0f;
+			}
+			std::vector<unsigned char> input(width * 4);
+			fillRandom(input.data(), input.size());
+			std::vector<unsigned char> output = input;
+			ColorMatrixEffect(matrix).processRow(output.data(), width);
+
+			int mismatchCount = 0;
+			for (int x = 0; x < width; x++)
+			{
+				for (int channel = 0; channel < 3; channel++)
+				{
+					mismatchCount += isMatrixChannelCorrect(matrix, &input[x * 4], channel, output[x * 4 + channel]) ? 0 : 1;
+				}
+				mismatchCount += output[x * 4 + 3] == input[x * 4 + 3] ? 0 : 1;
+			}
+			TEST_CHECK(mismatchCount == 0);
+		}
+	}
+}
+
+TEST_CASE(colorMatrixIdentityKeepsPixels)
+{
+	srand(4);
+	std::vector<unsigned char> pixels(67 * 4);
+	fillRandom(pixels.data(), pixels.size());
+	std::vector<unsigned char> output = pixels;
+	ColorMatrixEffect(ColorMatrixEffect::identity()).processRow(output.data(), 67);
+	TEST_CHECK(output == pixels);
+}
+
+TEST_CASE(identityLUTKeepsPixels)
+{
+	const std::filesystem::path path = std::filesystem::temp_directory_path() / "VideoEditorIdentity.cube";
+	std::unique_ptr<LUT3DEffect> lut(LUT3DEffect::New(writeIdentityCube(path, 17)));
+	std::filesystem::remove(path);
+	TEST_CHECK(lut != nullptr);
+	if (lut == nullptr)
+	{
+		return;
+	}
+	srand(5);
+	std::vector<unsigned char> pixels(67 * 4);
+	fillRandom(pixels.data(), pixels.size());
+	std::vector<unsigned char> output = pixels;
+	lut->processRow(output.data(), 67);
+	TEST_CHECK(output == pixels);
+}
+
+// Bytes per cycle of the effect kernels on a 1080p frame. Set VIDEOEDITOR_TEST_BENCHMARK to run it.
+TEST_CASE(effectKernelThroughput)
+{
+	if (getenv("VIDEOEDITOR_TEST_BENCHMARK") == nullptr)
+	{
+		Test::skip("VIDEOEDITOR_TEST_BENCHMARK is not set");
+		return;
+	}
+	PixelBuffer frame(1920, 1080, PixelBuffer::FormatType::rgba8);
+	const PixelPlane plane = PixelKernels::plane(frame, PixelBuffer::FormatType::rgba8, 0);
+	for (int y = 0; y < plane.height; y++)
+	{
+		fillRandom(plane.data + y * plane.bytesPerRow, plane.width * 4);
+	}
+
+	const std::filesystem::path path = std::filesystem::temp_directory_path() / "VideoEditorBenchmark.cube";
+	std::unique_ptr<LUT3DEffect> lut(LUT3DEffect::New(writeIdentityCube(path, 33)));
+	std::filesystem::remove(path);
+	const BrightnessContrastEffect matrix(0.05f, 1.2f);
+	const BoxBlurEffect boxBlur(8);
+	const GaussianBlurEffect gaussianBlur(4.0f);
+
+	const auto rows = [](const IImageEffect& effect)
+	{
+		return [&effect](const PixelPlane& plane)
+		{
+			for (int y = 0; y < plane.height; y++)
+			{
+				effect.processRow(plane.data + y * plane.bytesPerRow, plane.width);
+			}
+		};
+	};
+	if (lut)
+	{
+		benchmarkKernel("lut3d", frame, rows(*lut));
+	}
+	benchmarkKernel("color matrix", frame, rows(matrix));
+	benchmarkKernel("box blur r8", frame, [&boxBlur](const PixelPlane& plane)
+	{
+		boxBlur.process(plane);
+	});
+	benchmarkKernel("gaussian s4", frame, [&gaussianBlur](const PixelPlane& plane)
+	{
+		gaussianBlur.process(plane);
+	});
+}
@@ -0,0 +1,224 @@
+// Copyright (C) 2021 lmc
+// 
+// This file is part of VideoEditor.
+// 
+// VideoEditor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+// 
+// VideoEditor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with VideoEditor.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include "Test.h"
+#include <condition_variable>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <stdio.h>
+#include <string>
+#include <VideoEditor/ImageSequenceTrack.hpp>
+#include <VideoEditor/PixelKernels.hpp>
+
+using namespace ks;
+
+namespace
+{
+	// A directory of 4x4 ppm frames whose red channel is the frame number.
+	struct SequenceFixture
+	{
+		std::filesystem::path directory;
+		VideoRenderContext renderContext;
+
+		SequenceFixture(const char* name)
+		{
+			// A literal %20 as in an escaped URL, it must not be taken for the frame number.
+			directory = std::filesystem::temp_directory_path() / name / "take%201";
+			std::filesystem::remove_all(directory.parent_path());
+			std::filesystem::create_directories(directory);
+			renderContext.renderSize = FSize(4, 4);
+			renderContext.renderScale = 1.0f;
+			renderContext.fps = 24.0f;
+			renderContext.format = PixelBuffer::FormatType::rgba8;
+		}
+
+		~SequenceFixture()
+		{
+			std::error_code error;
+			std::filesystem::remove_all(directory.parent_path(), error);
+		}
+
+		std::string pattern() const
+		{
+			return (directory / "shot_%03d.ppm").string();
+		}
+
+		std::string framePath(const int frameNumber) const
+		{
+			char name[32];
+			snprintf(name, sizeof(name), "shot_%03d.ppm", frameNumber);
+			return (directory / name).string();
+		}
+
+		void writeFrames(const int first, const int last) const
+		{
+			for (int frameNumber = first; frameNumber <= last; frameNumber++)
+			{
+				std::ofstream file(framePath(frameNumber), std::ios::binary | std::ios::trunc);
+				file << "P6 4 4 255\n";
+				for (int i = 0; i < 16; i++)
+				{
+					file.put(static_cast<char>(frameNumber)).put(0).put(0);
+				}
+			}
+		}
+	};
+
+	int frameRed(const PixelBuffer* frame)
+	{
+		if (frame == nullptr)
+		{
+			return -1;
+		}
+		return PixelKernels::plane(*frame, PixelBuffer::FormatType::rgba8, 0).data[0];
+	}
+
+	MediaTime seconds(const double value)
+	{
+		return MediaTime(value, 600);
+	}
+
+	// Holds every thread of the shared pool, so that what is dispatched meanwhile stays queued.
+	class PoolBlocker
+	{
+	public:
+		PoolBlocker()
+			: threadCount(WorkerPool::shared().getThreadCount())
+		{
+			for (unsigned int i = 0; i < threadCount; i++)
+			{
+				WorkerPool::shared().dispatch([this]()
+				{
+					std::unique_lock<std::mutex> lock(mutex);
+					startedCount++;
+					condition.notify_all();
+					condition.wait(lock, [this]()
+					{
+						return isReleased;
+					});
+				});
+			}
+			std::unique_lock<std::mutex> lock(mutex);
+			condition.wait(lock, [this]()
+			{
+				return startedCount == threadCount;
+			});
+		}
+
+		// Returns once every task queued before the call has finished: the pool takes tasks in order,
+		// so when each thread runs one of the barrier tasks nothing queued earlier is left.
+		void releaseAndDrain()
+		{
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				isReleased = true;
+				condition.notify_all();
+			}
+			unsigned int barrierCount = 0;
+			for (unsigned int i = 0; i < threadCount; i++)
+			{
+				WorkerPool::shared().dispatch([this, &barrierCount]()
+				{
+					std::unique_lock<std::mutex> lock(mutex);
+					barrierCount++;
+					condition.notify_all();
+					condition.wait(lock, [this, &barrierCount]()
+					{
+						return barrierCount >= threadCount;
+					});
+					doneCount++;
+					condition.notify_all();
+				});
+			}
+			std::unique_lock<std::mutex> lock(mutex);
+			condition.wait(lock, [this]()
+			{
+				return doneCount == threadCount;
+			});
+		}
+
+	private:
+		const unsigned int threadCount;
+		unsigned int startedCount = 0;
+		unsigned int doneCount = 0;
+		bool isReleased = false;
+		std::mutex mutex;
+		std::condition_variable condition;
+	};
+}
+
+TEST_CASE(sequenceMapsCompositionTimeToFrameNumbers)
+{
+	const SequenceFixture fixture("VideoEditorSequenceMapping");
+	fixture.writeFrames(100, 150);
+	ImageSequenceTrack track;
+	track.filePattern = fixture.pattern();
+	track.firstFrameNumber = 100;
+	track.frameRate = 24.0f;
+	track.decodeThreadCount = 0;
+	// One second of source starting at 1 s, placed at 10 s.
+	track.timeMapping = MediaTimeMapping(MediaTimeRange(seconds(1.0), seconds(2.0)), MediaTimeRange(seconds(10.0), seconds(11.0)));
+	track.prepare(fixture.renderContext);
+
+	// 10.5 s is 1.5 s into the source, frame 100 + 36.
+	TEST_CHECK(frameRed(track.sourceFrame(seconds(10.5), fixture.renderContext)) == 136);
+	TEST_CHECK(track.sourceFrameDisplayTime(seconds(10.5)) == seconds(10.5));
+	// Between two frames the earlier one shows, from its own display time.
+	TEST_CHECK(frameRed(track.sourceFrame(seconds(10.52), fixture.renderContext)) == 136);
+	TEST_CHECK(track.sourceFrameDisplayTime(seconds(10.52)) == seconds(10.5));
+	TEST_CHECK(frameRed(track.sourceFrame(seconds(10.0), fixture.renderContext)) == 124);
+}
+
+TEST_CASE(sequenceSeekDropsPrefetchesInFlight)
+{
+	if (WorkerPool::shared().getThreadCount() == 0)
+	{
+		Test::skip("the shared pool has no threads to prefetch on");
+		return;
+	}
+	const SequenceFixture fixture("VideoEditorSequenceSeek");
+	fixture.writeFrames(0, 23);
+	ImageSequenceTrack track;
+	track.filePattern = fixture.pattern();
+	track.lookAhead = 4;
+	track.decodeThreadCount = 4;
+	track.timeMapping = MediaTimeMapping(MediaTimeRange(seconds(0.0), seconds(1.0)), MediaTimeRange(seconds(0.0), seconds(1.0)));
+	track.prepare(fixture.renderContext);
+
+	PoolBlocker blocker;
+	// Frame 0 decodes on this thread and queues frames 1 to 4 behind the blocked pool.
+	TEST_CHECK(frameRed(track.sourceFrame(seconds(0.0), fixture.renderContext)) == 0);
+	// Prefetches that ran now would fail and remember the failure.
+	for (int frameNumber = 1; frameNumber <= 4; frameNumber++)
+	{
+		std::filesystem::rename(fixture.framePath(frameNumber), fixture.framePath(frameNumber) + ".moved");
+	}
+	track.onSeeking(seconds(0.0));
+	blocker.releaseAndDrain();
+	for (int frameNumber = 1; frameNumber <= 4; frameNumber++)
+	{
+		std::filesystem::rename(fixture.framePath(frameNumber) + ".moved", fixture.framePath(frameNumber));
+	}
+
+	// The old prefetches left nothing behind, every frame decodes again.
+	for (int frameNumber = 1; frameNumber <= 4; frameNumber++)
+	{
+		TEST_CHECK(frameRed(track.sourceFrame(seconds(frameNumber / 24.0), fixture.renderContext)) == frameNumber);
+	}
+}
@@ -0,0 +1,73 @@
+// Copyright (C) 2021 lmc
+// 
+// This file is part of VideoEditor.
+// 
+// VideoEditor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+// 
+// VideoEditor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with VideoEditor.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "Test.h"
+#include <memory>
+#include <string.h>
+#include <VideoEditor/GeneratorTrack.hpp>
+#include <VideoEditor/PixelKernels.hpp>
+
+using namespace ks;
+
+namespace
+{
+	VideoRenderContext makeRenderContext(const float renderScale)
+	{
+		VideoRenderContext renderContext;
+		renderContext.renderSize = FSize(64, 64);
+		renderContext.renderScale = renderScale;
+		renderContext.fps = 24.0f;
+		renderContext.format = PixelBuffer::FormatType::rgba8;
+		return renderContext;
+	}
+
+	unsigned int firstPixel(const PixelBuffer& pixelBuffer)
+	{
+		const PixelPlane plane = PixelKernels::plane(pixelBuffer, PixelBuffer::FormatType::rgba8, 0);
+		unsigned int pixel = 0;
+		memcpy(&pixel, plane.data, sizeof(pixel));
+		return pixel;
+	}
+}
+
+TEST_CASE(generatorHandleOutlivesRerender)
+{
+	std::unique_ptr<GeneratorTrack> track = std::make_unique<GeneratorTrack>();
+	track->rect = Rect(0, 0, 64, 64);
+	track->colors[0] = { 10, 20, 30, 128 };
+	const VideoRenderContext fullScale = makeRenderContext(1.0f);
+	track->prepare(fullScale);
+
+	SourceFrameHandle handle = track->retainSourceFrame(MediaTime::zero, fullScale);
+	TEST_CHECK(handle != nullptr);
+	const unsigned int pixel = firstPixel(*handle);
+
+	// A new render size replaces the image, the handle keeps the old one.
+	const VideoRenderContext halfScale = makeRenderContext(0.5f);
+	track->prepare(halfScale);
+	SourceFrameHandle halfHandle = track->retainSourceFrame(MediaTime::zero, halfScale);
+	TEST_CHECK(halfHandle != nullptr);
+	TEST_CHECK(halfHandle.get() != handle.get());
+	TEST_CHECK(handle->getWidth() == 64);
+	TEST_CHECK(halfHandle->getWidth() == 32);
+	TEST_CHECK(firstPixel(*handle) == pixel);
+
+	// Handles may outlive the track.
+	track->prepare(fullScale);
+	handle = track->retainSourceFrame(MediaTime::zero, fullScale);
+	TEST_CHECK(handle.get() != halfHandle.get());
+}
@@ -0,0 +1,140 @@
+// Copyright (C) 2021 lmc
+// 
+// This file is part of VideoEditor.
+// 
+// VideoEditor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+// 
+// VideoEditor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with VideoEditor.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include "Test.h"
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <VideoEditor/MediaIndex.hpp>
+
+using namespace ks;
+
+namespace
+{
+	// A fresh directory holding a media file and the index directory next to it.
+	struct IndexFixture
+	{
+		std::filesystem::path directory;
+		std::string mediaPath;
+		std::string indexDirectory;
+
+		IndexFixture(const char* name)
+		{
+			directory = std::filesystem::temp_directory_path() / name;
+			std::filesystem::remove_all(directory);
+			std::filesystem::create_directories(directory);
+			mediaPath = (directory / "media.mp4").string();
+			indexDirectory = (directory / "index").string();
+			writeMedia("media");
+		}
+
+		~IndexFixture()
+		{
+			std::error_code error;
+			std::filesystem::remove_all(directory, error);
+		}
+
+		void writeMedia(const std::string& content) const
+		{
+			std::ofstream file(mediaPath, std::ios::trunc);
+			file << content;
+		}
+
+		bool hasIndexFile() const
+		{
+			std::error_code error;
+			return std::filesystem::exists(indexDirectory, error) && std::filesystem::is_empty(indexDirectory, error) == false;
+		}
+	};
+
+	MediaTime seconds(const double value)
+	{
+		return MediaTime(static_cast<int>(value * 600.0), 600);
+	}
+}
+
+TEST_CASE(mediaIndexCoversOnlyRecordedSeeks)
+{
+	MediaIndex index("media.mp4");
+	MediaTime keyframe;
+	TEST_CHECK(index.keyframeBefore(seconds(5.0), keyframe) == false);
+
+	index.recordSeek(seconds(5.0), seconds(4.0));
+	TEST_CHECK(index.keyframeBefore(seconds(5.0), keyframe) && keyframe == seconds(4.0));
+	TEST_CHECK(index.keyframeBefore(seconds(4.5), keyframe) && keyframe == seconds(4.0));
+	// Past the recorded target another keyframe may lie in between.
+	TEST_CHECK(index.keyframeBefore(seconds(6.0), keyframe) == false);
+	TEST_CHECK(index.keyframeBefore(seconds(3.0), keyframe) == false);
+
+	index.recordSeek(seconds(7.0), seconds(4.0));
+	TEST_CHECK(index.keyframeBefore(seconds(6.0), keyframe) && keyframe == seconds(4.0));
+}
+
+TEST_CASE(mediaIndexDropsKeyframesASeekSkipped)
+{
+	MediaIndex index("media.mp4");
+	MediaTime keyframe;
+	index.recordSeek(seconds(9.0), seconds(8.0));
+	// A seek to 9.5 landing on 6 proves there is no keyframe at 8.
+	index.recordSeek(seconds(9.5), seconds(6.0));
+	TEST_CHECK(index.keyframeBefore(seconds(9.2), keyframe) && keyframe == seconds(6.0));
+	TEST_CHECK(index.keyframeBefore(seconds(8.0), keyframe) && keyframe == seconds(6.0));
+}
+
+TEST_CASE(mediaIndexCacheReloadsSavedIndex)
+{
+	const IndexFixture fixture("VideoEditorMediaIndexReload");
+	MediaTime keyframe;
+	{
+		MediaIndexCache cache(fixture.indexDirectory);
+		std::shared_ptr<MediaIndex> index = cache.index(fixture.mediaPath);
+		TEST_CHECK(cache.index(fixture.mediaPath) == index);
+		index->recordSeek(seconds(7.0), seconds(4.0));
+	}
+	TEST_CHECK(fixture.hasIndexFile());
+
+	MediaIndexCache cache(fixture.indexDirectory);
+	std::shared_ptr<MediaIndex> index = cache.index(fixture.mediaPath);
+	TEST_CHECK(index->keyframeBefore(seconds(6.5), keyframe) && keyframe == seconds(4.0));
+	TEST_CHECK(index->keyframeBefore(seconds(7.5), keyframe) == false);
+}
+
+TEST_CASE(mediaIndexCacheStartsOverForAChangedFile)
+{
+	const IndexFixture fixture("VideoEditorMediaIndexChanged");
+	MediaTime keyframe;
+	{
+		MediaIndexCache cache(fixture.indexDirectory);
+		cache.index(fixture.mediaPath)->recordSeek(seconds(7.0), seconds(4.0));
+	}
+	fixture.writeMedia("re-encoded media");
+
+	MediaIndexCache cache(fixture.indexDirectory);
+	TEST_CHECK(cache.index(fixture.mediaPath)->keyframeBefore(seconds(6.5), keyframe) == false);
+}
+
+TEST_CASE(mediaIndexCacheSavesNothingWithoutAFile)
+{
+	// Decoder URLs such as async:file:/... are not files, their seeks are never saved.
+	const IndexFixture fixture("VideoEditorMediaIndexURL");
+	{
+		MediaIndexCache cache(fixture.indexDirectory);
+		cache.index("async:file:" + fixture.mediaPath)->recordSeek(seconds(7.0), seconds(4.0));
+	}
+	TEST_CHECK(fixture.hasIndexFile() == false);
+}
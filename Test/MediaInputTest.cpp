@@ -0,0 +1,311 @@
+// Copyright (C) 2021 lmc
+// 
+// This file is part of VideoEditor.
+// 
+// VideoEditor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+// 
+// VideoEditor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with VideoEditor.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include "Test.h"
+#include <algorithm>
+#include <atomic>
+#include <ctype.h>
+#include <fstream>
+#include <memory>
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
+#include <vector>
+#include <KSMediaCodec/KSMediaCodec.hpp>
+#include <VideoEditor/MediaInput.hpp>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+using namespace ks;
+
+namespace
+{
+#ifdef _WIN32
+	typedef SOCKET Socket;
+	const Socket invalidSocket = INVALID_SOCKET;
+	void closeSocket(Socket socket) { closesocket(socket); }
+#else
+	typedef int Socket;
+	const Socket invalidSocket = -1;
+	void closeSocket(Socket socket) { close(socket); }
+#endif
+
+	// Serves one file on 127.0.0.1 with range requests, one connection at a time, and counts the requests.
+	class LocalHTTPServer
+	{
+	public:
+		LocalHTTPServer(const std::string& filePath)
+		{
+			std::ifstream file(filePath, std::ios::binary);
+			content.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+		}
+
+		~LocalHTTPServer()
+		{
+			isStopping = true;
+			if (thread.joinable())
+			{
+				thread.join();
+			}
+			if (listener != invalidSocket)
+			{
+				closeSocket(listener);
+			}
+#ifdef _WIN32
+			WSACleanup();
+#endif
+		}
+
+		bool start()
+		{
+#ifdef _WIN32
+			WSADATA data;
+			WSAStartup(MAKEWORD(2, 2), &data);
+#endif
+			listener = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+			if (listener == invalidSocket || content.empty())
+			{
+				return false;
+			}
+			sockaddr_in address;
+			memset(&address, 0, sizeof(address));
+			address.sin_family = AF_INET;
+			address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+			address.sin_port = 0;
+			socklen_t length = sizeof(address);
+			if (bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+				listen(listener, 4) != 0 ||
+				getsockname(listener, reinterpret_cast<sockaddr*>(&address), &length) != 0)
+			{
+				return false;
+			}
+			port = ntohs(address.sin_port);
+			thread = std::thread([this]() { serve(); });
+			return true;
+		}
+
+		std::string url(const std::string& name) const
+		{
+			return "http://127.0.0.1:" + std::to_string(port) + "/" + name;
+		}
+
+		unsigned int getRequestCount() const
+		{
+			return requestCount;
+		}
+
+	private:
+		std::vector<char> content;
+		Socket listener = invalidSocket;
+		int port = 0;
+		std::thread thread;
+		std::atomic<bool> isStopping = false;
+		std::atomic<unsigned int> requestCount = 0;
+
+		void serve()
+		{
+			while (isStopping == false)
+			{
+				// Polled, so that the destructor does not depend on accept being interrupted.
+				fd_set readSet;
+				FD_ZERO(&readSet);
+				FD_SET(listener, &readSet);
+				timeval timeout = { 0, 100 * 1000 };
+				if (select(static_cast<int>(listener) + 1, &readSet, nullptr, nullptr, &timeout) <= 0)
+				{
+					continue;
+				}
+				const Socket client = accept(listener, nullptr, nullptr);
+				if (client != invalidSocket)
+				{
+					respond(client);
+					closeSocket(client);
+				}
+			}
+		}
+
+		void respond(const Socket client)
+		{
+			std::string request;
+			char buffer[1024];
+			while (request.find("\r\n\r\n") == std::string::npos)
+			{
+				const int received = recv(client, buffer, sizeof(buffer), 0);
+				if (received <= 0)
+				{
+					return;
+				}
+				request.append(buffer, received);
+			}
+			requestCount++;
+
+			size_t first = 0;
+			size_t last = content.size() - 1;
+			bool isRange = false;
+			const size_t rangePosition = request.find("Range: bytes=");
+			if (rangePosition != std::string::npos)
+			{
+				const char* range = request.c_str() + rangePosition + strlen("Range: bytes=");
+				char* end = nullptr;
+				first = strtoull(range, &end, 10);
+				if (*end == '-' && isdigit(static_cast<unsigned char>(end[1])))
+				{
+					last = std::min<size_t>(strtoull(end + 1, nullptr, 10), content.size() - 1);
+				}
+				isRange = true;
+			}
+			if (first >= content.size())
+			{
+				const std::string header = "HTTP/1.1 416 Range Not Satisfiable\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+				send(client, header.c_str(), static_cast<int>(header.size()), 0);
+				return;
+			}
+
+			std::string header = isRange ? "HTTP/1.1 206 Partial Content\r\n" : "HTTP/1.1 200 OK\r\n";
+			header += "Content-Type: application/octet-stream\r\nAccept-Ranges: bytes\r\nConnection: close\r\n";
+			header += "Content-Length: " + std::to_string(last - first + 1) + "\r\n";
+			if (isRange)
+			{
+				header += "Content-Range: bytes " + std::to_string(first) + "-" + std::to_string(last) + "/" + std::to_string(content.size()) + "\r\n";
+			}
+			header += "\r\n";
+			send(client, header.c_str(), static_cast<int>(header.size()), 0);
+
+			// A client seeking elsewhere closes the connection, the send then fails and the response ends.
+			size_t offset = first;
+			while (offset <= last && isStopping == false)
+			{
+				const int chunk = static_cast<int>(std::min<size_t>(64 * 1024, last + 1 - offset));
+#ifdef MSG_NOSIGNAL
+				const int sent = send(client, content.data() + offset, chunk, MSG_NOSIGNAL);
+#else
+				const int sent = send(client, content.data() + offset, chunk, 0);
+#endif
+				if (sent <= 0)
+				{
+					return;
+				}
+				offset += sent;
+			}
+		}
+	};
+
+	const unsigned int decodedFrameCount = 48;
+
+	std::vector<double> decodePts(VideoDecoder& decoder)
+	{
+		std::vector<double> pts;
+		while (pts.size() < decodedFrameCount)
+		{
+			MediaTime framePts;
+			PixelBuffer* frame = decoder.newFrame(framePts);
+			if (frame == nullptr)
+			{
+				break;
+			}
+			delete frame;
+			pts.push_back(framePts.seconds());
+		}
+		return pts;
+	}
+
+	std::vector<double> decodePts(const std::string& url)
+	{
+		std::unique_ptr<VideoDecoder> decoder = std::unique_ptr<VideoDecoder>(VideoDecoder::New(url, PixelBuffer::FormatType::yuv420p));
+		return decoder ? decodePts(*decoder) : std::vector<double>();
+	}
+}
+
+TEST_CASE(decoderURLReadsStreamsAhead)
+{
+	MediaInputOptions options;
+	TEST_CHECK(MediaInput::decoderURL("/project", "clip.mp4", options, true) == "async:file:/project/clip.mp4");
+	TEST_CHECK(MediaInput::decoderURL("/project", "still.png", options, false) == "/project/still.png");
+	TEST_CHECK(MediaInput::decoderURL("/project", "https://host/clip.mp4", options, true) == "async:cache:https://host/clip.mp4");
+
+	options.isLocalReadAhead = false;
+	options.isReadAhead = false;
+	TEST_CHECK(MediaInput::decoderURL("/project", "clip.mp4", options, true) == "/project/clip.mp4");
+	TEST_CHECK(MediaInput::decoderURL("/project", "http://host/clip.mp4", options, true) == "cache:http://host/clip.mp4");
+
+	TEST_CHECK(MediaInput::isCachedURL("cache:http://host/clip.mp4"));
+	TEST_CHECK(MediaInput::isCachedURL("async:cache:http://host/clip.mp4"));
+	TEST_CHECK(MediaInput::isCachedURL("async:file:/project/clip.mp4") == false);
+	TEST_CHECK(MediaInput::isRemote("https://host/clip.mp4"));
+	TEST_CHECK(MediaInput::isRemote("/project/http/clip.mp4") == false);
+}
+
+// VIDEOEDITOR_TEST_MEDIA names a local video file, it is served over http and decoded through the remote input chain.
+TEST_CASE(remoteMediaDecodesLikeLocalMedia)
+{
+	const char* mediaPath = getenv("VIDEOEDITOR_TEST_MEDIA");
+	if (mediaPath == nullptr)
+	{
+		Test::skip("VIDEOEDITOR_TEST_MEDIA is not set");
+		return;
+	}
+	const std::vector<double> localPts = decodePts(mediaPath);
+	TEST_CHECK(localPts.empty() == false);
+
+	LocalHTTPServer server(mediaPath);
+	TEST_CHECK(server.start());
+	const std::string url = MediaInput::decoderURL("", server.url("clip.mp4"), MediaInputOptions(), true);
+	TEST_CHECK(decodePts(url) == localPts);
+}
+
+TEST_CASE(remoteMediaSeeksBackFromTheCache)
+{
+	const char* mediaPath = getenv("VIDEOEDITOR_TEST_MEDIA");
+	if (mediaPath == nullptr)
+	{
+		Test::skip("VIDEOEDITOR_TEST_MEDIA is not set");
+		return;
+	}
+	const std::vector<double> localPts = decodePts(mediaPath);
+
+	LocalHTTPServer server(mediaPath);
+	TEST_CHECK(server.start());
+	// Without async: nothing reads on behind the decoder's back, so every request comes from the decoder.
+	MediaInputOptions options;
+	options.isReadAhead = false;
+	const std::string url = MediaInput::decoderURL("", server.url("clip.mp4"), options, true);
+	TEST_CHECK(MediaInput::isCachedURL(url));
+
+	std::unique_ptr<VideoDecoder> decoder = std::unique_ptr<VideoDecoder>(VideoDecoder::New(url, PixelBuffer::FormatType::yuv420p));
+	TEST_CHECK(decoder != nullptr);
+	if (decoder == nullptr)
+	{
+		return;
+	}
+	TEST_CHECK(decodePts(*decoder) == localPts);
+	const unsigned int requestCount = server.getRequestCount();
+	TEST_CHECK(requestCount > 0);
+
+	TEST_CHECK(decoder->seek(MediaTime::zero));
+	TEST_CHECK(decodePts(*decoder) == localPts);
+	TEST_CHECK(server.getRequestCount() == requestCount);
+}
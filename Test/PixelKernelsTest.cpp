@@ -0,0 +1,106 @@
+// Copyright (C) 2021 lmc
+// 
+// This file is part of VideoEditor.
+// 
+// VideoEditor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+// 
+// VideoEditor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with VideoEditor.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "Test.h"
+#include <stdlib.h>
+#include <VideoEditor/PixelKernels.hpp>
+
+using namespace ks;
+
+namespace
+{
+	unsigned char clampByte(const int value)
+	{
+		return static_cast<unsigned char>(value < 0 ? 0 : value > 255 ? 255 : value);
+	}
+
+	void fillRandom(PixelBuffer& pixelBuffer, const PixelBuffer::FormatType format)
+	{
+		for (int i = 0; i < PixelKernels::planeCount(format); i++)
+		{
+			const PixelPlane plane = PixelKernels::plane(pixelBuffer, format, i);
+			for (int y = 0; y < plane.height; y++)
+			{
+				for (int x = 0; x < plane.width * plane.bytesPerPixel; x++)
+				{
+					plane.data[y * plane.bytesPerRow + x] = static_cast<unsigned char>(rand() & 255);
+				}
+			}
+		}
+	}
+
+	// Every pixel against the scalar BT.601 formula the vector path must reproduce exactly.
+	int countMismatches(const PixelBuffer& src, const PixelBuffer& dst, const int width, const int height)
+	{
+		const PixelBuffer::FormatType yuv = PixelBuffer::FormatType::yuv420p;
+		const PixelPlane luma = PixelKernels::plane(src, yuv, 0);
+		const PixelPlane cb = PixelKernels::plane(src, yuv, 1);
+		const PixelPlane cr = PixelKernels::plane(src, yuv, 2);
+		const PixelPlane rgba = PixelKernels::plane(dst, PixelBuffer::FormatType::rgba8, 0);
+		int mismatchCount = 0;
+		for (int y = 0; y < height; y++)
+		{
+			for (int x = 0; x < width; x++)
+			{
+				const int c = 298 * (luma.data[y * luma.bytesPerRow + x] - 16);
+				const int d = cb.data[(y / 2) * cb.bytesPerRow + x / 2] - 128;
+				const int e = cr.data[(y / 2) * cr.bytesPerRow + x / 2] - 128;
+				const unsigned char* pixel = rgba.data + y * rgba.bytesPerRow + x * 4;
+				if (pixel[0] != clampByte((c + 409 * e + 128) >> 8) ||
+					pixel[1] != clampByte((c - 100 * d - 208 * e + 128) >> 8) ||
+					pixel[2] != clampByte((c + 516 * d + 128) >> 8) ||
+					pixel[3] != 255)
+				{
+					mismatchCount++;
+				}
+			}
+		}
+		return mismatchCount;
+	}
+}
+
+TEST_CASE(yuvToRGBAMatchesScalarFormula)
+{
+	srand(1);
+	// Widths around the vector width exercise the scalar tail, odd sizes the shared chroma of the last column and row.
+	for (const int width : { 1, 7, 8, 9, 16, 17, 33, 100 })
+	{
+		for (const int height : { 1, 2, 5, 16 })
+		{
+			PixelBuffer src(width, height, PixelBuffer::FormatType::yuv420p);
+			PixelBuffer dst(width, height, PixelBuffer::FormatType::rgba8);
+			fillRandom(src, PixelBuffer::FormatType::yuv420p);
+			PixelKernels::convertYUV420PToRGBA8(src, dst, width, height, 0, height);
+			TEST_CHECK(countMismatches(src, dst, width, height) == 0);
+		}
+	}
+}
+
+TEST_CASE(yuvToRGBAInRowRangesMatchesWholeFrame)
+{
+	srand(2);
+	const int width = 37;
+	const int height = 24;
+	PixelBuffer src(width, height, PixelBuffer::FormatType::yuv420p);
+	PixelBuffer dst(width, height, PixelBuffer::FormatType::rgba8);
+	fillRandom(src, PixelBuffer::FormatType::yuv420p);
+	for (int rowBegin = 0; rowBegin < height; rowBegin += 6)
+	{
+		PixelKernels::convertYUV420PToRGBA8(src, dst, width, height, rowBegin, rowBegin + 6);
+	}
+	TEST_CHECK(countMismatches(src, dst, width, height) == 0);
+}
@@ -0,0 +1,169 @@
+// Copyright (C) 2021 lmc
+// 
+// This file is part of VideoEditor.
+// 
+// VideoEditor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+// 
+// VideoEditor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with VideoEditor.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include "Test.h"
+#include <memory>
+#include <set>
+#include <VideoEditor/SharedFrameCache.hpp>
+
+using namespace ks;
+
+namespace
+{
+	const int frameSize = 16;
+	// Bytes of one rgba8 frame.
+	const size_t frameBytes = frameSize * frameSize * 4;
+
+	// Frames come from a pool that outlives the cache, the deleter records what the cache let go.
+	struct CacheFixture
+	{
+		PixelBufferPool pool;
+		std::shared_ptr<std::set<const PixelBuffer*>> deleted;
+		SharedFrameCache cache;
+		const std::string streamKey;
+
+		CacheFixture(const size_t capacityFrames)
+			: pool(frameSize, frameSize, 16, PixelBuffer::FormatType::rgba8),
+			deleted(std::make_shared<std::set<const PixelBuffer*>>()),
+			cache(capacityFrames * frameBytes),
+			streamKey(SharedFrameCache::streamKey("clip.mp4", PixelBuffer::FormatType::rgba8, 0, 0))
+		{
+		}
+
+		// One frame of the 24 fps stream, retained once for the caller.
+		PixelBuffer* insert(const int index, const int previousIndex = -1)
+		{
+			PixelBuffer* frame = pool.pixelBuffer();
+			const MediaTime previousPts = pts(previousIndex);
+			std::shared_ptr<std::set<const PixelBuffer*>> deletedFrames = deleted;
+			cache.insert(streamKey, PixelBuffer::FormatType::rgba8, pts(index), previousIndex < 0 ? nullptr : &previousPts, frame, [deletedFrames](PixelBuffer* frame)
+			{
+				deletedFrames->insert(frame);
+			});
+			return frame;
+		}
+
+		bool isDeleted(const PixelBuffer* frame) const
+		{
+			return deleted->count(frame) > 0;
+		}
+
+		static MediaTime pts(const int index)
+		{
+			return MediaTime(index * 25, 600);
+		}
+	};
+}
+
+TEST_CASE(frameCacheFindStopsAtAGapInTheRun)
+{
+	CacheFixture fixture(8);
+	PixelBuffer* first = fixture.insert(0);
+	PixelBuffer* second = fixture.insert(1, 0);
+	// A seek: nothing is known about the frames between 1 and 10.
+	PixelBuffer* afterSeek = fixture.insert(10);
+
+	MediaTime pts;
+	PixelBuffer* found = fixture.cache.find(fixture.streamKey, MediaTime(10, 600), pts);
+	TEST_CHECK(found == first);
+	TEST_CHECK(pts == CacheFixture::pts(0));
+	fixture.cache.release(found);
+	TEST_CHECK(fixture.cache.find(fixture.streamKey, MediaTime(100, 600), pts) == nullptr);
+	found = fixture.cache.find(fixture.streamKey, CacheFixture::pts(10), pts);
+	TEST_CHECK(found == afterSeek);
+	fixture.cache.release(found);
+	TEST_CHECK(fixture.cache.getHitCount() == 2);
+	TEST_CHECK(fixture.cache.getMissCount() == 1);
+
+	fixture.cache.release(first);
+	fixture.cache.release(second);
+	fixture.cache.release(afterSeek);
+}
+
+TEST_CASE(frameCacheNextMissesAfterEviction)
+{
+	CacheFixture fixture(2);
+	PixelBuffer* first = fixture.insert(0);
+	PixelBuffer* second = fixture.insert(1, 0);
+	PixelBuffer* third = fixture.insert(2, 1);
+	// Held frames stay even over capacity.
+	TEST_CHECK(fixture.cache.getSize() == 3 * frameBytes);
+	TEST_CHECK(fixture.isDeleted(first) == false);
+
+	fixture.cache.release(first);
+	TEST_CHECK(fixture.isDeleted(first));
+	TEST_CHECK(fixture.cache.getSize() == 2 * frameBytes);
+
+	MediaTime pts;
+	TEST_CHECK(fixture.cache.next(fixture.streamKey, CacheFixture::pts(0), pts) == nullptr);
+	PixelBuffer* next = fixture.cache.next(fixture.streamKey, CacheFixture::pts(1), pts);
+	TEST_CHECK(next == third);
+	TEST_CHECK(pts == CacheFixture::pts(2));
+	fixture.cache.release(next);
+
+	fixture.cache.release(second);
+	fixture.cache.release(third);
+}
+
+TEST_CASE(frameCacheKeepsTheFirstOfTwoDecodesOfAFrame)
+{
+	CacheFixture fixture(8);
+	PixelBuffer* previous = fixture.insert(0);
+	// Two tracks decode frame 1 at the same time.
+	PixelBuffer* first = fixture.insert(1, 0);
+	PixelBuffer* duplicate = fixture.insert(1, 0);
+	TEST_CHECK(fixture.cache.getSize() == 2 * frameBytes);
+
+	MediaTime pts;
+	PixelBuffer* found = fixture.cache.find(fixture.streamKey, CacheFixture::pts(1), pts);
+	TEST_CHECK(found == first);
+	fixture.cache.release(found);
+
+	// The duplicate is not cached, it goes with its last release.
+	fixture.cache.release(duplicate);
+	TEST_CHECK(fixture.isDeleted(duplicate));
+	TEST_CHECK(fixture.cache.contains(duplicate) == false);
+	TEST_CHECK(fixture.cache.contains(first));
+	TEST_CHECK(fixture.cache.getSize() == 2 * frameBytes);
+
+	fixture.cache.release(previous);
+	fixture.cache.release(first);
+}
+
+TEST_CASE(frameCacheEvictsOnTheLastRelease)
+{
+	CacheFixture fixture(1);
+	PixelBuffer* first = fixture.insert(0);
+	PixelBuffer* second = fixture.insert(1, 0);
+
+	MediaTime pts;
+	PixelBuffer* found = fixture.cache.find(fixture.streamKey, CacheFixture::pts(0), pts);
+	TEST_CHECK(found == first);
+	fixture.cache.release(first);
+	// Still held by the find.
+	TEST_CHECK(fixture.isDeleted(first) == false);
+	TEST_CHECK(fixture.cache.getSize() == 2 * frameBytes);
+
+	fixture.cache.release(found);
+	TEST_CHECK(fixture.isDeleted(first));
+	TEST_CHECK(fixture.cache.contains(first) == false);
+	TEST_CHECK(fixture.cache.getSize() == frameBytes);
+
+	fixture.cache.release(second);
+	TEST_CHECK(fixture.isDeleted(second) == false);
+}
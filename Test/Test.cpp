@@ -15,4 +15,74 @@
 // You should have received a copy of the GNU General Public License
 // along with VideoEditor.  If not, see <http://www.gnu.org/licenses/>.
 
-#include "Test.h"
\ No newline at end of file
+#include "Test.h"
+#include <stdio.h>
+#include <vector>
+
+namespace
+{
+	struct TestCase
+	{
+		const char* name = nullptr;
+		void (*function)() = nullptr;
+	};
+
+	std::vector<TestCase>& testCases()
+	{
+		static std::vector<TestCase> cases;
+		return cases;
+	}
+
+	unsigned int failureCount = 0;
+	bool isSkipped = false;
+}
+
+Test::Test(const char* name, void (*function)())
+{
+	TestCase testCase;
+	testCase.name = name;
+	testCase.function = function;
+	testCases().push_back(testCase);
+}
+
+int Test::run(const std::string& filter)
+{
+	unsigned int failedCaseCount = 0;
+	for (const TestCase& testCase : testCases())
+	{
+		if (std::string(testCase.name).find(filter) == std::string::npos)
+		{
+			continue;
+		}
+		const unsigned int previousFailureCount = failureCount;
+		isSkipped = false;
+		testCase.function();
+		const bool isFailed = failureCount != previousFailureCount;
+		printf("%-8s %s\n", isFailed ? "FAILED" : isSkipped ? "SKIPPED" : "ok", testCase.name);
+		if (isFailed)
+		{
+			failedCaseCount++;
+		}
+	}
+	return failedCaseCount == 0 ? 0 : 1;
+}
+
+void Test::check(const bool isPassed, const char* expression, const char* file, const int line)
+{
+	if (isPassed == false)
+	{
+		printf("%s:%d: check failed: %s\n", file, line, expression);
+		failureCount++;
+	}
+}
+
+void Test::skip(const std::string& reason)
+{
+	printf("skipping: %s\n", reason.c_str());
+	isSkipped = true;
+}
+
+int main(int argc, char** argv)
+{
+	return Test::run(argc > 1 ? argv[1] : "");
+}
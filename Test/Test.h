@@ -18,9 +18,25 @@
 #ifndef TEST_H
 #define TEST_H
 
+#include <string>
+
+// Test cases register themselves, main runs every case whose name contains its first argument.
 class Test
 {
+public:
+	Test(const char* name, void (*function)());
 
+	static int run(const std::string& filter);
+	static void check(const bool isPassed, const char* expression, const char* file, const int line);
+	// Reports the running case as skipped, which returns right after, e.g. when the media it needs is missing.
+	static void skip(const std::string& reason);
 };
 
+#define TEST_CASE(name) \
+	static void name(); \
+	static Test name##Test(#name, name); \
+	static void name()
+
+#define TEST_CHECK(expression) Test::check((expression), #expression, __FILE__, __LINE__)
+
 #endif // TEST_H
@@ -0,0 +1,162 @@
+// Copyright (C) 2021 lmc
+// 
+// This file is part of VideoEditor.
+// 
+// VideoEditor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+// 
+// VideoEditor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with VideoEditor.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include "Test.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <math.h>
+#include <mutex>
+#include <set>
+#include <stdio.h>
+#include <stdlib.h>
+#include <thread>
+#include <vector>
+#include <VideoEditor/WorkerPool.hpp>
+
+using namespace ks;
+
+namespace
+{
+	// 1, 2, 4 ... and last, so that a sweep ends at its limit.
+	std::vector<unsigned int> sweepValues(const unsigned int last)
+	{
+		std::vector<unsigned int> values;
+		for (unsigned int value = 1; value < last; value *= 2)
+		{
+			values.push_back(value);
+		}
+		values.push_back(std::max(last, 1u));
+		return values;
+	}
+}
+
+TEST_CASE(parallelForRunsEveryIndexOnce)
+{
+	WorkerPool workerPool(3);
+	std::vector<std::atomic<int>> runs(100);
+	workerPool.parallelFor(static_cast<int>(runs.size()), [&](const int index)
+	{
+		runs[index]++;
+	});
+	for (const std::atomic<int>& run : runs)
+	{
+		TEST_CHECK(run == 1);
+	}
+}
+
+TEST_CASE(parallelForKeepsToMaxThreadCount)
+{
+	WorkerPool workerPool(4);
+	for (unsigned int maxThreadCount = 1; maxThreadCount <= 3; maxThreadCount++)
+	{
+		std::mutex mutex;
+		std::set<std::thread::id> threadIDs;
+		workerPool.parallelFor(64, [&](const int index)
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			std::lock_guard<std::mutex> lock(mutex);
+			threadIDs.insert(std::this_thread::get_id());
+		}, maxThreadCount);
+		TEST_CHECK(threadIDs.size() <= maxThreadCount);
+		if (maxThreadCount == 1)
+		{
+			TEST_CHECK(threadIDs.count(std::this_thread::get_id()) == 1);
+		}
+	}
+}
+
+TEST_CASE(nestedParallelForFinishesWithEveryThreadBusy)
+{
+	// Loads run tracks on the pool while the tracks' conversions split their rows on the same pool.
+	WorkerPool workerPool(2);
+	std::atomic<int> rows = 0;
+	workerPool.parallelFor(8, [&](const int track)
+	{
+		workerPool.parallelFor(16, [&](const int row)
+		{
+			rows++;
+		});
+	});
+	TEST_CHECK(rows == 8 * 16);
+}
+
+TEST_CASE(sharedPoolIsOnePool)
+{
+	TEST_CHECK(&WorkerPool::shared() == &WorkerPool::shared());
+	TEST_CHECK(WorkerPool::shared().getThreadCount() == WorkerPool::defaultThreadCount());
+}
+
+// Time per frame of a compositor-like load while decode-ahead-like tasks keep the pool busy,
+// for each pool size, track count up to twice the cores and loader budget.
+// Set VIDEOEDITOR_TEST_BENCHMARK to run it.
+TEST_CASE(threadBudgetSweep)
+{
+	if (getenv("VIDEOEDITOR_TEST_BENCHMARK") == nullptr)
+	{
+		Test::skip("VIDEOEDITOR_TEST_BENCHMARK is not set");
+		return;
+	}
+	const auto work = [](const int amount)
+	{
+		volatile double sum = 0;
+		for (int i = 0; i < amount; i++)
+		{
+			sum = sum + sqrt(static_cast<double>(i));
+		}
+	};
+
+	const unsigned int coreCount = std::max(std::thread::hardware_concurrency(), 1u);
+	const int frameCount = 20;
+	printf("%u cores\n", coreCount);
+	for (const unsigned int threadCount : sweepValues(coreCount))
+	{
+		WorkerPool workerPool(threadCount);
+		for (const unsigned int trackCount : sweepValues(2 * coreCount))
+		{
+			for (const unsigned int budget : sweepValues(threadCount + 1))
+			{
+				std::atomic<int> backgroundCount = 0;
+				const auto begin = std::chrono::steady_clock::now();
+				for (int frame = 0; frame < frameCount; frame++)
+				{
+					backgroundCount++;
+					workerPool.dispatch([&]()
+					{
+						work(200000);
+						backgroundCount--;
+					});
+					workerPool.parallelFor(static_cast<int>(trackCount), [&](const int track)
+					{
+						work(100000);
+					}, budget);
+					workerPool.parallelFor(16, [&](const int band)
+					{
+						work(20000);
+					});
+				}
+				const double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+				while (backgroundCount > 0)
+				{
+					std::this_thread::yield();
+				}
+				printf("threads %u, tracks %u, budget %u: %.2f ms per frame\n", threadCount, trackCount, budget, milliseconds / frameCount);
+			}
+		}
+	}
+}
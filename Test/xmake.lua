@@ -0,0 +1,21 @@
+set_xmakever("2.6.3")
+
+includes("../../Foundation/Foundation")
+includes("../../KSMediaCodec/KSMediaCodec")
+includes("../VideoEditor")
+add_requires("spdlog")
+
+-- xmake run VideoEditorTest [name filter]
+target("VideoEditorTest")
+    set_kind("binary")
+    set_languages("cxx17")
+    add_files("*.cpp")
+    add_headerfiles("*.h")
+    add_rules("mode.debug", "mode.release")
+    add_packages("spdlog")
+    add_deps("VideoEditor")
+    add_deps("Foundation")
+    add_deps("KSMediaCodec")
+    if is_plat("windows") then
+        add_syslinks("ws2_32")
+    end
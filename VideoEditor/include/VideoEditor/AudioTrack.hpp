@@ -18,6 +18,7 @@
 #ifndef VideoEditor_AudioTrack_hpp
 #define VideoEditor_AudioTrack_hpp
 
+#include <memory>
 #include <mutex> 
 #include <vector>
 #include <string>
@@ -25,6 +26,8 @@
 #include <KSMediaCodec/KSMediaCodec.hpp>
 #include "RenderContext.hpp"
 #include "MediaTrack.hpp"
+#include "MediaInput.hpp"
+#include "DecoderRegistry.hpp"
 
 namespace ks
 {
@@ -34,7 +37,7 @@ namespace ks
 		AudioPCMBuffer* pcmBuffer = nullptr;
 	};
 
-	class FAudioTrack : public IMediaTrack
+	class FAudioTrack : public IMediaTrack, public IDecoderOwner
 	{
 	public:
 		FAudioTrack();
@@ -42,6 +45,8 @@ namespace ks
 
 	public:
 		std::string filePath;
+		// Shared with the other tracks of the project, audio decoders count against its capacity as well.
+		std::shared_ptr<DecoderRegistry> decoderRegistry;
 
 	public:
 		virtual void prepare(const AudioRenderContext& renderContext);
@@ -50,12 +55,26 @@ namespace ks
 		virtual void onSeeking(const MediaTime& time);
 		virtual void samples(const MediaTimeRange& timeRange, AudioPCMBuffer* outAudioPCMBuffer);
 
+		virtual bool tryCloseDecoder() override;
+
+		const DecodeLatencyStatistics& getDecodeLatency() const;
+
 	private:
 		std::vector<AudioPCMBufferQueueItem> bufferQueue;
 		AudioDecoder* decoder = nullptr;
 		AudioFormat outputAudioFormat;
 		MediaTime time;
+		MediaTime seekTime;
+		bool isSeekPending = false;
+		// End of the last decoded samples, a reopened decoder seeks there.
+		MediaTime decodedEnd;
+		bool hasDecodedEnd = false;
+		bool isPrepared = false;
 		std::mutex decoderMutex;
+
+		bool openDecoder();
+		void closeDecoder();
+		DecodeLatencyStatistics decodeLatency;
 	};
 }
 
@@ -0,0 +1,56 @@
+// Copyright (C) 2021 lmc
+// 
+// This file is part of VideoEditor.
+// 
+// VideoEditor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+// 
+// VideoEditor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with VideoEditor.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef VideoEditor_DecodePlan_hpp
+#define VideoEditor_DecodePlan_hpp
+
+#include <Foundation/Foundation.hpp>
+#include <KSMediaCodec/KSMediaCodec.hpp>
+
+namespace ks
+{
+	// Which decoded frames of a clip are ever shown, derived from its time mapping and the output frame duration.
+	// Output frames sit at multiples of frameDuration, see getFrameDuration, and each shows the source frame covering it,
+	// see FrameRing::frameAt, so a frame is shown only if an output time falls between its display time and the next frame's.
+	// Fast-forward clips and sources above the output rate leave most frames unshown.
+	class DecodePlan
+	{
+	public:
+		DecodePlan() = default;
+		DecodePlan(const MediaTimeMapping& timeMapping, const MediaTime& frameDuration);
+
+		bool isEmpty() const;
+		// Whether a frame displayed at displayTime is shown when the frame decoded after it is displayed at nextDisplayTime.
+		bool isShown(const MediaTime& displayTime, const MediaTime& nextDisplayTime) const;
+		// The first output time of the clip after displayTime, false past its end.
+		bool nextTime(const MediaTime& displayTime, MediaTime& outTime) const;
+
+	private:
+		// Display times come rounded to 1/600, frames closer than this to an output time count as on it.
+		static constexpr double tolerance = 1e-4;
+
+		MediaTime frameDuration = MediaTime::zero;
+		double start = 0.0;
+		double end = 0.0;
+
+		// The first output frame at or after time, counted from composition time zero.
+		bool firstIndex(const double time, long long& outIndex) const;
+	};
+}
+
+#endif // VideoEditor_DecodePlan_hpp
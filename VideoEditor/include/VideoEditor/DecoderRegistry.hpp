@@ -0,0 +1,64 @@
+// Copyright (C) 2021 lmc
+// 
+// This file is part of VideoEditor.
+// 
+// VideoEditor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+// 
+// VideoEditor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with VideoEditor.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef VideoEditor_DecoderRegistry_hpp
+#define VideoEditor_DecoderRegistry_hpp
+
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <Foundation/Foundation.hpp>
+
+namespace ks
+{
+	// A video or audio track whose decoder the registry may close.
+	class IDecoderOwner
+	{
+	public:
+		virtual ~IDecoderOwner() = default;
+
+		// Closes the decoder unless the track is busy, the track reopens it where it left off.
+		virtual bool tryCloseDecoder() = 0;
+	};
+
+	// Keeps at most capacity video and audio decoders open across a project, the least recently used ones are closed.
+	// A track busy on another thread is skipped, it reopens its decoder where it left off the next time it is used.
+	// Decoders of remote media reading through cache: are never closed, their download would go with them.
+	class DecoderRegistry : public noncopyable
+	{
+	public:
+		DecoderRegistry(const unsigned int capacity);
+		~DecoderRegistry();
+
+		void opened(IDecoderOwner* track);
+		void used(IDecoderOwner* track);
+		void closed(IDecoderOwner* track);
+		// Raises capacity to count, e.g. to the decoders one instruction and the one prewarmed after it use at once,
+		// below that the tracks of the frame being loaded would close each other's decoders.
+		void reserve(const unsigned int count);
+		unsigned int getCapacity() const;
+
+	private:
+		unsigned int capacity;
+		// Most recently used last.
+		std::list<IDecoderOwner*> tracks;
+		std::unordered_map<IDecoderOwner*, std::list<IDecoderOwner*>::iterator> positions;
+		mutable std::mutex registryMutex;
+	};
+}
+
+#endif // VideoEditor_DecoderRegistry_hpp
@@ -19,10 +19,12 @@
 #define VideoEditor_ExportSession_hpp
 
 #include <string>
+#include <vector>
 #include <Foundation/Foundation.hpp>
 #include <KSMediaCodec/KSMediaCodec.hpp>
 #include "VideoDescription.hpp"
 #include "ImageCompositionPipeline.hpp"
+#include "SourceFrameLoader.hpp"
 
 namespace ks
 {
@@ -42,8 +44,10 @@ namespace ks
 			std::function<void(const ExportSession::EncodeType& type, const MediaTime& time)> progressCallback);
 
 	private:
+		const unsigned int compositionBatchSize = 4;
 		const VideoDescription *videoDescription = nullptr;
 		ImageCompositionPipeline *imageCompositionPipeline = nullptr;
+		SourceFrameLoader sourceFrameLoader;
 	};
 }
 
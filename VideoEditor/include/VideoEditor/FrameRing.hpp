@@ -0,0 +1,65 @@
+// Copyright (C) 2021 lmc
+// 
+// This file is part of VideoEditor.
+// 
+// VideoEditor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+// 
+// VideoEditor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with VideoEditor.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef VideoEditor_FrameRing_hpp
+#define VideoEditor_FrameRing_hpp
+
+#include <vector>
+#include <Foundation/Foundation.hpp>
+#include <KSMediaCodec/KSMediaCodec.hpp>
+#include "ImageTrack.hpp"
+
+namespace ks
+{
+	// Decoded frames of a track in display order.
+	// A ring, so trimming the front moves nothing, that only reallocates when it is full.
+	// Frames are looked up by the time they cover, from their display time up to the next frame's.
+	class FrameRing
+	{
+	public:
+		FrameRing(const size_t capacity);
+
+		bool isEmpty() const;
+		size_t getCount() const;
+		const SourceFrame& operator[](const size_t index) const;
+		const SourceFrame& front() const;
+		const SourceFrame& back() const;
+
+		void pushBack(const SourceFrame& frame);
+		void popFront();
+		void clear();
+
+		// Index of the frame covering time, the last one displayed at or before it, or -1 when all come later.
+		int frameAt(const MediaTime& time) const;
+		// Frames displayed after time.
+		size_t countAfter(const MediaTime& time) const;
+
+	private:
+		// Display times are rounded to 1/600, anything closer counts as the same time.
+		static constexpr double tolerance = 1e-6;
+
+		std::vector<SourceFrame> frames;
+		size_t head = 0;
+		size_t count = 0;
+
+		// Index of the first frame displayed after time.
+		size_t upperBound(const double time) const;
+	};
+}
+
+#endif // VideoEditor_FrameRing_hpp
@@ -0,0 +1,79 @@
+// Copyright (C) 2021 lmc
+// 
+// This file is part of VideoEditor.
+// 
+// VideoEditor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+// 
+// VideoEditor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with VideoEditor.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef VideoEditor_GeneratorTrack_hpp
+#define VideoEditor_GeneratorTrack_hpp
+
+#include <array>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <Foundation/Foundation.hpp>
+#include <KSMediaCodec/KSMediaCodec.hpp>
+#include "ImageTrack.hpp"
+#include "PixelKernels.hpp"
+
+namespace ks
+{
+	// Mattes, gradients and colour bars, rendered once per render size and handed out as the same frame.
+	class GeneratorTrack : public IImageTrack
+	{
+	public:
+		enum class Type
+		{
+			solid,
+			horizontalGradient,
+			verticalGradient,
+			testPattern
+		};
+
+		GeneratorTrack();
+		~GeneratorTrack();
+
+		Type type = Type::solid;
+		// Solid uses the first colour, gradients go from the first to the second.
+		std::array<unsigned char, 4> colors[2] = { { 0, 0, 0, 255 }, { 255, 255, 255, 255 } };
+
+	private:
+		// Shared with the handles to image, a re-render leaves the image they hold alone.
+		// image lives in pixelBufferPool when it was converted, in rgbaPixelBufferPool otherwise.
+		std::shared_ptr<PixelBufferPool> pixelBufferPool;
+		std::shared_ptr<PixelBufferPool> rgbaPixelBufferPool;
+		PixelBuffer *image = nullptr;
+		int imageWidth = 0;
+		int imageHeight = 0;
+		PixelBuffer::FormatType imageFormat = PixelBuffer::FormatType::rgba8;
+		std::mutex generatorMutex;
+
+		void render(const VideoRenderContext & renderContext);
+		void renderRGBA8(const PixelPlane & plane) const;
+
+	public:
+		virtual const PixelBuffer * sourceFrame(const MediaTime & compositionTime, const VideoRenderContext & renderContext) override;
+		virtual MediaTime sourceFrameDisplayTime(const MediaTime & compositionTime) override;
+		virtual SourceFrameHandle retainSourceFrame(const MediaTime & compositionTime, const VideoRenderContext & renderContext) override;
+		virtual const PixelBuffer * compositionImage(const PixelBuffer & sourceFrame, const MediaTime & compositionTime, const VideoRenderContext & renderContext) override;
+		virtual PixelBuffer::FormatType compositionImageFormat(const VideoRenderContext & renderContext) const override;
+		virtual bool isOpaque() const override;
+		virtual void prepare(const VideoRenderContext & renderContext) override;
+		virtual void onSeeking(const MediaTime & compositionTime) override;
+		virtual void flush(const MediaTime & compositionTime) override;
+		virtual void flush() override;
+	};
+}
+
+#endif // VideoEditor_GeneratorTrack_hpp
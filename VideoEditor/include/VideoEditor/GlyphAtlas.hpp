@@ -0,0 +1,54 @@
+// Copyright (C) 2021 lmc
+// 
+// This file is part of VideoEditor.
+// 
+// VideoEditor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+// 
+// VideoEditor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with VideoEditor.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef VideoEditor_GlyphAtlas_hpp
+#define VideoEditor_GlyphAtlas_hpp
+
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace ks
+{
+	// Coverage of the printable ascii glyphs rasterized once for one glyph size.
+	// Glyphs are square cells side by side in a single 8 bit row strip.
+	class GlyphAtlas
+	{
+	public:
+		static std::shared_ptr<GlyphAtlas> shared(const int glyphSize);
+
+		GlyphAtlas(const int glyphSize);
+
+		int getGlyphSize() const;
+		// Row y of the glyph of a character, nullptr for characters outside the atlas.
+		const unsigned char* glyphRow(const char character, const int y) const;
+
+	private:
+		static const char firstCharacter = 0x20;
+		static const char lastCharacter = 0x7E;
+
+		int glyphSize = 0;
+		int bytesPerRow = 0;
+		std::vector<unsigned char> coverage;
+
+		static std::mutex sharedMutex;
+		static std::unordered_map<int, std::weak_ptr<GlyphAtlas>> sharedAtlases;
+	};
+}
+
+#endif // VideoEditor_GlyphAtlas_hpp
@@ -20,8 +20,15 @@
 
 #include <unordered_map>
 #include <functional>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <vector>
 #include "RenderContext.hpp"
 #include "VideoInstruction.hpp"
+#include "PixelKernels.hpp"
+#include "RGBAFrameCache.hpp"
+#include "WorkerPool.hpp"
 
 namespace ks
 {
@@ -29,10 +36,57 @@ namespace ks
 	{
 		MediaTime compositionTime = MediaTime::zero;
 		std::unordered_map<unsigned int, const PixelBuffer*> sourceFrames;
+		// Keep sourceFrames alive while the request is queued, whatever the tracks flush.
+		std::unordered_map<unsigned int, SourceFrameHandle> sourceFrameHandles;
+		std::unordered_map<unsigned int, MediaTime> sourceFrameDisplayTimes;
 		//PixelBuffer* pixelBuffer = nullptr;
 		std::function<PixelBuffer*()> getPixelBuffer;
 		VideoInstruction instruction;
 		const VideoRenderContext* videoRenderContext = nullptr;
+		PixelBuffer::FormatType pixelBufferFormat = PixelBuffer::FormatType::rgba8;
+		bool isLowLatency = false;
+	};
+
+	struct CompositionLayer
+	{
+		const PixelBuffer* sourceFrame = nullptr;
+		PixelBuffer::FormatType format = PixelBuffer::FormatType::rgba8;
+		PixelRect rect;
+		// Set when the layer is a transition, sourceFrame is then the frame it leaves.
+		const PixelBuffer* transitionFrame = nullptr;
+		VideoTransitionType transitionType = VideoTransitionType::crossDissolve;
+		float transitionProgress = 0.0f;
+	};
+
+	struct CompositionBand
+	{
+		int rowBegin = 0;
+		int rowEnd = 0;
+		std::vector<size_t> layers;
+	};
+
+	struct CompositionSource
+	{
+		unsigned int trackID = 0;
+		const PixelBuffer* sourceFrame = nullptr;
+		MediaTime displayTime = MediaTime::zero;
+		PixelRect rect;
+	};
+
+	struct CompositionMemo
+	{
+		const VideoRenderContext* videoRenderContext = nullptr;
+		PixelBuffer::FormatType pixelBufferFormat = PixelBuffer::FormatType::rgba8;
+		bool isLowLatency = false;
+		std::vector<CompositionSource> sources;
+		// The pool the output was taken from, outputs are only handed out again to requests drawing from it.
+		const PixelBufferPool* outputPool = nullptr;
+		// Transitions change the output while the frames stay the same.
+		MediaTime transitionTime = MediaTime::zero;
+		std::function<PixelBuffer*()> getPixelBuffer;
+		// Which output it was, counted over every request that took a new one.
+		unsigned long long outputSerial = 0;
+		unsigned long long lastUsed = 0;
 	};
 
 	class ImageCompositionPipeline
@@ -41,7 +95,66 @@ namespace ks
 		ImageCompositionPipeline();
 		~ImageCompositionPipeline();
 
-		virtual void composition(AsyncImageCompositionRequest& request, std::function<PixelBuffer*()> getPixelBuffer);
+		// getPixelBuffer takes its buffers from outputPool. Without an outputPool no output is reused.
+		virtual void composition(AsyncImageCompositionRequest& request,
+			std::function<PixelBuffer*()> getPixelBuffer,
+			const PixelBufferPool* outputPool = nullptr);
+		// Requests of one batch are rendered together the first time any of them is asked for its pixel buffer,
+		// so getPixelBuffer must be able to hand out requests.size() buffers at once.
+		virtual void batchComposition(std::vector<AsyncImageCompositionRequest>& requests,
+			std::function<PixelBuffer*()> getPixelBuffer,
+			const PixelBufferPool* outputPool = nullptr);
+
+		// Forgets every earlier output. Called before the pool they were taken from goes away.
+		void flush();
+		unsigned int getReusedFrameCount() const;
+
+		// Requests repeating an earlier composition get that request's output instead of a new one.
+		// Pools behind getPixelBuffer only recycle a buffer once as many more were taken as they hold,
+		// so they are sized for the requests in flight plus spareOutputCount, and an output is handed out
+		// again only while fewer than spareOutputCount newer outputs were taken after it.
+		static const unsigned int spareOutputCount = 1;
+
+	private:
+		const unsigned int memoCapacity = 8;
+		std::unordered_map<double, CompositionMemo> memos;
+		unsigned long long outputSerial = 0;
+		unsigned long long memoClock = 0;
+		std::mutex memosMutex;
+		std::atomic<unsigned int> reusedFrameCount = 0;
+
+		CompositionMemo makeMemo(const AsyncImageCompositionRequest& request) const;
+		static bool isSameComposition(const CompositionMemo& lhs, const CompositionMemo& rhs);
+		static bool isBandedComposition(const AsyncImageCompositionRequest& request, PixelBuffer::FormatType& outWorkingFormat);
+		static size_t firstVisibleTrack(const AsyncImageCompositionRequest& request);
+
+		const int bandRowAlignment = 16;
+		WorkerPool* workerPool = nullptr;
+
+		std::unique_ptr<PixelBufferPool> scratchPool;
+		int scratchWidth = 0;
+		int scratchHeight = 0;
+		unsigned int scratchCapacity = 0;
+		PixelBuffer::FormatType scratchFormat = PixelBuffer::FormatType::rgba8;
+		std::mutex scratchMutex;
+
+		void compose(const std::vector<AsyncImageCompositionRequest*>& requests,
+			std::function<PixelBuffer*()> getPixelBuffer,
+			const PixelBufferPool* outputPool);
+		void renderBatch(const std::vector<AsyncImageCompositionRequest>& requests, const std::vector<PixelBuffer*>& pixelBuffers);
+		// yuv420p sources are converted through rgbaFrames where the stage only reads rgba8, once per batch.
+		void compositionFilters(const AsyncImageCompositionRequest& request, PixelBuffer& pixelBuffer, RGBAFrameCache& rgbaFrames);
+		std::vector<CompositionLayer> compositionLayers(const AsyncImageCompositionRequest& request,
+			const PixelBuffer::FormatType workingFormat,
+			RGBAFrameCache& rgbaFrames) const;
+		std::vector<CompositionBand> compositionBands(const std::vector<CompositionLayer>& layers, const int height) const;
+		static void renderBand(const std::vector<CompositionLayer>& layers,
+			const CompositionBand& band,
+			PixelBuffer& workingPixelBuffer,
+			const PixelBuffer::FormatType workingFormat,
+			PixelBuffer* outputPixelBuffer);
+		static PixelBlend transitionBlend(const CompositionLayer& layer, const PixelBuffer::FormatType format, const int planeIndex, const int width);
+		std::vector<PixelBuffer*> scratchPixelBuffers(const int width, const int height, const PixelBuffer::FormatType format, const unsigned int count);
 	};
 }
 
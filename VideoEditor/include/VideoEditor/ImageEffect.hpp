@@ -0,0 +1,132 @@
+// Copyright (C) 2021 lmc
+//
+// This file is part of VideoEditor.
+//
+// VideoEditor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// VideoEditor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with VideoEditor.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef VideoEditor_ImageEffect_hpp
+#define VideoEditor_ImageEffect_hpp
+
+#include <array>
+#include <memory>
+#include <string>
+#include <vector>
+#include <Foundation/Foundation.hpp>
+#include <KSMediaCodec/KSMediaCodec.hpp>
+#include "PixelKernels.hpp"
+
+namespace ks
+{
+	// Effects work on rgba8 frames.
+	// Point effects map every pixel on its own and are fused row by row with their neighbours,
+	// other effects read a whole plane and write it back through a scratch plane.
+	class IImageEffect
+	{
+	public:
+		virtual ~IImageEffect() = default;
+		virtual bool isPointEffect() const = 0;
+		// Affine point effects report their 3x4 row major matrix, normalized to [0, 1], so that runs of them fold into one.
+		virtual bool colorMatrix(std::array<float, 12>& outMatrix) const { return false; }
+		virtual void processRow(unsigned char* rgba, const int width) const { }
+		virtual void process(const PixelPlane& plane) const { }
+	};
+
+	class ColorMatrixEffect : public IImageEffect
+	{
+	public:
+		ColorMatrixEffect(const std::array<float, 12>& matrix);
+
+		virtual bool isPointEffect() const override;
+		virtual bool colorMatrix(std::array<float, 12>& outMatrix) const override;
+		virtual void processRow(unsigned char* rgba, const int width) const override;
+
+		static std::array<float, 12> identity();
+		static std::array<float, 12> concat(const std::array<float, 12>& first, const std::array<float, 12>& second);
+
+	private:
+		std::array<float, 12> matrix;
+	};
+
+	class BrightnessContrastEffect : public ColorMatrixEffect
+	{
+	public:
+		BrightnessContrastEffect(const float brightness, const float contrast);
+
+	private:
+		static std::array<float, 12> makeMatrix(const float brightness, const float contrast);
+	};
+
+	class LUT3DEffect : public IImageEffect
+	{
+	public:
+		static LUT3DEffect* New(const std::string& cubeFilePath);
+
+		virtual bool isPointEffect() const override;
+		virtual void processRow(unsigned char* rgba, const int width) const override;
+
+	private:
+		LUT3DEffect() = default;
+		int size = 0;
+		std::vector<float> table;
+	};
+
+	class BoxBlurEffect : public IImageEffect
+	{
+	public:
+		BoxBlurEffect(const int radius);
+
+		virtual bool isPointEffect() const override;
+		virtual void process(const PixelPlane& plane) const override;
+
+		static void blur(const PixelPlane& plane, const int radius, std::vector<unsigned char>& scratch, std::vector<unsigned int>& sums);
+
+	private:
+		int radius = 0;
+	};
+
+	class GaussianBlurEffect : public IImageEffect
+	{
+	public:
+		GaussianBlurEffect(const float sigma);
+
+		virtual bool isPointEffect() const override;
+		virtual void process(const PixelPlane& plane) const override;
+
+	private:
+		// Three box passes approximate the gaussian.
+		std::array<int, 3> radii;
+	};
+
+	class ImageEffectChain
+	{
+	public:
+		void append(std::shared_ptr<IImageEffect> effect);
+		bool isEmpty() const;
+		void apply(PixelBuffer& pixelBuffer) const;
+
+	private:
+		struct Stage
+		{
+			std::vector<std::shared_ptr<IImageEffect>> pointEffects;
+			std::shared_ptr<IImageEffect> planeEffect;
+		};
+
+		std::vector<std::shared_ptr<IImageEffect>> effects;
+		std::vector<Stage> stages;
+
+		void compile();
+	};
+}
+
+#endif // VideoEditor_ImageEffect_hpp
\ No newline at end of file
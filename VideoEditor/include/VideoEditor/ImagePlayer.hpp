@@ -28,6 +28,7 @@
 #include <KSRenderEngine/KSRenderEngine.hpp>
 #include "VideoDescription.hpp"
 #include "ImageCompositionPipeline.hpp"
+#include "SourceFrameLoader.hpp"
 
 namespace ks
 {
@@ -57,12 +58,14 @@ namespace ks
 		mutable ks::PixelBuffer* cachePixelBuffer = nullptr;
 		ImageCompositionPipeline* pipeline = nullptr;
 		std::vector<AsyncImageCompositionRequest> requests;
+		SourceFrameLoader sourceFrameLoader;
 		ks::IRenderEngine* renderEngine = nullptr;
 		PixelBufferPool* pixelBufferPool = nullptr;
 		MediaTime currentTime = MediaTime::zero;
 		MediaTime videoDuration = MediaTime::zero;
 		const int timeScale = 600;
 		const unsigned int cacheSize = 30;
+		const unsigned int compositionBatchSize = 4;
 		const VideoDescription* videoDescription = nullptr;
 		VideoRenderContext videoRenderContext;
 		SimpleTimer* timer = nullptr;
@@ -0,0 +1,103 @@
+// Copyright (C) 2021 lmc
+// 
+// This file is part of VideoEditor.
+// 
+// VideoEditor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+// 
+// VideoEditor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with VideoEditor.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef VideoEditor_ImageSequenceTrack_hpp
+#define VideoEditor_ImageSequenceTrack_hpp
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <Foundation/Foundation.hpp>
+#include <KSMediaCodec/KSMediaCodec.hpp>
+#include "ImageTrack.hpp"
+#include "WorkerPool.hpp"
+
+namespace ks
+{
+	// Numbered image files, e.g. shot_%04d.exr, mapped to source time at frameRate.
+	// Every file decodes on its own, so the frames ahead of the playhead are decoded in parallel.
+	class ImageSequenceTrack : public IImageTrack
+	{
+	public:
+		ImageSequenceTrack();
+		~ImageSequenceTrack();
+
+		// printf style pattern with exactly one integer conversion for the frame number, e.g. %04d.
+		// %% and any other % are literal, so URL escapes like %20 need no doubling.
+		std::string filePattern;
+		int firstFrameNumber = 0;
+		float frameRate = 24.0f;
+		unsigned int lookAhead = 8;
+		// Prefetch stops once the decoded frames would take more than this.
+		size_t memoryCapacity = 512 * 1024 * 1024;
+		// Look-ahead decodes queued on WorkerPool::shared() at once, 0 prefetches nothing.
+		unsigned int decodeThreadCount = WorkerPool::defaultThreadCount();
+
+	private:
+		struct Frame
+		{
+			PixelBuffer *pixelBuffer = nullptr;
+			bool isDecoding = true;
+			// Taken by the thread decoding it, until then whoever needs the frame first decodes it.
+			bool isClaimed = false;
+			unsigned int generation = 0;
+		};
+
+		std::map<int, Frame> frames;
+		// Bumped on seek so that decodes still in flight are dropped when they finish.
+		unsigned int generation = 0;
+		int firstKeptFrameNumber = 0;
+		size_t frameBytes = 0;
+		// Frames released while a handle still holds them are freed by the last handle.
+		std::unordered_map<const PixelBuffer *, unsigned int> retainCounts;
+		std::vector<PixelBuffer *> detachedFrames;
+		MediaTime lastSourceFrameDisplayTime;
+		// filePattern with every % but the frame number's escaped, empty when the pattern is invalid.
+		std::string framePathFormat;
+		bool isStopping = false;
+		unsigned int queuedDecodeCount = 0;
+		std::mutex framesMutex;
+		std::condition_variable framesCondition;
+
+		int frameNumber(const MediaTime & compositionTime) const;
+		MediaTime frameDisplayTime(const int frameNumber) const;
+		std::string framePath(const int frameNumber) const;
+		static bool makeFramePathFormat(const std::string & pattern, std::string & outFormat);
+		void prefetch(const int frameNumber);
+		void decodeFrame(const int frameNumber, const unsigned int frameGeneration);
+		void releaseFrames(const int endFrameNumber);
+		const PixelBuffer * currentFrame(const int frameNumber, std::unique_lock<std::mutex>& lock);
+		void releaseRetainedFrame(const PixelBuffer * frame);
+
+	public:
+		virtual const PixelBuffer * sourceFrame(const MediaTime & compositionTime, const VideoRenderContext & renderContext) override;
+		virtual MediaTime sourceFrameDisplayTime(const MediaTime & compositionTime) override;
+		virtual SourceFrameHandle retainSourceFrame(const MediaTime & compositionTime, const VideoRenderContext & renderContext) override;
+		virtual const PixelBuffer * compositionImage(const PixelBuffer & sourceFrame, const MediaTime & compositionTime, const VideoRenderContext & renderContext) override;
+		virtual PixelBuffer::FormatType compositionImageFormat(const VideoRenderContext & renderContext) const override;
+		virtual void prepare(const VideoRenderContext & renderContext) override;
+		virtual void onSeeking(const MediaTime & compositionTime) override;
+		virtual void flush(const MediaTime & compositionTime) override;
+		virtual void flush() override;
+	};
+}
+
+#endif // VideoEditor_ImageSequenceTrack_hpp
@@ -18,7 +18,9 @@
 #ifndef VideoEditor_ImageTrack_hpp
 #define VideoEditor_ImageTrack_hpp
 
+#include <memory>
 #include <string>
+#include <vector>
 #include <Foundation/Foundation.hpp>
 #include <KSMediaCodec/KSMediaCodec.hpp>
 #include <KSImage/KSImage.hpp>
@@ -27,16 +29,51 @@
 
 namespace ks
 {
+	struct SourceFrame
+	{
+		PixelBuffer * sourceFrame = nullptr;
+		MediaTime displayTime;
+	};
+
+	// Keeps a source frame alive for as long as it is held, whatever the track flushes meanwhile.
+	// Handles must be dropped before their track is destroyed.
+	typedef std::shared_ptr<const PixelBuffer> SourceFrameHandle;
+
+	struct SourceFrameWindow
+	{
+		MediaTime compositionTime;
+		// Ordered by display time, frames[currentIndex] is the frame sourceFrame returns for compositionTime.
+		std::vector<SourceFrame> frames;
+		int currentIndex = -1;
+	};
+
 	class IImageTrack : public IMediaTrack
 	{
 	public:
 		ks::Rect rect;
+		// Drawn over tracks of lower layers, tracks of one layer in the order they were added.
+		int layer = 0;
 
 	public:
 		virtual ~IImageTrack() = 0 {};
 		virtual const PixelBuffer *sourceFrame(const MediaTime& compositionTime, const VideoRenderContext& renderContext) = 0;
+		virtual MediaTime sourceFrameDisplayTime(const MediaTime& compositionTime) { return compositionTime; }
+		// sourceFrame as a handle that keeps the frame alive, even when the track re-renders or flushes it meanwhile.
+		virtual SourceFrameHandle retainSourceFrame(const MediaTime& compositionTime, const VideoRenderContext& renderContext) = 0;
+		// Frames of the window stay valid until releaseSourceFrameWindow, whatever flush is called meanwhile.
+		virtual bool retainSourceFrameWindow(const MediaTime& compositionTime,
+			const unsigned int before,
+			const unsigned int after,
+			const VideoRenderContext& renderContext,
+			SourceFrameWindow& outWindow) { return false; }
+		virtual void releaseSourceFrameWindow(const SourceFrameWindow& window) { }
 		virtual const PixelBuffer *compositionImage(const PixelBuffer& sourceFrame, const MediaTime& compositionTime, const VideoRenderContext& renderContext) = 0;
+		virtual PixelBuffer::FormatType compositionImageFormat(const VideoRenderContext& renderContext) const { return renderContext.format; }
+		// Opaque tracks cover everything below them inside their rect.
+		virtual bool isOpaque() const { return false; }
 		virtual void prepare(const VideoRenderContext& renderContext) = 0;
+		// The playhead is about to enter the track, costly setup may start now.
+		virtual void prewarm(const VideoRenderContext& renderContext) { }
 		virtual void onSeeking(const MediaTime& compositionTime) = 0;
 		virtual void flush(const MediaTime& compositionTime) = 0;
 		virtual void flush() = 0;
@@ -0,0 +1,60 @@
+// Copyright (C) 2021 lmc
+// 
+// This file is part of VideoEditor.
+// 
+// VideoEditor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+// 
+// VideoEditor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with VideoEditor.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef VideoEditor_MappedFile_hpp
+#define VideoEditor_MappedFile_hpp
+
+#include <stddef.h>
+#include <string>
+
+namespace ks
+{
+	// A whole file mapped read only.
+	class MappedFile
+	{
+	public:
+		enum class Advice
+		{
+			normal,
+			sequential,
+			willNeed,
+			dontNeed
+		};
+
+		static MappedFile* New(const std::string& filePath);
+		~MappedFile();
+
+		const unsigned char* data() const;
+		size_t size() const;
+		// A hint only, offset and length need no page alignment.
+		void advise(const size_t offset, const size_t length, const Advice advice) const;
+
+	private:
+		MappedFile() = default;
+
+		const unsigned char* bytes = nullptr;
+		size_t length = 0;
+#ifdef _WIN32
+		void* fileHandle = nullptr;
+		void* mappingHandle = nullptr;
+#else
+		int fileDescriptor = -1;
+#endif
+	};
+}
+
+#endif // VideoEditor_MappedFile_hpp
@@ -0,0 +1,88 @@
+// Copyright (C) 2021 lmc
+// 
+// This file is part of VideoEditor.
+// 
+// VideoEditor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+// 
+// VideoEditor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with VideoEditor.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef VideoEditor_MediaIndex_hpp
+#define VideoEditor_MediaIndex_hpp
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <Foundation/Foundation.hpp>
+#include <KSMediaCodec/KSMediaCodec.hpp>
+
+namespace ks
+{
+	// Keyframes of a media file, learned from the seeks its decoders made.
+	// A seek restarts decoding at the keyframe at or before its target,
+	// so the first pts after a seek is a keyframe and no other keyframe lies between it and the target.
+	class MediaIndex : public noncopyable
+	{
+	public:
+		MediaIndex(const std::string& filePath);
+
+		// pts is the first frame a decoder returned after seeking to target.
+		void recordSeek(const MediaTime& target, const MediaTime& pts);
+		// The keyframe a seek to time lands on, false when no recorded seek covers time.
+		bool keyframeBefore(const MediaTime& time, MediaTime& outKeyframe) const;
+
+	private:
+		friend class MediaIndexCache;
+
+		struct Keyframe
+		{
+			MediaTime pts;
+			// The latest time known to seek to this keyframe.
+			double coveredUntil = 0.0;
+		};
+
+		const std::string filePath;
+		long long fileSize = -1;
+		long long fileModified = -1;
+		// By pts in seconds.
+		std::map<double, Keyframe> keyframes;
+		bool isDirty = false;
+		mutable std::mutex indexMutex;
+	};
+
+	// Media indexes kept as one json file per media file in directory, so that they outlive the project.
+	// A file is known by path, size and modification time, the index of a changed file starts over empty.
+	class MediaIndexCache : public noncopyable
+	{
+	public:
+		MediaIndexCache(const std::string& directory);
+		// Saves what changed.
+		~MediaIndexCache();
+
+		std::shared_ptr<MediaIndex> index(const std::string& filePath);
+		void save();
+
+	private:
+		const std::string directory;
+		std::unordered_map<std::string, std::shared_ptr<MediaIndex>> indexes;
+		std::mutex cacheMutex;
+
+		std::string indexFilePath(const std::string& filePath) const;
+		void load(MediaIndex& index) const;
+		void save(MediaIndex& index) const;
+		static bool fileIdentity(const std::string& filePath, long long& outSize, long long& outModified);
+	};
+}
+
+#endif // VideoEditor_MediaIndex_hpp
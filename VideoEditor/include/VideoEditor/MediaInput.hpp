@@ -0,0 +1,71 @@
+// Copyright (C) 2021 lmc
+// 
+// This file is part of VideoEditor.
+// 
+// VideoEditor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+// 
+// VideoEditor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with VideoEditor.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef VideoEditor_MediaInput_hpp
+#define VideoEditor_MediaInput_hpp
+
+#include <atomic>
+#include <chrono>
+#include <string>
+
+namespace ks
+{
+	// Where decoders read a media path from.
+	// Remote http(s) media is opened through FFmpeg's protocol chain instead of being downloaded first:
+	// cache: keeps every range read in a local file so that seeking back is free,
+	// async: reads ahead of the decoder on its own thread into a memory fifo.
+	// Local streams can go through async: as well, so that a slow disk or network mount does not block the decoder's caller,
+	// seeking drops the fifo and restarts the read ahead at the new position.
+	struct MediaInputOptions
+	{
+		bool isCached = true;
+		bool isReadAhead = true;
+		bool isLocalReadAhead = true;
+	};
+
+	// Time a decoder's newFrame call blocked its caller, demuxing, I/O and decoding together.
+	// Calls longer than slowThreshold count as slow, the others as fast. A slow call is not necessarily a slow read,
+	// the decoder does not expose its reads, compare against the same media on a local disk to tell the two apart.
+	class DecodeLatencyStatistics
+	{
+	public:
+		const std::chrono::milliseconds slowThreshold = std::chrono::milliseconds(20);
+
+		void record(const std::chrono::steady_clock::duration& decodeDuration);
+		unsigned int getFastCount() const;
+		unsigned int getSlowCount() const;
+		std::chrono::microseconds getSlowDuration() const;
+
+	private:
+		std::atomic<unsigned int> fastCount = 0;
+		std::atomic<unsigned int> slowCount = 0;
+		std::atomic<long long> slowMicroseconds = 0;
+	};
+
+	class MediaInput
+	{
+	public:
+		static bool isRemote(const std::string& path);
+		// Whether a decoder URL reads through cache:, whose local copy only lives as long as the decoder.
+		static bool isCachedURL(const std::string& url);
+		// Local paths are resolved against directory, remote ones are wrapped for the decoders.
+		// Streams are read sequentially by a demuxer, single images are not worth a read ahead thread.
+		static std::string decoderURL(const std::string& directory, const std::string& path, const MediaInputOptions& options, const bool isStream);
+	};
+}
+
+#endif // VideoEditor_MediaInput_hpp
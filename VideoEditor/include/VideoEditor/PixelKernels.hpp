@@ -0,0 +1,91 @@
+// Copyright (C) 2021 lmc
+//
+// This file is part of VideoEditor.
+//
+// VideoEditor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// VideoEditor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with VideoEditor.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef VideoEditor_PixelKernels_hpp
+#define VideoEditor_PixelKernels_hpp
+
+#include <Foundation/Foundation.hpp>
+#include <KSMediaCodec/KSMediaCodec.hpp>
+#include <KSImage/KSImage.hpp>
+
+namespace ks
+{
+	struct PixelRect
+	{
+		int x = 0;
+		int y = 0;
+		int width = 0;
+		int height = 0;
+
+		static PixelRect make(const Rect& rect, const float scale);
+		PixelRect intersection(const PixelRect& rect) const;
+		PixelRect chroma() const;
+		bool isEmpty() const;
+	};
+
+	struct PixelPlane
+	{
+		unsigned char* data = nullptr;
+		int width = 0;
+		int height = 0;
+		int bytesPerRow = 0;
+		int bytesPerPixel = 1;
+	};
+
+	// Per pixel weights out of 256 for two sources, whatever remains goes to a constant background.
+	// Pixels left of edge, counted from the rect origin, use leading, the others trailing.
+	struct PixelBlend
+	{
+		struct Weights
+		{
+			int from = 256;
+			int to = 0;
+		};
+		Weights leading;
+		Weights trailing;
+		int edge = 0;
+		unsigned char background[4] = { 0, 0, 0, 255 };
+	};
+
+	// CPU kernels working directly on the planes of a PixelBuffer.
+	// Every kernel takes a [rowBegin, rowEnd) range so that callers may split a frame.
+	// Plane kernels count rows of the plane they write, frame kernels count luma / rgba rows
+	// and expect an even rowBegin for yuv420p.
+	class PixelKernels
+	{
+	public:
+		static int planeCount(const PixelBuffer::FormatType format);
+		static PixelPlane plane(const PixelBuffer& pixelBuffer, const PixelBuffer::FormatType format, const int index);
+
+		static void clear(PixelBuffer& pixelBuffer, const PixelBuffer::FormatType format, const int rowBegin, const int rowEnd);
+		static void fillRow(unsigned int* row, const int count, const unsigned int value);
+
+		static void scalePlane(const PixelPlane& src, const PixelPlane& dst, const PixelRect& dstRect, const int rowBegin, const int rowEnd);
+		// Averages 2x2 blocks, dst is expected to be half the size of src rounded down.
+		static void downsamplePlane2x(const PixelPlane& src, const PixelPlane& dst);
+		static void scaleSourceOverRGBA8(const PixelPlane& src, const PixelPlane& dst, const PixelRect& dstRect, const int rowBegin, const int rowEnd);
+		// Scales both sources into dstRect and blends them in one pass, each source pixel is read once and every output pixel written once.
+		static void scaleBlendPlanes(const PixelPlane& from, const PixelPlane& to, const PixelPlane& dst, const PixelRect& dstRect, const PixelBlend& blend, const int rowBegin, const int rowEnd);
+		// Scales and converts in one pass, for yuv420p layers composed on an rgba8 frame.
+		static void scaleYUV420PToRGBA8(const PixelBuffer& src, const PixelPlane& dst, const PixelRect& dstRect, const int rowBegin, const int rowEnd);
+
+		static void convertYUV420PToRGBA8(const PixelBuffer& src, PixelBuffer& dst, const int width, const int height, const int rowBegin, const int rowEnd);
+		static void convertRGBA8ToYUV420P(const PixelBuffer& src, PixelBuffer& dst, const int width, const int height, const int rowBegin, const int rowEnd);
+	};
+}
+
+#endif // VideoEditor_PixelKernels_hpp
\ No newline at end of file
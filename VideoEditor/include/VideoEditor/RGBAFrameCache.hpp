@@ -0,0 +1,71 @@
+// Copyright (C) 2021 lmc
+// 
+// This file is part of VideoEditor.
+// 
+// VideoEditor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+// 
+// VideoEditor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with VideoEditor.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef VideoEditor_RGBAFrameCache_hpp
+#define VideoEditor_RGBAFrameCache_hpp
+
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include <Foundation/Foundation.hpp>
+#include <KSMediaCodec/KSMediaCodec.hpp>
+#include "WorkerPool.hpp"
+
+namespace ks
+{
+	// rgba8 copies of yuv420p frames, converted the first time a consumer asks for one and kept until the frame is released.
+	// Decoded frames stay planar, so frames that are dropped, hidden or drawn by the yuv aware kernels are never converted.
+	class RGBAFrameCache : public noncopyable
+	{
+	public:
+		// Rows are converted in parallel on workerPool, or on the calling thread when it is null.
+		RGBAFrameCache(WorkerPool* workerPool);
+		~RGBAFrameCache();
+
+		// The rgba8 image of a yuv420p frame, outIsConverted tells whether this call made it.
+		PixelBuffer* rgbaFrame(const PixelBuffer& frame, bool* outIsConverted = nullptr);
+		void release(const PixelBuffer* frame);
+		void clear();
+
+		static void convert(const PixelBuffer& src, PixelBuffer& dst, WorkerPool* workerPool);
+
+	private:
+		// The copy belongs to its own pool.
+		struct Entry
+		{
+			std::unique_ptr<PixelBufferPool> pixelBufferPool;
+			PixelBuffer* pixelBuffer = nullptr;
+			int width = 0;
+			int height = 0;
+		};
+
+		const unsigned int spareCapacity = 4;
+		static constexpr int rowAlignment = 16;
+
+		WorkerPool* workerPool = nullptr;
+		std::unordered_map<const PixelBuffer*, Entry> entries;
+		// Released copies of the size last converted, reused before a new one is allocated.
+		std::vector<Entry> spareEntries;
+		std::mutex entriesMutex;
+
+		Entry makeEntry(const int width, const int height);
+	};
+}
+
+#endif // VideoEditor_RGBAFrameCache_hpp
@@ -0,0 +1,104 @@
+// Copyright (C) 2021 lmc
+// 
+// This file is part of VideoEditor.
+// 
+// VideoEditor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+// 
+// VideoEditor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with VideoEditor.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef VideoEditor_RawVideoTrack_hpp
+#define VideoEditor_RawVideoTrack_hpp
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <Foundation/Foundation.hpp>
+#include <KSMediaCodec/KSMediaCodec.hpp>
+#include "ImageTrack.hpp"
+#include "MappedFile.hpp"
+
+namespace ks
+{
+	// Uncompressed intermediates, Y4M (8 bit 4:2:0) or headerless raw frames, read from a memory mapping.
+	// PixelBuffer owns its planes, so a frame costs one copy per plane out of the mapping into a recycled buffer.
+	class RawVideoTrack : public IImageTrack
+	{
+	public:
+		RawVideoTrack();
+		~RawVideoTrack();
+
+		std::string filePath;
+		// Used when the file has no Y4M header.
+		int rawWidth = 0;
+		int rawHeight = 0;
+		PixelBuffer::FormatType rawFormat = PixelBuffer::FormatType::yuv420p;
+		float rawFrameRate = 24.0f;
+		// Frames paged in ahead of the playhead, in the direction it moves.
+		unsigned int readAheadCount = 8;
+
+	private:
+		struct Slot
+		{
+			PixelBuffer *pixelBuffer = nullptr;
+			int frameIndex = -1;
+			unsigned int lastUse = 0;
+			// Held by frame handles, the slot is not refilled until they are dropped.
+			unsigned int retainCount = 0;
+		};
+
+		// Enough for a composition batch plus the frames ahead of it.
+		const unsigned int slotCapacity = 8;
+
+		std::unique_ptr<MappedFile> mappedFile;
+		int width = 0;
+		int height = 0;
+		PixelBuffer::FormatType format = PixelBuffer::FormatType::yuv420p;
+		float frameRate = 24.0f;
+		size_t firstFrameOffset = 0;
+		size_t frameHeaderSize = 0;
+		size_t frameSize = 0;
+		int frameCount = 0;
+
+		// One pool per growth, slots are added when handles hold all of them.
+		std::vector<std::unique_ptr<PixelBufferPool>> pixelBufferPools;
+		std::vector<Slot> slots;
+		unsigned int useCount = 0;
+		int firstKeptFrameIndex = 0;
+		int lastFrameIndex = -1;
+		MediaTime lastSourceFrameDisplayTime;
+		std::mutex framesMutex;
+
+		bool open();
+		bool parseY4MHeader();
+		int frameIndex(const MediaTime & compositionTime) const;
+		size_t frameOffset(const int frameIndex) const;
+		Slot * freeSlot();
+		Slot * currentSlot(const MediaTime & compositionTime);
+		bool copyFrame(const int frameIndex, PixelBuffer & pixelBuffer) const;
+		void readAhead(const int frameIndex);
+
+	public:
+		virtual const PixelBuffer * sourceFrame(const MediaTime & compositionTime, const VideoRenderContext & renderContext) override;
+		virtual MediaTime sourceFrameDisplayTime(const MediaTime & compositionTime) override;
+		virtual SourceFrameHandle retainSourceFrame(const MediaTime & compositionTime, const VideoRenderContext & renderContext) override;
+		virtual const PixelBuffer * compositionImage(const PixelBuffer & sourceFrame, const MediaTime & compositionTime, const VideoRenderContext & renderContext) override;
+		virtual PixelBuffer::FormatType compositionImageFormat(const VideoRenderContext & renderContext) const override;
+		virtual bool isOpaque() const override;
+		virtual void prepare(const VideoRenderContext & renderContext) override;
+		virtual void onSeeking(const MediaTime & compositionTime) override;
+		virtual void flush(const MediaTime & compositionTime) override;
+		virtual void flush() override;
+	};
+}
+
+#endif // VideoEditor_RawVideoTrack_hpp
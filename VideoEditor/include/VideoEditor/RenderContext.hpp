@@ -31,6 +31,8 @@ namespace ks
 		float renderScale;
 		float fps;
 		PixelBuffer::FormatType format;
+		// Threads fetching the frames of different tracks at once, the caller included. 0 takes one per core.
+		unsigned int decodeThreadBudget = 0;
 
 		VideoRenderContext() = default;
 		~VideoRenderContext() = default;
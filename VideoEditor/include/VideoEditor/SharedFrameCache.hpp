@@ -0,0 +1,99 @@
+// Copyright (C) 2021 lmc
+// 
+// This file is part of VideoEditor.
+// 
+// VideoEditor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+// 
+// VideoEditor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with VideoEditor.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef VideoEditor_SharedFrameCache_hpp
+#define VideoEditor_SharedFrameCache_hpp
+
+#include <functional>
+#include <list>
+#include <map>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <Foundation/Foundation.hpp>
+#include <KSMediaCodec/KSMediaCodec.hpp>
+
+namespace ks
+{
+	// Decoded frames shared by the tracks that cut the same file, keyed by stream and source pts.
+	// A stream is a file decoded to one format and size, see streamKey.
+	// Every frame remembers which pts its decoder produced next, so that a track can walk a run
+	// another track decoded without touching its own decoder.
+	// Frames are reference counted, the least recently used unreferenced ones go once capacity bytes are exceeded.
+	class SharedFrameCache : public noncopyable
+	{
+	public:
+		SharedFrameCache(const size_t capacity);
+		~SharedFrameCache();
+
+		static std::string streamKey(const std::string& filePath, const PixelBuffer::FormatType format, const int width, const int height);
+
+		// Takes ownership of frame and returns it retained once for the caller.
+		// previousPts is the pts the same decoder produced just before, null after a seek.
+		void insert(const std::string& streamKey,
+			const PixelBuffer::FormatType format,
+			const MediaTime& pts,
+			const MediaTime* previousPts,
+			PixelBuffer* frame,
+			std::function<void(PixelBuffer*)> deleter);
+		// The frame decoded right after previousPts, retained, or null.
+		PixelBuffer* next(const std::string& streamKey, const MediaTime& previousPts, MediaTime& outPts);
+		// The frame shown at sourceTime, retained, or null when the run around it is not cached.
+		PixelBuffer* find(const std::string& streamKey, const MediaTime& sourceTime, MediaTime& outPts);
+		bool contains(const PixelBuffer* frame) const;
+		void release(PixelBuffer* frame);
+
+		unsigned int getHitCount() const;
+		unsigned int getMissCount() const;
+		size_t getSize() const;
+
+	private:
+		struct Entry
+		{
+			std::string streamKey;
+			double pts = 0.0;
+			double nextPts = -1.0;
+			bool hasNext = false;
+			PixelBuffer* frame = nullptr;
+			std::function<void(PixelBuffer*)> deleter;
+			size_t bytes = 0;
+			unsigned int retainCount = 0;
+			// False once evicted, the frame then only lives until its last release.
+			bool isIndexed = true;
+			std::list<PixelBuffer*>::iterator lruIterator;
+		};
+
+		const size_t capacity;
+		size_t size = 0;
+		unsigned int hitCount = 0;
+		unsigned int missCount = 0;
+
+		std::unordered_map<const PixelBuffer*, Entry> entries;
+		std::unordered_map<std::string, std::map<double, PixelBuffer*>> streams;
+		// Unreferenced indexed frames, least recently used first.
+		std::list<PixelBuffer*> lru;
+		mutable std::mutex cacheMutex;
+
+		PixelBuffer* lookup(const std::string& streamKey, const double pts) const;
+		void retain(Entry& entry);
+		void unindex(Entry& entry);
+		void evict();
+		static size_t frameBytes(const PixelBuffer& frame, const PixelBuffer::FormatType format);
+	};
+}
+
+#endif // VideoEditor_SharedFrameCache_hpp
@@ -0,0 +1,71 @@
+// Copyright (C) 2021 lmc
+// 
+// This file is part of VideoEditor.
+// 
+// VideoEditor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+// 
+// VideoEditor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with VideoEditor.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef VideoEditor_SourceFrameLoader_hpp
+#define VideoEditor_SourceFrameLoader_hpp
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <Foundation/Foundation.hpp>
+#include <KSMediaCodec/KSMediaCodec.hpp>
+#include "ImageCompositionPipeline.hpp"
+#include "VideoDescription.hpp"
+#include "WorkerPool.hpp"
+
+namespace ks
+{
+	// Fetches the source frames of a request from its tracks, different tracks decode in parallel.
+	// The loads run on WorkerPool::shared(), VideoRenderContext::decodeThreadBudget caps the threads, the calling one included.
+	// Close to the end of an instruction the tracks entering with the next one are prewarmed in the background.
+	class SourceFrameLoader : public noncopyable
+	{
+	public:
+		SourceFrameLoader();
+		~SourceFrameLoader();
+
+		void load(AsyncImageCompositionRequest& request, const VideoRenderContext& videoRenderContext, const VideoDescription* videoDescription);
+		// Drops the prewarms still queued and waits for the running ones, call it before the tracks are deleted.
+		void cancelPrewarms();
+
+	private:
+		struct TrackLoad
+		{
+			IImageTrack* imageTrack = nullptr;
+			SourceFrameHandle sourceFrame;
+			MediaTime displayTime = MediaTime::zero;
+		};
+
+		// Rebuilt when the instruction changes, the largest tracks first so that they do not finish last.
+		MediaTimeRange instructionTimeRange;
+		std::vector<IImageTrack*> instructionTracks;
+		std::vector<TrackLoad> loads;
+		const double prewarmLead = 1.0;
+		MediaTime prewarmedTime = MediaTime(-1, 600);
+		// Prewarms hold raw track pointers, a cancel bumps the generation and waits until none runs.
+		unsigned int prewarmGeneration = 0;
+		unsigned int queuedPrewarmCount = 0;
+		std::mutex prewarmMutex;
+		std::condition_variable prewarmCondition;
+
+		void rebalance(const AsyncImageCompositionRequest& request);
+		void prewarm(const AsyncImageCompositionRequest& request, const VideoRenderContext& videoRenderContext, const VideoDescription& videoDescription);
+	};
+}
+
+#endif // VideoEditor_SourceFrameLoader_hpp
@@ -0,0 +1,81 @@
+// Copyright (C) 2021 lmc
+// 
+// This file is part of VideoEditor.
+// 
+// VideoEditor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+// 
+// VideoEditor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with VideoEditor.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef VideoEditor_StillImageTrack_hpp
+#define VideoEditor_StillImageTrack_hpp
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <Foundation/Foundation.hpp>
+#include <KSMediaCodec/KSMediaCodec.hpp>
+#include "ImageTrack.hpp"
+#include "PixelKernels.hpp"
+
+namespace ks
+{
+	// A png / jpeg decoded once, served for the whole time range from copies pre-scaled to rect x render scale.
+	class StillImageTrack : public IImageTrack
+	{
+	public:
+		StillImageTrack();
+		~StillImageTrack();
+
+		std::string filePath;
+
+	private:
+		struct ScaledImage
+		{
+			int width = 0;
+			int height = 0;
+			PixelBuffer::FormatType format = PixelBuffer::FormatType::rgba8;
+			std::unique_ptr<PixelBufferPool> pixelBufferPool;
+			PixelBuffer *pixelBuffer = nullptr;
+		};
+
+		const unsigned int scaledImageCapacity = 4;
+
+		PixelBuffer *image = nullptr;
+		bool isImageOpaque = false;
+		// Halved rgba8 copies of the image, the first level is the image itself.
+		std::vector<std::unique_ptr<ScaledImage>> mipLevels;
+		// Copies at the exact size of rect for the render scales seen so far, most recent last.
+		// Shared with the handles to them, an evicted copy lives on until its last handle is dropped.
+		std::vector<std::shared_ptr<ScaledImage>> scaledImages;
+		std::mutex imageMutex;
+
+		void load(const VideoRenderContext & renderContext);
+		const ScaledImage * mipLevel(const int width, const int height);
+		std::shared_ptr<ScaledImage> scaledImage(const int width, const int height, const PixelBuffer::FormatType format);
+		static std::unique_ptr<ScaledImage> makeScaledImage(const int width, const int height, const PixelBuffer::FormatType format);
+
+	public:
+		virtual const PixelBuffer * sourceFrame(const MediaTime & compositionTime, const VideoRenderContext & renderContext) override;
+		virtual MediaTime sourceFrameDisplayTime(const MediaTime & compositionTime) override;
+		virtual SourceFrameHandle retainSourceFrame(const MediaTime & compositionTime, const VideoRenderContext & renderContext) override;
+		virtual const PixelBuffer * compositionImage(const PixelBuffer & sourceFrame, const MediaTime & compositionTime, const VideoRenderContext & renderContext) override;
+		virtual PixelBuffer::FormatType compositionImageFormat(const VideoRenderContext & renderContext) const override;
+		virtual bool isOpaque() const override;
+		virtual void prepare(const VideoRenderContext & renderContext) override;
+		virtual void onSeeking(const MediaTime & compositionTime) override;
+		virtual void flush(const MediaTime & compositionTime) override;
+		virtual void flush() override;
+	};
+}
+
+#endif // VideoEditor_StillImageTrack_hpp
@@ -0,0 +1,88 @@
+// Copyright (C) 2021 lmc
+// 
+// This file is part of VideoEditor.
+// 
+// VideoEditor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+// 
+// VideoEditor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with VideoEditor.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef VideoEditor_TextTrack_hpp
+#define VideoEditor_TextTrack_hpp
+
+#include <array>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <Foundation/Foundation.hpp>
+#include <KSMediaCodec/KSMediaCodec.hpp>
+#include "ImageTrack.hpp"
+#include "GlyphAtlas.hpp"
+#include "PixelKernels.hpp"
+
+namespace ks
+{
+	// Titles, lower thirds and subtitles laid out in rect, rendered once per render size and handed out as the same frame.
+	class TextTrack : public IImageTrack
+	{
+	public:
+		enum class Alignment
+		{
+			left,
+			center,
+			right
+		};
+
+		TextTrack();
+		~TextTrack();
+
+		std::string text;
+		// Glyph height in render size units.
+		float fontSize = 48.0f;
+		std::array<unsigned char, 4> color = { 255, 255, 255, 255 };
+		std::array<unsigned char, 4> backgroundColor = { 0, 0, 0, 0 };
+		Alignment alignment = Alignment::left;
+
+	private:
+		struct GlyphRun
+		{
+			int x = 0;
+			int y = 0;
+			std::string characters;
+		};
+
+		std::shared_ptr<GlyphAtlas> atlas;
+		// Shared with the handles to textImage, a re-render leaves the image they hold alone.
+		std::shared_ptr<PixelBufferPool> pixelBufferPool;
+		PixelBuffer *textImage = nullptr;
+		int imageWidth = 0;
+		int imageHeight = 0;
+		std::mutex textMutex;
+
+		std::vector<GlyphRun> layout(const int width, const int glyphSize) const;
+		void render(const VideoRenderContext & renderContext);
+		void blitRun(const GlyphRun & run, const PixelPlane & plane) const;
+
+	public:
+		virtual const PixelBuffer * sourceFrame(const MediaTime & compositionTime, const VideoRenderContext & renderContext) override;
+		virtual MediaTime sourceFrameDisplayTime(const MediaTime & compositionTime) override;
+		virtual SourceFrameHandle retainSourceFrame(const MediaTime & compositionTime, const VideoRenderContext & renderContext) override;
+		virtual const PixelBuffer * compositionImage(const PixelBuffer & sourceFrame, const MediaTime & compositionTime, const VideoRenderContext & renderContext) override;
+		virtual PixelBuffer::FormatType compositionImageFormat(const VideoRenderContext & renderContext) const override;
+		virtual void prepare(const VideoRenderContext & renderContext) override;
+		virtual void onSeeking(const MediaTime & compositionTime) override;
+		virtual void flush(const MediaTime & compositionTime) override;
+		virtual void flush() override;
+	};
+}
+
+#endif // VideoEditor_TextTrack_hpp
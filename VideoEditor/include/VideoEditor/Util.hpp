@@ -20,6 +20,7 @@
 
 #include <functional>
 #include <assert.h>
+#include <math.h>
 #include <algorithm>
 #include <Foundation/Foundation.hpp>
 #include <KSMediaCodec/KSMediaCodec.hpp>
@@ -76,6 +77,13 @@ namespace ks
 		return MediaTime(start, 600);
 	}
 
+	// The step between output frames. The player and the export ask for frames on the 1/600 grid,
+	// so 1 / fps is rounded to it, e.g. 29.97 fps steps by 20/600 like 30 fps.
+	static MediaTime getFrameDuration(const float fps)
+	{
+		return MediaTime(std::max(static_cast<int>(lround(600.0 / fps)), 1), 600);
+	}
+
 	void InitVideoEditor(ks::IRenderEngine * renderEngine) noexcept;
 }
 
@@ -27,6 +27,7 @@
 #include "RenderContext.hpp"
 #include "ImageTrack.hpp"
 #include "AudioTrack.hpp"
+#include "VideoTransition.hpp"
 
 namespace ks
 {
@@ -46,6 +47,7 @@ namespace ks
 
 		std::vector<IImageTrack *> imageTracks;
 		std::vector<FAudioTrack *> audioTracks;
+		std::vector<VideoTransition> transitions;
 
 		MediaTime duration() const;
 
@@ -54,6 +56,7 @@ namespace ks
 
 	private:
 		void removeAllVideoInstuctions();
+		std::vector<VideoInstructionTransition> instructionTransitions(const VideoInstruction& videoInstruction) const;
 
 		MediaTime _duration;
 	};
@@ -27,5 +27,6 @@
 #include "VideoDescription.hpp"
 #include "VideoInstruction.hpp"
 #include "VideoProject.hpp"
+#include "VideoTransition.hpp"
 
 #endif // VideoEditor_VideoEditor_hpp
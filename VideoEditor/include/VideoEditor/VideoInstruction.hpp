@@ -21,6 +21,7 @@
 #include <KSMediaCodec/KSMediaCodec.hpp>
 #include "ImageTrack.hpp"
 #include "AudioTrack.hpp"
+#include "VideoTransition.hpp"
 
 namespace ks
 {
@@ -29,6 +30,7 @@ namespace ks
 		MediaTimeRange timeRange;
 		std::vector<IImageTrack *> imageTracks;
 		std::vector<FAudioTrack *> audioTracks;
+		std::vector<VideoInstructionTransition> transitions;
 	};
 }
 
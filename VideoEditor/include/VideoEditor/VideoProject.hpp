@@ -18,6 +18,7 @@
 #ifndef VideoEditor_VideoProject_hpp
 #define VideoEditor_VideoProject_hpp
 
+#include <memory>
 #include <string>
 #include <vector>
 #include <nlohmann/json.hpp>
@@ -25,6 +26,13 @@
 #include <KSMediaCodec/KSMediaCodec.hpp>
 #include <KSImage/KSImage.hpp>
 #include "VideoTrack.hpp"
+#include "TextTrack.hpp"
+#include "GeneratorTrack.hpp"
+#include "StillImageTrack.hpp"
+#include "ImageSequenceTrack.hpp"
+#include "RawVideoTrack.hpp"
+#include "MediaInput.hpp"
+#include "MediaIndex.hpp"
 #include "AudioTrack.hpp"
 #include "VideoDescription.hpp"
 
@@ -37,6 +45,12 @@ namespace ks
 	private:
 		std::string projectDir;
 		std::string projectFilePath;
+		MediaInputOptions mediaInputOptions;
+		std::shared_ptr<SharedFrameCache> frameCache;
+		std::shared_ptr<DecoderRegistry> decoderRegistry;
+		std::shared_ptr<MediaIndexCache> mediaIndexCache;
+		// Target ranges of the tracks with a decoder in decoderRegistry.
+		std::vector<MediaTimeRange> decoderTimeRanges;
 
 		VideoDescription *videoDescription = nullptr;
 		//std::vector<IImageTrack *> imageTracks;
@@ -45,10 +59,21 @@ namespace ks
 		void clean();
 		MediaTimeRange converTimeRange(const Json & json, int timeScale);
 		Rect converRect(const Json & json);
+		std::array<unsigned char, 4> converColor(const Json & json);
+		std::string mediaPath(const std::string & path, const bool isStream) const;
+		bool loadMediaInputOptions(const Json & json);
 		bool loadVideoRenderContext(const Json & json, VideoRenderContext& context);
 		bool loadAudioRenderContext(const Json & json, AudioRenderContext& context);
 		bool loadVideoTracks(const Json & json);
+		bool loadStillImageTracks(const Json & json);
+		bool loadImageSequenceTracks(const Json & json);
+		bool loadRawVideoTracks(const Json & json);
+		bool loadGeneratorTracks(const Json & json);
+		bool loadTextTracks(const Json & json);
 		bool loadAudioTracks(const Json & json);
+		bool loadImageEffects(const Json & json, ImageEffectChain& effects);
+		bool loadTransitions(const Json & json);
+		unsigned int concurrentDecoderCount() const;
 
 	public:
 		VideoProject(const std::string& projectFilePath);
@@ -18,22 +18,29 @@
 #ifndef VideoEditor_VideoTrack_hpp
 #define VideoEditor_VideoTrack_hpp
 
+#include <condition_variable>
+#include <memory>
 #include <mutex>
 #include <unordered_map>
+#include <unordered_set>
 #include <vector>
 #include <Foundation/Foundation.hpp>
 #include <KSMediaCodec/KSMediaCodec.hpp>
 #include "ImageTrack.hpp"
+#include "ImageEffect.hpp"
+#include "MediaInput.hpp"
+#include "PixelKernels.hpp"
+#include "RGBAFrameCache.hpp"
+#include "SharedFrameCache.hpp"
+#include "DecoderRegistry.hpp"
+#include "DecodePlan.hpp"
+#include "FrameRing.hpp"
+#include "MediaIndex.hpp"
+#include "WorkerPool.hpp"
 
 namespace ks
 {
-	struct SourceFrame
-	{
-		PixelBuffer * sourceFrame = nullptr;
-		MediaTime displayTime;
-	};
-
-	class VideoTrack : public IImageTrack
+	class VideoTrack : public IImageTrack, public IDecoderOwner
 	{
 	public:
 		VideoTrack();
@@ -42,17 +49,155 @@ namespace ks
 	private:
 		VideoDecoder *decoder = nullptr;
 
-		std::vector<SourceFrame> videoFrameQueue;
+		// Sized for a composition batch, a window and the frames decoded ahead, it grows when handles hold more.
+		FrameRing videoFrames{ 16 };
+
+		// The newest frame read is held back until the one read after it shows whether an output time falls in its interval.
+		struct PendingFrame
+		{
+			PixelBuffer *pixelBuffer = nullptr;
+			MediaTime pts;
+			MediaTime displayTime;
+			bool isCached = false;
+		};
+		PendingFrame pendingFrame;
+
+		MediaTime lastSourceFrameDisplayTime;
+
+		std::unordered_map<const PixelBuffer *, unsigned int> retainCounts;
+		std::vector<PixelBuffer *> detachedFrames;
+		unsigned int windowBeforeCount = 0;
+
+		// rgba8 copies the effect chain ran on, made once per decoded frame when it is first composed.
+		// Tracks already load in parallel, so the copies are converted on the loading thread.
+		RGBAFrameCache rgbaFrames{ nullptr };
+
+		// A decoded frame brought down to the size the track is drawn at.
+		struct ScaledFrame
+		{
+			std::unique_ptr<PixelBufferPool> pixelBufferPool;
+			PixelBuffer *pixelBuffer = nullptr;
+			int width = 0;
+			int height = 0;
+		};
+
+		const unsigned int spareScaledFrameCapacity = 4;
+
+		// Decoded frames keep the decoder's planar format, rgba8 is only made where it is asked for.
+		const PixelBuffer::FormatType frameFormat = PixelBuffer::FormatType::yuv420p;
+		int frameWidth = 0;
+		int frameHeight = 0;
+		int scaledWidth = 0;
+		int scaledHeight = 0;
+		std::unordered_map<const PixelBuffer *, ScaledFrame> scaledFrames;
+		// Released frames of the size last scaled to, reused before a new one is allocated.
+		std::vector<ScaledFrame> spareScaledFrames;
+		// Scratch levels of the high quality path, level i is half of level i - 1.
+		std::vector<ScaledFrame> halvedFrames;
+
+		// Where the next frame comes from when the shared cache is used.
+		// isDecoderBehind is set once frames were taken from the cache, the decoder then restarts at lastPts.
+		std::unordered_set<const PixelBuffer *> cachedFrames;
+		MediaTime lastPts;
+		bool hasLastPts = false;
+		bool isDecoderBehind = false;
+		MediaTime seekSourceTime;
+		// The target of the last decoder seek, until the first frame after it was recorded in mediaIndex.
+		MediaTime decoderSeekTime;
+		bool isDecoderSeekRecorded = true;
+
+		// Decoded frames no output time falls on are dropped before any further work,
+		// long runs of them are sought over. isRunBroken is set once the decoder skipped ahead of lastPts.
+		DecodePlan decodePlan;
+		bool isRunBroken = false;
+		MediaTime lastCommittedPts;
+		bool hasLastCommittedPts = false;
+
+		// A decode-ahead task on WorkerPool::shared() keeps decodeAheadCount frames queued after decodeAheadTime,
+		// the last time asked for. Each track has at most one such task queued or running.
+		MediaTime decodeAheadTime;
+		bool isDecodingAhead = false;
+		std::condition_variable decodeAheadCondition;
+		bool isStopping = false;
+
+		bool isPrepared = false;
+
+		bool decodeNextFrame();
+		bool readNextFrame(PendingFrame & outFrame);
+		void commitFrame(PendingFrame & frame);
+		void dropFrame(PendingFrame & frame);
+		void seekOverGap();
+		void seekDecoder(const MediaTime & sourceTime);
+		bool isSeekBehindDecoder(const MediaTime & sourceTime) const;
+		void scheduleDecodeAhead(const MediaTime & compositionTime);
+		void decodeAhead();
+		void seekFrames(const MediaTime & compositionTime);
+		void clearFrames();
+		unsigned int decodedAheadCount() const;
+		PixelBuffer * readFrame(MediaTime & pts);
+		bool openDecoder();
+		void closeDecoder();
+		bool isFrameCacheShared() const;
+		std::string frameStreamKey() const;
+		void shareFrame(PixelBuffer * frame, const MediaTime & pts);
+		void updateFrameSize(const VideoRenderContext & renderContext);
+		PixelBuffer * scaleFrame(PixelBuffer * frame);
+		ScaledFrame makeScaledFrame(const int width, const int height) const;
+		void decodeUntil(const MediaTime & compositionTime);
+		int frameIndex(const MediaTime & compositionTime) const;
+		const PixelBuffer * currentFrame(const MediaTime & compositionTime, const VideoRenderContext & renderContext);
+		void releaseFrame(PixelBuffer * frame);
+		void releaseRetainedFrame(const PixelBuffer * frame);
+		void deleteFrame(PixelBuffer * frame);
 
 		std::mutex decoderMutex;
+		DecodeLatencyStatistics decodeLatency;
 
 	public:
+		enum class DecodeScaleQuality
+		{
+			// Frames keep the source resolution.
+			full,
+			// One bilinear pass down to rect x render scale.
+			fast,
+			// 2x2 box halvings before the bilinear pass, so that large reductions do not alias.
+			high
+		};
+
 		std::string filePath;
+		ImageEffectChain effects;
+		DecodeScaleQuality decodeScaleQuality = DecodeScaleQuality::fast;
+		// Seconds of source without a shown frame that are sought over instead of decoded through.
+		// Keep it above the keyframe interval, a seek restarts decoding at the keyframe before its target.
+		float seekGap = 2.0f;
+		// Frames decoded ahead on the shared worker pool, 0 decodes on the calling thread only.
+		// The worker takes decoderMutex one frame at a time, so a lookup waits for at most one decode.
+		unsigned int decodeAheadCount = 0;
+		// Shared with the other tracks of the project.
+		std::shared_ptr<SharedFrameCache> frameCache;
+		std::shared_ptr<DecoderRegistry> decoderRegistry;
+		// Keyframes of filePath, kept across projects. Seeks that would restart at or behind the decoder are skipped.
+		std::shared_ptr<MediaIndex> mediaIndex;
+
+		virtual bool tryCloseDecoder() override;
+
+		const DecodeLatencyStatistics & getDecodeLatency() const;
 
 	public:
 		virtual const PixelBuffer * sourceFrame(const MediaTime & compositionTime, const VideoRenderContext & renderContext) override;
+		virtual MediaTime sourceFrameDisplayTime(const MediaTime & compositionTime) override;
+		virtual SourceFrameHandle retainSourceFrame(const MediaTime & compositionTime, const VideoRenderContext & renderContext) override;
+		virtual bool retainSourceFrameWindow(const MediaTime & compositionTime,
+			const unsigned int before,
+			const unsigned int after,
+			const VideoRenderContext & renderContext,
+			SourceFrameWindow & outWindow) override;
+		virtual void releaseSourceFrameWindow(const SourceFrameWindow & window) override;
 		virtual const PixelBuffer * compositionImage(const PixelBuffer & sourceFrame, const MediaTime & compositionTime, const VideoRenderContext & renderContext) override;
+		virtual PixelBuffer::FormatType compositionImageFormat(const VideoRenderContext & renderContext) const override;
+		virtual bool isOpaque() const override;
 		virtual void prepare(const VideoRenderContext & renderContext) override;
+		virtual void prewarm(const VideoRenderContext & renderContext) override;
 		virtual void onSeeking(const MediaTime & compositionTime) override;
 		virtual void flush(const MediaTime & compositionTime) override;
 		virtual void flush() override;
@@ -0,0 +1,53 @@
+// Copyright (C) 2021 lmc
+// 
+// This file is part of VideoEditor.
+// 
+// VideoEditor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+// 
+// VideoEditor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with VideoEditor.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef VideoEditor_VideoTransition_hpp
+#define VideoEditor_VideoTransition_hpp
+
+#include <KSMediaCodec/KSMediaCodec.hpp>
+#include "ImageTrack.hpp"
+
+namespace ks
+{
+	enum class VideoTransitionType
+	{
+		crossDissolve,
+		dipToBlack,
+		wipe
+	};
+
+	// A transition between two image tracks as declared in the project, tracks are indices into VideoDescription::imageTracks.
+	struct VideoTransition
+	{
+		VideoTransitionType type = VideoTransitionType::crossDissolve;
+		unsigned int fromTrackIndex = 0;
+		unsigned int toTrackIndex = 0;
+	};
+
+	// A transition resolved for an instruction, it runs over the time both tracks overlap.
+	struct VideoInstructionTransition
+	{
+		VideoTransitionType type = VideoTransitionType::crossDissolve;
+		IImageTrack *fromTrack = nullptr;
+		IImageTrack *toTrack = nullptr;
+		MediaTimeRange timeRange;
+
+		float progress(const MediaTime& time) const;
+	};
+}
+
+#endif // VideoEditor_VideoTransition_hpp
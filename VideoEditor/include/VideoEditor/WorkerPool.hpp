@@ -0,0 +1,61 @@
+// Copyright (C) 2021 lmc
+//
+// This file is part of VideoEditor.
+//
+// VideoEditor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// VideoEditor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with VideoEditor.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef VideoEditor_WorkerPool_hpp
+#define VideoEditor_WorkerPool_hpp
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <Foundation/Foundation.hpp>
+
+namespace ks
+{
+	// The compositor, the source frame loader and the decoding tracks share WorkerPool::shared(),
+	// so that together they never run more threads than there are cores. Each of them caps its own share.
+	// A task must not wait for another task that may still be queued, take that work over instead.
+	class WorkerPool : public noncopyable
+	{
+	public:
+		WorkerPool(const unsigned int threadCount);
+		~WorkerPool();
+
+	public:
+		void dispatch(std::function<void()> task);
+		// Runs body(0) ... body(count - 1) and returns once all of them finished. The calling thread takes part,
+		// with at most maxThreadCount - 1 pool threads, 0 for all of them.
+		void parallelFor(const int count, std::function<void(const int index)> body, const unsigned int maxThreadCount = 0);
+		unsigned int getThreadCount() const;
+
+		static unsigned int defaultThreadCount();
+		static WorkerPool& shared();
+
+	private:
+		std::vector<std::thread> threads;
+		std::deque<std::function<void()>> tasks;
+		std::mutex tasksMutex;
+		std::condition_variable tasksCondition;
+		bool isStop = false;
+
+		void run();
+	};
+}
+
+#endif // VideoEditor_WorkerPool_hpp
@@ -29,25 +29,85 @@ namespace ks
 
 	FAudioTrack::~FAudioTrack()
 	{
-		if (decoder)
+		if (decoderRegistry)
 		{
-			delete decoder;
-			decoder = nullptr;
+			decoderRegistry->closed(this);
 		}
+		closeDecoder();
 		flush();
 	}
 
 	void FAudioTrack::prepare(const AudioRenderContext& renderContext)
+	{
+		// The decoder is opened when the first samples are needed.
+		std::lock_guard<std::mutex> lock(decoderMutex);
+		if (decoder && decoderRegistry)
+		{
+			decoderRegistry->closed(this);
+		}
+		closeDecoder();
+		hasDecodedEnd = false;
+		outputAudioFormat = renderContext.audioFormat;
+		isPrepared = true;
+	}
+
+	bool FAudioTrack::openDecoder()
 	{
 		if (decoder)
 		{
-			delete decoder;
-			decoder = nullptr;
+			if (decoderRegistry)
+			{
+				decoderRegistry->used(this);
+			}
+			return true;
 		}
-		AudioFormat format = renderContext.audioFormat;
+		AudioFormat format = outputAudioFormat;
 		decoder = AudioDecoder::New(filePath, format);
 		assert(decoder != nullptr);
+		if (decoder == nullptr)
+		{
+			return false;
+		}
+		if (decoderRegistry)
+		{
+			decoderRegistry->opened(this);
+		}
 		outputAudioFormat = format;
+		// Continue after the last samples decoded, or start where the last seek asked for.
+		if (hasDecodedEnd)
+		{
+			decoder->seek(decodedEnd);
+		}
+		else if (isSeekPending)
+		{
+			decoder->seek(seekTime);
+		}
+		return true;
+	}
+
+	bool FAudioTrack::tryCloseDecoder()
+	{
+		// Closing would drop what cache: downloaded, the reopened decoder would fetch it all again.
+		if (MediaInput::isCachedURL(filePath))
+		{
+			return false;
+		}
+		std::unique_lock<std::mutex> lock(decoderMutex, std::try_to_lock);
+		if (lock.owns_lock() == false)
+		{
+			return false;
+		}
+		closeDecoder();
+		return true;
+	}
+
+	void FAudioTrack::closeDecoder()
+	{
+		if (decoder)
+		{
+			delete decoder;
+			decoder = nullptr;
+		}
 	}
 
 	void FAudioTrack::flush()
@@ -83,23 +143,39 @@ namespace ks
 	void FAudioTrack::onSeeking(const MediaTime& time)
 	{
 		flush();
+		std::lock_guard<std::mutex> lock(decoderMutex);
+		seekTime = time;
+		isSeekPending = true;
+		hasDecodedEnd = false;
 		if (decoder)
 		{
-			std::lock_guard<std::mutex> lock(decoderMutex);
 			decoder->seek(time);
 		}
 	}
 
+	const DecodeLatencyStatistics& FAudioTrack::getDecodeLatency() const
+	{
+		return decodeLatency;
+	}
+
 	void FAudioTrack::samples(const MediaTimeRange& timeRange, AudioPCMBuffer* outAudioPCMBuffer)
 	{
 		std::lock_guard<std::mutex> lock(decoderMutex);
+		if (isPrepared == false || openDecoder() == false)
+		{
+			return;
+		}
 
 		std::function<bool()> decodeNextFrame = [this]()
 		{
 			MediaTimeRange outTimeRange;
+			const auto decodeBegin = std::chrono::steady_clock::now();
 			AudioPCMBuffer* outPcmBuffer = decoder->newFrame(outTimeRange);
+			decodeLatency.record(std::chrono::steady_clock::now() - decodeBegin);
 			if (outPcmBuffer)
 			{
+				decodedEnd = outTimeRange.end;
+				hasDecodedEnd = true;
 				AudioPCMBufferQueueItem item;
 				item.pcmBuffer = outPcmBuffer;
 				item.timeRange = outTimeRange;
@@ -0,0 +1,63 @@
+// Copyright (C) 2021 lmc
+// 
+// This file is part of VideoEditor.
+// 
+// VideoEditor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+// 
+// VideoEditor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with VideoEditor.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include "DecodePlan.hpp"
+#include <math.h>
+#include <algorithm>
+
+namespace ks
+{
+	DecodePlan::DecodePlan(const MediaTimeMapping& timeMapping, const MediaTime& frameDuration)
+		: frameDuration(frameDuration), start(timeMapping.target.start.seconds()), end(timeMapping.target.end.seconds())
+	{
+	}
+
+	bool DecodePlan::isEmpty() const
+	{
+		return frameDuration.seconds() <= 0.0 || end <= start;
+	}
+
+	bool DecodePlan::isShown(const MediaTime& displayTime, const MediaTime& nextDisplayTime) const
+	{
+		long long index = 0;
+		if (isEmpty() || firstIndex(displayTime.seconds() - tolerance, index) == false)
+		{
+			// Past the last output time whatever is asked for is kept.
+			return true;
+		}
+		return index * frameDuration.seconds() < nextDisplayTime.seconds() - tolerance;
+	}
+
+	bool DecodePlan::nextTime(const MediaTime& displayTime, MediaTime& outTime) const
+	{
+		long long index = 0;
+		if (isEmpty() || firstIndex(displayTime.seconds() + tolerance, index) == false)
+		{
+			return false;
+		}
+		// Whole grid steps, so that the time is exactly one the player or export asks for.
+		outTime = MediaTime(static_cast<int>(index * frameDuration.timeValue()), frameDuration.timeScale());
+		return true;
+	}
+
+	bool DecodePlan::firstIndex(const double time, long long& outIndex) const
+	{
+		outIndex = static_cast<long long>(ceil(std::max(time, start - tolerance) / frameDuration.seconds()));
+		return outIndex * frameDuration.seconds() < end - tolerance;
+	}
+}
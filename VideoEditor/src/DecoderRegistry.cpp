@@ -0,0 +1,98 @@
+// Copyright (C) 2021 lmc
+// 
+// This file is part of VideoEditor.
+// 
+// VideoEditor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+// 
+// VideoEditor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with VideoEditor.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "DecoderRegistry.hpp"
+#include <assert.h>
+#include <algorithm>
+
+namespace ks
+{
+	DecoderRegistry::DecoderRegistry(const unsigned int capacity)
+		: capacity(capacity)
+	{
+	}
+
+	DecoderRegistry::~DecoderRegistry()
+	{
+		assert(tracks.empty());
+	}
+
+	void DecoderRegistry::opened(IDecoderOwner* track)
+	{
+		std::lock_guard<std::mutex> lock(registryMutex);
+
+		auto position = positions.find(track);
+		if (position != positions.end())
+		{
+			tracks.erase(position->second);
+		}
+		positions[track] = tracks.insert(tracks.end(), track);
+
+		// The caller holds its own lock, others are only tried so that two tracks opening at once can not deadlock.
+		auto iter = tracks.begin();
+		while (tracks.size() > capacity && iter != tracks.end())
+		{
+			IDecoderOwner* victim = *iter;
+			if (victim != track && victim->tryCloseDecoder())
+			{
+				positions.erase(victim);
+				iter = tracks.erase(iter);
+			}
+			else
+			{
+				++iter;
+			}
+		}
+	}
+
+	void DecoderRegistry::used(IDecoderOwner* track)
+	{
+		std::lock_guard<std::mutex> lock(registryMutex);
+
+		auto position = positions.find(track);
+		if (position != positions.end())
+		{
+			tracks.splice(tracks.end(), tracks, position->second);
+		}
+	}
+
+	void DecoderRegistry::closed(IDecoderOwner* track)
+	{
+		std::lock_guard<std::mutex> lock(registryMutex);
+
+		auto position = positions.find(track);
+		if (position != positions.end())
+		{
+			tracks.erase(position->second);
+			positions.erase(position);
+		}
+	}
+
+	void DecoderRegistry::reserve(const unsigned int count)
+	{
+		std::lock_guard<std::mutex> lock(registryMutex);
+
+		capacity = std::max(capacity, count);
+	}
+
+	unsigned int DecoderRegistry::getCapacity() const
+	{
+		std::lock_guard<std::mutex> lock(registryMutex);
+
+		return capacity;
+	}
+}
@@ -54,7 +54,7 @@ namespace ks
 		VideoFileEncoder::VideoEncodeAttribute videoEncodeAttribute;
 		videoEncodeAttribute.videoWidth = videoRenderContext.renderSize.width * videoRenderContext.renderScale;
 		videoEncodeAttribute.videoHeight = videoRenderContext.renderSize.height * videoRenderContext.renderScale;
-		videoEncodeAttribute.fps = MediaTime(1, 24);
+		videoEncodeAttribute.fps = getFrameDuration(videoRenderContext.fps);
 		videoEncodeAttribute.timeBase = MediaTime(1, 600);
 		videoEncodeAttribute.bitRate = 6 * 1000 * 1000;
 		videoEncodeAttribute.gopSize = 15;
@@ -66,12 +66,15 @@ namespace ks
 		std::unique_ptr<VideoFileEncoder> videoFileEncoder =
 			std::unique_ptr<VideoFileEncoder>(VideoFileEncoder::New(filename, videoEncodeAttribute, audioFormat, &error));
 		assert(videoFileEncoder);
+		// The spare buffers keep the last outputs of the previous batch alive for reuse.
 		std::unique_ptr<PixelBufferPool> pixelBufferPool = std::make_unique<PixelBufferPool>(videoEncodeAttribute.videoWidth,
 			videoEncodeAttribute.videoHeight,
-			5,
+			compositionBatchSize + ImageCompositionPipeline::spareOutputCount,
 			videoRenderContext.format);
 
 		MediaTime encodeImageTime = MediaTime(0, videoEncodeAttribute.timeBase.timeValue());
+		const unsigned int reusedFrameCount = imageCompositionPipeline->getReusedFrameCount();
+		unsigned int encodedFrameCount = 0;
 
 		while (true)
 		{
@@ -79,36 +82,58 @@ namespace ks
 			{
 				break;
 			}
-			progressCallback(ExportSession::EncodeType::video, encodeImageTime);
 			VideoInstruction videoInstuction;
 			if (videoDescription->videoInstuction(encodeImageTime, videoInstuction) == false)
 			{
 				break;
 			}
-			defer
+
+			std::vector<AsyncImageCompositionRequest> requests;
+			while (requests.size() < compositionBatchSize &&
+				encodeImageTime.seconds() < videoDescription->duration().seconds() &&
+				videoInstuction.timeRange.containsTime(encodeImageTime))
 			{
+				progressCallback(ExportSession::EncodeType::video, encodeImageTime);
+
+				AsyncImageCompositionRequest request;
+				request.compositionTime = encodeImageTime;
+				request.instruction = videoInstuction;
+				request.videoRenderContext = &videoRenderContext;
+				request.pixelBufferFormat = videoRenderContext.format;
+				sourceFrameLoader.load(request, videoDescription->renderContext.videoRenderContext, videoDescription);
+				// The request holds its frames, the tracks can let go of everything before them.
+				for (IImageTrack *imageTrack : videoInstuction.imageTracks)
+				{
+					imageTrack->flush(request.sourceFrameDisplayTimes[imageTrack->trackID]);
+				}
+				requests.push_back(std::move(request));
+
 				encodeImageTime = encodeImageTime + videoEncodeAttribute.fps;
 				encodeImageTime = encodeImageTime.convertScale(videoEncodeAttribute.timeBase.timeScale());
-			};
-
-			AsyncImageCompositionRequest request;
-			request.instruction = videoInstuction;
-			request.videoRenderContext = &videoRenderContext;
-
-			for (IImageTrack *imageTrack : videoInstuction.imageTracks)
+			}
+			if (requests.empty())
 			{
-				imageTrack->flush(encodeImageTime);
-				const PixelBuffer *sourceFrame = imageTrack->sourceFrame(encodeImageTime, videoDescription->renderContext.videoRenderContext);
-				request.sourceFrames[imageTrack->trackID] = sourceFrame;
+				break;
 			}
 
-			imageCompositionPipeline->composition(request, [&pixelBufferPool]()
+			imageCompositionPipeline->batchComposition(requests, [&pixelBufferPool]()
 			{
 				return pixelBufferPool->pixelBuffer();
-			});
-			
-			videoFileEncoder->encode(*request.getPixelBuffer(), encodeImageTime);
+			}, pixelBufferPool.get());
+
+			for (const AsyncImageCompositionRequest& request : requests)
+			{
+				videoFileEncoder->encode(*request.getPixelBuffer(), request.compositionTime);
+				encodedFrameCount++;
+			}
 		}
+		// The tracks may go away once the export returns.
+		sourceFrameLoader.cancelPrewarms();
+		// The outputs live in pixelBufferPool, which goes away with this call.
+		imageCompositionPipeline->flush();
+		spdlog::info("reused {} of {} composited video frames", 
+			imageCompositionPipeline->getReusedFrameCount() - reusedFrameCount, 
+			encodedFrameCount);
 
 		MediaTime encodeAudioTime = MediaTime(0, audioFormat.sampleRate);
 		std::unique_ptr<AudioPCMBuffer> outputBuffer = std::make_unique<AudioPCMBuffer>(audioRenderContext.audioFormat,
@@ -0,0 +1,119 @@
+// Copyright (C) 2021 lmc
+// 
+// This file is part of VideoEditor.
+// 
+// VideoEditor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+// 
+// VideoEditor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with VideoEditor.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include "FrameRing.hpp"
+#include <assert.h>
+#include <algorithm>
+
+namespace ks
+{
+	FrameRing::FrameRing(const size_t capacity)
+		: frames(std::max(capacity, static_cast<size_t>(1)))
+	{
+	}
+
+	bool FrameRing::isEmpty() const
+	{
+		return count == 0;
+	}
+
+	size_t FrameRing::getCount() const
+	{
+		return count;
+	}
+
+	const SourceFrame& FrameRing::operator[](const size_t index) const
+	{
+		assert(index < count);
+		return frames[(head + index) % frames.size()];
+	}
+
+	const SourceFrame& FrameRing::front() const
+	{
+		return (*this)[0];
+	}
+
+	const SourceFrame& FrameRing::back() const
+	{
+		return (*this)[count - 1];
+	}
+
+	void FrameRing::pushBack(const SourceFrame& frame)
+	{
+		assert(count == 0 || back().displayTime.seconds() < frame.displayTime.seconds());
+		if (count == frames.size())
+		{
+			// Held frames outlived the capacity, unroll into a ring twice the size.
+			std::vector<SourceFrame> grown(frames.size() * 2);
+			for (size_t i = 0; i < count; i++)
+			{
+				grown[i] = (*this)[i];
+			}
+			frames.swap(grown);
+			head = 0;
+		}
+		frames[(head + count) % frames.size()] = frame;
+		count++;
+	}
+
+	void FrameRing::popFront()
+	{
+		assert(count > 0);
+		frames[head] = SourceFrame();
+		head = (head + 1) % frames.size();
+		count--;
+	}
+
+	void FrameRing::clear()
+	{
+		while (count > 0)
+		{
+			popFront();
+		}
+		head = 0;
+	}
+
+	int FrameRing::frameAt(const MediaTime& time) const
+	{
+		return static_cast<int>(upperBound(time.seconds())) - 1;
+	}
+
+	size_t FrameRing::countAfter(const MediaTime& time) const
+	{
+		return count - upperBound(time.seconds());
+	}
+
+	size_t FrameRing::upperBound(const double time) const
+	{
+		size_t low = 0;
+		size_t high = count;
+		while (low < high)
+		{
+			const size_t middle = low + (high - low) / 2;
+			if ((*this)[middle].displayTime.seconds() <= time + tolerance)
+			{
+				low = middle + 1;
+			}
+			else
+			{
+				high = middle;
+			}
+		}
+		return low;
+	}
+}
@@ -0,0 +1,232 @@
+// Copyright (C) 2021 lmc
+// 
+// This file is part of VideoEditor.
+// 
+// VideoEditor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+// 
+// VideoEditor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with VideoEditor.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "GeneratorTrack.hpp"
+#include <assert.h>
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+
+namespace ks
+{
+	static unsigned int packColor(const std::array<unsigned char, 4>& color)
+	{
+		unsigned int value = 0;
+		memcpy(&value, color.data(), sizeof(value));
+		return value;
+	}
+
+	GeneratorTrack::GeneratorTrack()
+	{
+	}
+
+	GeneratorTrack::~GeneratorTrack()
+	{
+	}
+
+	const PixelBuffer * GeneratorTrack::sourceFrame(const MediaTime & compositionTime, const VideoRenderContext & renderContext)
+	{
+		std::lock_guard<std::mutex> lock(generatorMutex);
+
+		if (image == nullptr)
+		{
+			render(renderContext);
+		}
+		return image;
+	}
+
+	SourceFrameHandle GeneratorTrack::retainSourceFrame(const MediaTime & compositionTime, const VideoRenderContext & renderContext)
+	{
+		std::lock_guard<std::mutex> lock(generatorMutex);
+
+		if (image == nullptr)
+		{
+			render(renderContext);
+		}
+		return SourceFrameHandle(pixelBufferPool ? pixelBufferPool : rgbaPixelBufferPool, image);
+	}
+
+	MediaTime GeneratorTrack::sourceFrameDisplayTime(const MediaTime & compositionTime)
+	{
+		return timeMapping.target.start;
+	}
+
+	const PixelBuffer * GeneratorTrack::compositionImage(const PixelBuffer & sourceFrame, const MediaTime & compositionTime, const VideoRenderContext & renderContext)
+	{
+		return &sourceFrame;
+	}
+
+	PixelBuffer::FormatType GeneratorTrack::compositionImageFormat(const VideoRenderContext & renderContext) const
+	{
+		// yuv420p has no alpha, translucent mattes stay rgba8.
+		return isOpaque() ? renderContext.format : PixelBuffer::FormatType::rgba8;
+	}
+
+	bool GeneratorTrack::isOpaque() const
+	{
+		switch (type)
+		{
+		case Type::solid:
+			return colors[0][3] == 255;
+		case Type::horizontalGradient:
+		case Type::verticalGradient:
+			return colors[0][3] == 255 && colors[1][3] == 255;
+		case Type::testPattern:
+			return true;
+		}
+		return false;
+	}
+
+	void GeneratorTrack::prepare(const VideoRenderContext & renderContext)
+	{
+		std::lock_guard<std::mutex> lock(generatorMutex);
+
+		const int width = std::max(static_cast<int>(lround(rect.width * renderContext.renderScale)), 1);
+		const int height = std::max(static_cast<int>(lround(rect.height * renderContext.renderScale)), 1);
+		if (width != imageWidth || height != imageHeight || compositionImageFormat(renderContext) != imageFormat)
+		{
+			image = nullptr;
+		}
+	}
+
+	void GeneratorTrack::onSeeking(const MediaTime & compositionTime)
+	{
+	}
+
+	void GeneratorTrack::flush(const MediaTime & compositionTime)
+	{
+	}
+
+	void GeneratorTrack::flush()
+	{
+	}
+
+	void GeneratorTrack::render(const VideoRenderContext & renderContext)
+	{
+		imageWidth = std::max(static_cast<int>(lround(rect.width * renderContext.renderScale)), 1);
+		imageHeight = std::max(static_cast<int>(lround(rect.height * renderContext.renderScale)), 1);
+		imageFormat = compositionImageFormat(renderContext);
+
+		rgbaPixelBufferPool = std::make_shared<PixelBufferPool>(imageWidth, imageHeight, 1, PixelBuffer::FormatType::rgba8);
+		PixelBuffer* rgbaImage = rgbaPixelBufferPool->pixelBuffer();
+		renderRGBA8(PixelKernels::plane(*rgbaImage, PixelBuffer::FormatType::rgba8, 0));
+
+		if (imageFormat == PixelBuffer::FormatType::rgba8)
+		{
+			pixelBufferPool.reset();
+			image = rgbaImage;
+		}
+		else
+		{
+			// Converted once, the rgba8 copy is only kept alive by its pool.
+			pixelBufferPool = std::make_shared<PixelBufferPool>(imageWidth, imageHeight, 1, imageFormat);
+			image = pixelBufferPool->pixelBuffer();
+			PixelKernels::convertRGBA8ToYUV420P(*rgbaImage, *image, imageWidth, imageHeight, 0, imageHeight);
+		}
+	}
+
+	void GeneratorTrack::renderRGBA8(const PixelPlane & plane) const
+	{
+		auto row = [&plane](const int y)
+		{
+			return reinterpret_cast<unsigned int*>(plane.data + y * plane.bytesPerRow);
+		};
+		// Rows that repeat are rendered once and copied.
+		auto repeatRow = [&plane](const int source, const int begin, const int end)
+		{
+			for (int y = begin; y < end; y++)
+			{
+				memcpy(plane.data + y * plane.bytesPerRow, plane.data + source * plane.bytesPerRow, plane.width * 4);
+			}
+		};
+		auto mix = [this](const int numerator, const int denominator)
+		{
+			std::array<unsigned char, 4> color;
+			for (int c = 0; c < 4; c++)
+			{
+				color[c] = static_cast<unsigned char>((colors[0][c] * (denominator - numerator) + colors[1][c] * numerator + denominator / 2) / denominator);
+			}
+			return packColor(color);
+		};
+
+		switch (type)
+		{
+		case Type::solid:
+		{
+			PixelKernels::fillRow(row(0), plane.width, packColor(colors[0]));
+			repeatRow(0, 1, plane.height);
+			break;
+		}
+		case Type::horizontalGradient:
+		{
+			const int denominator = std::max(plane.width - 1, 1);
+			for (int x = 0; x < plane.width; x++)
+			{
+				row(0)[x] = mix(x, denominator);
+			}
+			repeatRow(0, 1, plane.height);
+			break;
+		}
+		case Type::verticalGradient:
+		{
+			const int denominator = std::max(plane.height - 1, 1);
+			for (int y = 0; y < plane.height; y++)
+			{
+				PixelKernels::fillRow(row(y), plane.width, mix(y, denominator));
+			}
+			break;
+		}
+		case Type::testPattern:
+		{
+			// 75% colour bars over the top two thirds, reversed blue bars, then a grey step wedge.
+			const std::array<unsigned char, 4> bars[7] = {
+				{ 191, 191, 191, 255 }, { 191, 191, 0, 255 }, { 0, 191, 191, 255 }, { 0, 191, 0, 255 },
+				{ 191, 0, 191, 255 }, { 191, 0, 0, 255 }, { 0, 0, 191, 255 }
+			};
+			const std::array<unsigned char, 4> reversedBars[7] = {
+				{ 0, 0, 191, 255 }, { 19, 19, 19, 255 }, { 191, 0, 191, 255 }, { 19, 19, 19, 255 },
+				{ 0, 191, 191, 255 }, { 19, 19, 19, 255 }, { 191, 191, 191, 255 }
+			};
+			const int barsEnd = plane.height * 2 / 3;
+			const int reversedEnd = plane.height * 3 / 4;
+			const int steps = 11;
+
+			for (int i = 0; i < 7; i++)
+			{
+				const int begin = plane.width * i / 7;
+				const int end = plane.width * (i + 1) / 7;
+				PixelKernels::fillRow(row(0) + begin, end - begin, packColor(bars[i]));
+				if (barsEnd < plane.height)
+				{
+					PixelKernels::fillRow(row(barsEnd) + begin, end - begin, packColor(reversedBars[i]));
+				}
+			}
+			for (int i = 0; i < steps && reversedEnd < plane.height; i++)
+			{
+				const unsigned char grey = static_cast<unsigned char>(255 * i / (steps - 1));
+				const int begin = plane.width * i / steps;
+				const int end = plane.width * (i + 1) / steps;
+				PixelKernels::fillRow(row(reversedEnd) + begin, end - begin, packColor({ grey, grey, grey, 255 }));
+			}
+			repeatRow(0, 1, std::min(barsEnd, plane.height));
+			repeatRow(barsEnd, barsEnd + 1, std::min(reversedEnd, plane.height));
+			repeatRow(reversedEnd, reversedEnd + 1, plane.height);
+			break;
+		}
+		}
+	}
+}
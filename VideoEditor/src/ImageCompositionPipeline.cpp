@@ -17,11 +17,15 @@
 
 #include "ImageCompositionPipeline.hpp"
 #include <assert.h>
+#include <math.h>
+#include <algorithm>
 #include <spdlog/spdlog.h>
+#include "PixelKernels.hpp"
 
 namespace ks
 {
 	ImageCompositionPipeline::ImageCompositionPipeline()
+		: workerPool(&WorkerPool::shared())
 	{
 	}
 
@@ -30,53 +34,605 @@ namespace ks
 
 	}
 
-	void ImageCompositionPipeline::composition(AsyncImageCompositionRequest& request, std::function<PixelBuffer*()> getPixelBuffer)
+	void ImageCompositionPipeline::composition(AsyncImageCompositionRequest& request,
+		std::function<PixelBuffer*()> getPixelBuffer,
+		const PixelBufferPool* outputPool)
 	{
-		request.getPixelBuffer = [request, getPixelBuffer]()
+		compose({ &request }, getPixelBuffer, outputPool);
+	}
+
+	void ImageCompositionPipeline::batchComposition(std::vector<AsyncImageCompositionRequest>& requests,
+		std::function<PixelBuffer*()> getPixelBuffer,
+		const PixelBufferPool* outputPool)
+	{
+		std::vector<AsyncImageCompositionRequest*> pointers;
+		for (AsyncImageCompositionRequest& request : requests)
+		{
+			pointers.push_back(&request);
+		}
+		compose(pointers, getPixelBuffer, outputPool);
+	}
+
+	void ImageCompositionPipeline::compose(const std::vector<AsyncImageCompositionRequest*>& requests,
+		std::function<PixelBuffer*()> getPixelBuffer,
+		const PixelBufferPool* outputPool)
+	{
+		struct Batch
 		{
-			PixelBuffer* pixelBuffer = getPixelBuffer();
+			std::once_flag onceFlag;
+			std::vector<AsyncImageCompositionRequest> requests;
+			std::vector<PixelBuffer*> pixelBuffers;
+		};
+		std::shared_ptr<Batch> batch = std::make_shared<Batch>();
 
-			static std::unique_ptr<ks::FilterContext> context = std::unique_ptr<ks::FilterContext>(ks::FilterContext::create());
+		std::lock_guard<std::mutex> lock(memosMutex);
+		for (AsyncImageCompositionRequest* request : requests)
+		{
+			CompositionMemo memo = makeMemo(*request);
+			memo.outputPool = outputPool;
+			const double instructionKey = request->instruction.timeRange.start.seconds();
 
-			const Rect renderRect = ks::Rect(0.0, 0.0, pixelBuffer->getWidth(), pixelBuffer->getHeight());
-			std::vector<ks::Image*> images;
-			for (auto args : request.sourceFrames)
+			auto iter = outputPool ? memos.find(instructionKey) : memos.end();
+			if (iter != memos.end() &&
+				outputSerial - iter->second.outputSerial < spareOutputCount &&
+				isSameComposition(iter->second, memo))
 			{
-				ks::Image* image = ks::Image::createBorrow(args.second);
-				images.push_back(image);
+				// Same frames at the same place: hand out the output of the previous request.
+				request->getPixelBuffer = iter->second.getPixelBuffer;
+				iter->second.lastUsed = ++memoClock;
+				reusedFrameCount++;
+				continue;
 			}
-			// TODO:
-			assert(images.size() == 2);
 
-			ks::Image* inputImage = images[0];
-			ks::Image* inputTargetImage = images[1];
+			// The batch is composed once on first use and its outputs are shared by every request reusing them.
+			const size_t index = batch->requests.size();
+			batch->requests.push_back(*request);
+			request->getPixelBuffer = [this, batch, index, getPixelBuffer]()
+			{
+				std::call_once(batch->onceFlag, [&]()
+				{
+					for (size_t i = 0; i < batch->requests.size(); i++)
+					{
+						batch->pixelBuffers.push_back(getPixelBuffer());
+					}
+					renderBatch(batch->requests, batch->pixelBuffers);
+					// Memos keep the batch for its outputs only. The source frame handles go back to their tracks,
+					// which may be destroyed while a memo still holds the batch.
+					batch->requests.clear();
+				});
+				return batch->pixelBuffers[index];
+			};
+
+			if (outputPool == nullptr)
+			{
+				// Nothing tells whether the buffers behind getPixelBuffer outlive this call.
+				continue;
+			}
+			if (memos.size() >= memoCapacity && iter == memos.end())
+			{
+				auto leastRecent = std::min_element(memos.begin(), memos.end(), [](const auto& lhs, const auto& rhs)
+				{
+					return lhs.second.lastUsed < rhs.second.lastUsed;
+				});
+				memos.erase(leastRecent);
+			}
+			memo.getPixelBuffer = request->getPixelBuffer;
+			memo.outputSerial = ++outputSerial;
+			memo.lastUsed = ++memoClock;
+			memos[instructionKey] = memo;
+		}
+	}
 
-			std::shared_ptr<ks::SourceOverFilter> mixTwoImageFilter0 = std::shared_ptr<ks::SourceOverFilter>(ks::SourceOverFilter::create());
+	void ImageCompositionPipeline::flush()
+	{
+		std::lock_guard<std::mutex> lock(memosMutex);
+		memos.clear();
+	}
 
-			std::shared_ptr<ks::TransformFilter> transformFilter0 = std::shared_ptr<ks::TransformFilter>(ks::TransformFilter::create());
-			transformFilter0->inputImage = inputImage;
-			transformFilter0->transform = ks::RectTransDescription(inputImage->getRect())
-				.newRect(ks::Rect(0, 0, 640, 360))
-				.getTransform();
+	unsigned int ImageCompositionPipeline::getReusedFrameCount() const
+	{
+		return reusedFrameCount;
+	}
+
+	CompositionMemo ImageCompositionPipeline::makeMemo(const AsyncImageCompositionRequest& request) const
+	{
+		CompositionMemo memo;
+		memo.videoRenderContext = request.videoRenderContext;
+		memo.pixelBufferFormat = request.pixelBufferFormat;
+		memo.isLowLatency = request.isLowLatency;
+		memo.transitionTime = request.instruction.transitions.empty() ? MediaTime::zero : request.compositionTime;
+		const float renderScale = request.videoRenderContext ? request.videoRenderContext->renderScale : 1.0f;
+
+		for (const IImageTrack* imageTrack : request.instruction.imageTracks)
+		{
+			CompositionSource source;
+			source.trackID = imageTrack->trackID;
+			source.rect = PixelRect::make(imageTrack->rect, renderScale);
+
+			auto frameIter = request.sourceFrames.find(imageTrack->trackID);
+			if (frameIter != request.sourceFrames.end())
+			{
+				source.sourceFrame = frameIter->second;
+			}
+			auto timeIter = request.sourceFrameDisplayTimes.find(imageTrack->trackID);
+			if (timeIter != request.sourceFrameDisplayTimes.end())
+			{
+				source.displayTime = timeIter->second;
+			}
+			else
+			{
+				// Without a display time a recycled allocation could look like the previous frame.
+				source.displayTime = request.compositionTime;
+			}
+			memo.sources.push_back(source);
+		}
+		return memo;
+	}
+
+	bool ImageCompositionPipeline::isSameComposition(const CompositionMemo & lhs, const CompositionMemo & rhs)
+	{
+		if (lhs.outputPool != rhs.outputPool ||
+			lhs.videoRenderContext != rhs.videoRenderContext ||
+			lhs.pixelBufferFormat != rhs.pixelBufferFormat ||
+			lhs.isLowLatency != rhs.isLowLatency ||
+			lhs.transitionTime != rhs.transitionTime ||
+			lhs.sources.size() != rhs.sources.size())
+		{
+			return false;
+		}
+		for (size_t i = 0; i < lhs.sources.size(); i++)
+		{
+			const CompositionSource& a = lhs.sources[i];
+			const CompositionSource& b = rhs.sources[i];
+			if (a.trackID != b.trackID ||
+				a.sourceFrame != b.sourceFrame ||
+				a.displayTime != b.displayTime ||
+				a.rect.x != b.rect.x || a.rect.y != b.rect.y ||
+				a.rect.width != b.rect.width || a.rect.height != b.rect.height)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	bool ImageCompositionPipeline::isBandedComposition(const AsyncImageCompositionRequest& request, PixelBuffer::FormatType& outWorkingFormat)
+	{
+		// Sources are kept as planar yuv from the decoder, the filter graph only understands rgba.
+		// A track handing out rgba8 images, e.g. for effects, moves the whole frame to rgba8.
+		if (request.videoRenderContext && request.videoRenderContext->format == PixelBuffer::FormatType::yuv420p)
+		{
+			outWorkingFormat = PixelBuffer::FormatType::yuv420p;
+			for (const IImageTrack* imageTrack : request.instruction.imageTracks)
+			{
+				if (imageTrack->compositionImageFormat(*request.videoRenderContext) != PixelBuffer::FormatType::yuv420p)
+				{
+					outWorkingFormat = PixelBuffer::FormatType::rgba8;
+				}
+			}
+			return true;
+		}
+		else if (request.isLowLatency || request.instruction.transitions.empty() == false)
+		{
+			// Transitions are blended by the fused kernels, the filter graph would need a pass per source.
+			outWorkingFormat = PixelBuffer::FormatType::rgba8;
+			return true;
+		}
+		return false;
+	}
+
+	size_t ImageCompositionPipeline::firstVisibleTrack(const AsyncImageCompositionRequest & request)
+	{
+		// Tracks under the topmost opaque track covering the whole frame can not show through.
+		if (request.videoRenderContext == nullptr)
+		{
+			return 0;
+		}
+		const VideoRenderContext& videoRenderContext = *request.videoRenderContext;
+		const int width = static_cast<int>(videoRenderContext.renderSize.width * videoRenderContext.renderScale);
+		const int height = static_cast<int>(videoRenderContext.renderSize.height * videoRenderContext.renderScale);
+		const std::vector<IImageTrack*>& imageTracks = request.instruction.imageTracks;
+
+		for (size_t i = imageTracks.size(); i-- > 0;)
+		{
+			const IImageTrack* imageTrack = imageTracks[i];
+			auto iter = request.sourceFrames.find(imageTrack->trackID);
+			if (iter == request.sourceFrames.end() || iter->second == nullptr || imageTrack->isOpaque() == false)
+			{
+				continue;
+			}
+			const PixelRect rect = PixelRect::make(imageTrack->rect, videoRenderContext.renderScale);
+			if (rect.x <= 0 && rect.y <= 0 && rect.x + rect.width >= width && rect.y + rect.height >= height)
+			{
+				return i;
+			}
+		}
+		return 0;
+	}
+
+	void ImageCompositionPipeline::renderBatch(const std::vector<AsyncImageCompositionRequest>& requests, const std::vector<PixelBuffer*>& pixelBuffers)
+	{
+		assert(requests.size() == pixelBuffers.size());
+		const size_t count = requests.size();
+		std::vector<std::vector<CompositionLayer>> layers(count);
+		std::vector<std::vector<CompositionBand>> bands(count);
+		std::vector<PixelBuffer::FormatType> workingFormats(count);
+		std::vector<PixelBuffer*> workingPixelBuffers(count, nullptr);
+		std::vector<PixelBuffer*> outputPixelBuffers(count, nullptr);
+		std::vector<size_t> scratchIndices;
+		std::vector<std::pair<size_t, size_t>> tasks;
+		RGBAFrameCache rgbaFrames(workerPool);
+
+		for (size_t i = 0; i < count; i++)
+		{
+			if (isBandedComposition(requests[i], workingFormats[i]) == false)
+			{
+				compositionFilters(requests[i], *pixelBuffers[i], rgbaFrames);
+				continue;
+			}
+			layers[i] = compositionLayers(requests[i], workingFormats[i], rgbaFrames);
+			bands[i] = compositionBands(layers[i], pixelBuffers[i]->getHeight());
+			if (workingFormats[i] == requests[i].pixelBufferFormat)
+			{
+				workingPixelBuffers[i] = pixelBuffers[i];
+			}
+			else
+			{
+				outputPixelBuffers[i] = pixelBuffers[i];
+				scratchIndices.push_back(i);
+			}
+			for (size_t j = 0; j < bands[i].size(); j++)
+			{
+				tasks.push_back(std::make_pair(i, j));
+			}
+		}
+
+		if (tasks.empty())
+		{
+			return;
+		}
+
+		std::lock_guard<std::mutex> lock(scratchMutex);
+		if (scratchIndices.empty() == false)
+		{
+			const PixelBuffer* first = pixelBuffers[scratchIndices.front()];
+			const std::vector<PixelBuffer*> scratches = scratchPixelBuffers(first->getWidth(),
+				first->getHeight(),
+				workingFormats[scratchIndices.front()],
+				static_cast<unsigned int>(scratchIndices.size()));
+			for (size_t i = 0; i < scratchIndices.size(); i++)
+			{
+				assert(workingFormats[scratchIndices[i]] == workingFormats[scratchIndices.front()]);
+				workingPixelBuffers[scratchIndices[i]] = scratches[i];
+			}
+		}
+
+		// One submission for every band of every frame in the batch.
+		workerPool->parallelFor(static_cast<int>(tasks.size()), [&](const int index)
+		{
+			const size_t i = tasks[index].first;
+			const size_t j = tasks[index].second;
+			renderBand(layers[i], bands[i][j], *workingPixelBuffers[i], workingFormats[i], outputPixelBuffers[i]);
+		});
+	}
 
-			std::shared_ptr<ks::TransformFilter> transformFilter1 = std::shared_ptr<ks::TransformFilter>(ks::TransformFilter::create());
-			transformFilter1->inputImage = inputTargetImage;
-			transformFilter1->transform = ks::RectTransDescription(inputTargetImage->getRect())
-				.newRect(ks::Rect(640, 360, 640, 360))
+	void ImageCompositionPipeline::compositionFilters(const AsyncImageCompositionRequest& request, PixelBuffer& pixelBuffer, RGBAFrameCache& rgbaFrames)
+	{
+		static std::unique_ptr<ks::FilterContext> context = std::unique_ptr<ks::FilterContext>(ks::FilterContext::create());
+
+		const int width = pixelBuffer.getWidth();
+		const int height = pixelBuffer.getHeight();
+		const float renderScale = request.videoRenderContext ? request.videoRenderContext->renderScale : 1.0f;
+		const Rect renderRect = ks::Rect(0.0, 0.0, width, height);
+
+		std::vector<std::shared_ptr<ks::TransformFilter>> transformFilters;
+		std::vector<std::shared_ptr<ks::SourceOverFilter>> sourceOverFilters;
+		ks::Image* outputImage = nullptr;
+
+		const std::vector<IImageTrack*>& imageTracks = request.instruction.imageTracks;
+		for (size_t i = firstVisibleTrack(request); i < imageTracks.size(); i++)
+		{
+			const IImageTrack* imageTrack = imageTracks[i];
+			auto iter = request.sourceFrames.find(imageTrack->trackID);
+			if (iter == request.sourceFrames.end() || iter->second == nullptr)
+			{
+				continue;
+			}
+			const PixelBuffer* sourceFrame = iter->second;
+			if (request.videoRenderContext &&
+				imageTrack->compositionImageFormat(*request.videoRenderContext) == PixelBuffer::FormatType::yuv420p)
+			{
+				sourceFrame = rgbaFrames.rgbaFrame(*sourceFrame);
+			}
+			ks::Image* inputImage = ks::Image::createBorrow(sourceFrame);
+
+			std::shared_ptr<ks::TransformFilter> transformFilter = std::shared_ptr<ks::TransformFilter>(ks::TransformFilter::create());
+			transformFilter->inputImage = inputImage;
+			transformFilter->transform = ks::RectTransDescription(inputImage->getRect())
+				.newRect(ks::Rect(imageTrack->rect.x * renderScale,
+					imageTrack->rect.y * renderScale,
+					imageTrack->rect.width * renderScale,
+					imageTrack->rect.height * renderScale))
 				.getTransform();
+			transformFilters.push_back(transformFilter);
 
-			mixTwoImageFilter0->inputImage = transformFilter0->outputImage();
-			mixTwoImageFilter0->inputTargetImage = transformFilter1->outputImage();
+			if (outputImage == nullptr)
+			{
+				outputImage = transformFilter->outputImage();
+			}
+			else
+			{
+				std::shared_ptr<ks::SourceOverFilter> sourceOverFilter = std::shared_ptr<ks::SourceOverFilter>(ks::SourceOverFilter::create());
+				sourceOverFilter->inputImage = transformFilter->outputImage();
+				sourceOverFilter->inputTargetImage = outputImage;
+				outputImage = sourceOverFilter->outputImage();
+				sourceOverFilters.push_back(sourceOverFilter);
+			}
+		}
+
+		if (outputImage == nullptr)
+		{
+			PixelKernels::clear(pixelBuffer, request.pixelBufferFormat, 0, height);
+			return;
+		}
 
-			auto bufferPtr = std::shared_ptr<ks::PixelBuffer>(context->render(*mixTwoImageFilter0->outputImage(), renderRect));
+		auto bufferPtr = std::shared_ptr<ks::PixelBuffer>(context->render(*outputImage, renderRect));
 
-			assert(bufferPtr->getWidth() == pixelBuffer->getWidth());
-			assert(bufferPtr->getHeight() == pixelBuffer->getHeight());
-			memcpy(pixelBuffer->getMutableData()[0],
+		assert(bufferPtr->getWidth() == width);
+		assert(bufferPtr->getHeight() == height);
+		if (request.pixelBufferFormat == PixelBuffer::FormatType::yuv420p)
+		{
+			PixelKernels::convertRGBA8ToYUV420P(*bufferPtr, pixelBuffer, width, height, 0, height);
+		}
+		else
+		{
+			memcpy(pixelBuffer.getMutableData()[0],
 				bufferPtr->getImmutableData()[0],
-				4 * pixelBuffer->getWidth() * pixelBuffer->getHeight());
+				4 * width * height);
+		}
+	}
 
-			return pixelBuffer;
+	std::vector<CompositionLayer> ImageCompositionPipeline::compositionLayers(const AsyncImageCompositionRequest& request,
+		const PixelBuffer::FormatType workingFormat,
+		RGBAFrameCache& rgbaFrames) const
+	{
+		const float renderScale = request.videoRenderContext ? request.videoRenderContext->renderScale : 1.0f;
+		const std::vector<IImageTrack*>& imageTracks = request.instruction.imageTracks;
+
+		auto makeLayer = [&](const IImageTrack* imageTrack)
+		{
+			CompositionLayer layer;
+			auto iter = request.sourceFrames.find(imageTrack->trackID);
+			if (iter != request.sourceFrames.end())
+			{
+				layer.sourceFrame = iter->second;
+			}
+			layer.format = request.videoRenderContext ? imageTrack->compositionImageFormat(*request.videoRenderContext) : PixelBuffer::FormatType::rgba8;
+			layer.rect = PixelRect::make(imageTrack->rect, renderScale);
+			return layer;
 		};
+
+		std::vector<CompositionLayer> layers;
+		const size_t firstVisible = firstVisibleTrack(request);
+		for (size_t i = 0; i < imageTracks.size(); i++)
+		{
+			const VideoInstructionTransition* transition = nullptr;
+			for (const VideoInstructionTransition& instructionTransition : request.instruction.transitions)
+			{
+				if (instructionTransition.fromTrack == imageTracks[i] || instructionTransition.toTrack == imageTracks[i])
+				{
+					transition = &instructionTransition;
+					break;
+				}
+			}
+			if (transition == nullptr)
+			{
+				if (i < firstVisible)
+				{
+					continue;
+				}
+				const CompositionLayer layer = makeLayer(imageTracks[i]);
+				if (layer.sourceFrame)
+				{
+					layers.push_back(layer);
+				}
+				continue;
+			}
+
+			// Both tracks of a transition become one layer at the place of the upper one.
+			const IImageTrack* other = transition->fromTrack == imageTracks[i] ? transition->toTrack : transition->fromTrack;
+			if (std::find(imageTracks.begin() + i + 1, imageTracks.end(), other) != imageTracks.end())
+			{
+				continue;
+			}
+			CompositionLayer fromLayer = makeLayer(transition->fromTrack);
+			CompositionLayer toLayer = makeLayer(transition->toTrack);
+			if (fromLayer.sourceFrame && toLayer.sourceFrame && workingFormat == PixelBuffer::FormatType::rgba8)
+			{
+				// The blend kernels read both frames in the working format.
+				for (CompositionLayer* layer : { &fromLayer, &toLayer })
+				{
+					if (layer->format == PixelBuffer::FormatType::yuv420p)
+					{
+						layer->sourceFrame = rgbaFrames.rgbaFrame(*layer->sourceFrame);
+						layer->format = PixelBuffer::FormatType::rgba8;
+					}
+				}
+			}
+			if (fromLayer.sourceFrame && toLayer.sourceFrame && fromLayer.format == toLayer.format)
+			{
+				fromLayer.transitionFrame = toLayer.sourceFrame;
+				fromLayer.transitionType = transition->type;
+				fromLayer.transitionProgress = transition->progress(request.compositionTime);
+				layers.push_back(fromLayer);
+				continue;
+			}
+			for (const CompositionLayer& layer : { fromLayer, toLayer })
+			{
+				if (layer.sourceFrame)
+				{
+					layers.push_back(layer);
+				}
+			}
+		}
+		return layers;
+	}
+
+	std::vector<CompositionBand> ImageCompositionPipeline::compositionBands(const std::vector<CompositionLayer>& layers, const int height) const
+	{
+		// Bands start on aligned rows so that no two workers write the same chroma row or cache line of a row.
+		const int bandCount = static_cast<int>(workerPool->getThreadCount()) + 1;
+		int bandHeight = (height + bandCount - 1) / bandCount;
+		bandHeight = std::max((bandHeight + bandRowAlignment - 1) / bandRowAlignment * bandRowAlignment, bandRowAlignment);
+
+		std::vector<CompositionBand> bands;
+		for (int rowBegin = 0; rowBegin < height; rowBegin += bandHeight)
+		{
+			CompositionBand band;
+			band.rowBegin = rowBegin;
+			band.rowEnd = std::min(rowBegin + bandHeight, height);
+			for (size_t i = 0; i < layers.size(); i++)
+			{
+				// One row of slack covers the rounding of subsampled chroma rects.
+				const PixelRect& rect = layers[i].rect;
+				if (rect.y < band.rowEnd + 1 && rect.y + rect.height > band.rowBegin - 1)
+				{
+					band.layers.push_back(i);
+				}
+			}
+			bands.push_back(band);
+		}
+		return bands;
+	}
+
+	void ImageCompositionPipeline::renderBand(const std::vector<CompositionLayer>& layers,
+		const CompositionBand& band,
+		PixelBuffer& workingPixelBuffer,
+		const PixelBuffer::FormatType workingFormat,
+		PixelBuffer* outputPixelBuffer)
+	{
+		const int width = workingPixelBuffer.getWidth();
+		const int height = workingPixelBuffer.getHeight();
+
+		PixelKernels::clear(workingPixelBuffer, workingFormat, band.rowBegin, band.rowEnd);
+
+		for (const size_t index : band.layers)
+		{
+			const CompositionLayer& layer = layers[index];
+			if (layer.transitionFrame)
+			{
+				assert(layer.format == workingFormat);
+				for (int i = 0; i < PixelKernels::planeCount(workingFormat); i++)
+				{
+					const bool isChroma = workingFormat == PixelBuffer::FormatType::yuv420p && i > 0;
+					const PixelPlane from = PixelKernels::plane(*layer.sourceFrame, workingFormat, i);
+					const PixelPlane to = PixelKernels::plane(*layer.transitionFrame, workingFormat, i);
+					const PixelPlane dst = PixelKernels::plane(workingPixelBuffer, workingFormat, i);
+					const PixelRect rect = isChroma ? layer.rect.chroma() : layer.rect;
+					PixelKernels::scaleBlendPlanes(from, to, dst, rect,
+						transitionBlend(layer, workingFormat, i, rect.width),
+						isChroma ? band.rowBegin / 2 : band.rowBegin,
+						isChroma ? (band.rowEnd + 1) / 2 : band.rowEnd);
+				}
+			}
+			else if (workingFormat == PixelBuffer::FormatType::yuv420p)
+			{
+				for (int i = 0; i < PixelKernels::planeCount(workingFormat); i++)
+				{
+					const PixelPlane src = PixelKernels::plane(*layer.sourceFrame, workingFormat, i);
+					const PixelPlane dst = PixelKernels::plane(workingPixelBuffer, workingFormat, i);
+					if (i == 0)
+					{
+						PixelKernels::scalePlane(src, dst, layer.rect, band.rowBegin, band.rowEnd);
+					}
+					else
+					{
+						PixelKernels::scalePlane(src, dst, layer.rect.chroma(), band.rowBegin / 2, (band.rowEnd + 1) / 2);
+					}
+				}
+			}
+			else if (layer.format == PixelBuffer::FormatType::yuv420p)
+			{
+				const PixelPlane dst = PixelKernels::plane(workingPixelBuffer, workingFormat, 0);
+				PixelKernels::scaleYUV420PToRGBA8(*layer.sourceFrame, dst, layer.rect, band.rowBegin, band.rowEnd);
+			}
+			else
+			{
+				const PixelPlane src = PixelKernels::plane(*layer.sourceFrame, workingFormat, 0);
+				const PixelPlane dst = PixelKernels::plane(workingPixelBuffer, workingFormat, 0);
+				PixelKernels::scaleSourceOverRGBA8(src, dst, layer.rect, band.rowBegin, band.rowEnd);
+			}
+		}
+
+		if (outputPixelBuffer == nullptr)
+		{
+			return;
+		}
+		if (workingFormat == PixelBuffer::FormatType::yuv420p)
+		{
+			PixelKernels::convertYUV420PToRGBA8(workingPixelBuffer, *outputPixelBuffer, width, height, band.rowBegin, band.rowEnd);
+		}
+		else
+		{
+			PixelKernels::convertRGBA8ToYUV420P(workingPixelBuffer, *outputPixelBuffer, width, height, band.rowBegin, band.rowEnd);
+		}
+	}
+
+	PixelBlend ImageCompositionPipeline::transitionBlend(const CompositionLayer & layer, const PixelBuffer::FormatType format, const int planeIndex, const int width)
+	{
+		const float progress = layer.transitionProgress;
+		PixelBlend blend;
+		switch (layer.transitionType)
+		{
+		case VideoTransitionType::crossDissolve:
+		{
+			const int weight = static_cast<int>(lroundf(progress * 256.0f));
+			blend.trailing.from = 256 - weight;
+			blend.trailing.to = weight;
+			break;
+		}
+		case VideoTransitionType::dipToBlack:
+		{
+			// The first half fades out to black, the second half fades in from it.
+			blend.trailing.from = progress < 0.5f ? static_cast<int>(lroundf((1.0f - 2.0f * progress) * 256.0f)) : 0;
+			blend.trailing.to = progress < 0.5f ? 0 : static_cast<int>(lroundf((2.0f * progress - 1.0f) * 256.0f));
+			break;
+		}
+		case VideoTransitionType::wipe:
+		{
+			blend.leading.from = 0;
+			blend.leading.to = 256;
+			blend.edge = static_cast<int>(lroundf(progress * width));
+			break;
+		}
+		}
+
+		if (format == PixelBuffer::FormatType::yuv420p)
+		{
+			blend.background[0] = planeIndex == 0 ? 16 : 128;
+		}
+		return blend;
+	}
+
+	std::vector<PixelBuffer*> ImageCompositionPipeline::scratchPixelBuffers(const int width, const int height, const PixelBuffer::FormatType format, const unsigned int count)
+	{
+		if (scratchPool == nullptr || 
+			scratchWidth != width || 
+			scratchHeight != height || 
+			scratchFormat != format || 
+			scratchCapacity < count)
+		{
+			scratchCapacity = std::max(count, scratchCapacity);
+			scratchPool = std::make_unique<PixelBufferPool>(width, height, scratchCapacity, format);
+			scratchWidth = width;
+			scratchHeight = height;
+			scratchFormat = format;
+		}
+		std::vector<PixelBuffer*> pixelBuffers;
+		for (unsigned int i = 0; i < count; i++)
+		{
+			pixelBuffers.push_back(scratchPool->pixelBuffer());
+		}
+		return pixelBuffers;
 	}
 }
\ No newline at end of file
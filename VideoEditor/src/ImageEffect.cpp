@@ -0,0 +1,547 @@
+// Copyright (C) 2021 lmc
+//
+// This file is part of VideoEditor.
+//
+// VideoEditor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// VideoEditor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with VideoEditor.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "ImageEffect.hpp"
+#include <assert.h>
+#include <ctype.h>
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <spdlog/spdlog.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define VideoEditor_ImageEffect_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace ks
+{
+	ColorMatrixEffect::ColorMatrixEffect(const std::array<float, 12>& matrix)
+		: matrix(matrix)
+	{
+	}
+
+	bool ColorMatrixEffect::isPointEffect() const
+	{
+		return true;
+	}
+
+	bool ColorMatrixEffect::colorMatrix(std::array<float, 12>& outMatrix) const
+	{
+		outMatrix = matrix;
+		return true;
+	}
+
+	void ColorMatrixEffect::processRow(unsigned char * rgba, const int width) const
+	{
+#ifdef VideoEditor_ImageEffect_SSE2
+		// Column i holds what input channel i adds to every output channel, alpha passes through.
+		const __m128 red = _mm_setr_ps(matrix[0], matrix[4], matrix[8], 0.0f);
+		const __m128 green = _mm_setr_ps(matrix[1], matrix[5], matrix[9], 0.0f);
+		const __m128 blue = _mm_setr_ps(matrix[2], matrix[6], matrix[10], 0.0f);
+		const __m128 alpha = _mm_setr_ps(0.0f, 0.0f, 0.0f, 1.0f);
+		const __m128 offset = _mm_setr_ps(matrix[3] * 255.0f, matrix[7] * 255.0f, matrix[11] * 255.0f, 0.0f);
+		const __m128i zero = _mm_setzero_si128();
+
+		// Four pixels at a time, transposed so that each register holds one channel of all four.
+		const __m128 m0 = _mm_set1_ps(matrix[0]), m1 = _mm_set1_ps(matrix[1]), m2 = _mm_set1_ps(matrix[2]), m3 = _mm_set1_ps(matrix[3] * 255.0f);
+		const __m128 m4 = _mm_set1_ps(matrix[4]), m5 = _mm_set1_ps(matrix[5]), m6 = _mm_set1_ps(matrix[6]), m7 = _mm_set1_ps(matrix[7] * 255.0f);
+		const __m128 m8 = _mm_set1_ps(matrix[8]), m9 = _mm_set1_ps(matrix[9]), m10 = _mm_set1_ps(matrix[10]), m11 = _mm_set1_ps(matrix[11] * 255.0f);
+		int x = 0;
+		for (; x + 4 <= width; x += 4)
+		{
+			const __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rgba + x * 4));
+			const __m128i low = _mm_unpacklo_epi8(pixels, zero);
+			const __m128i high = _mm_unpackhi_epi8(pixels, zero);
+			__m128 r = _mm_cvtepi32_ps(_mm_unpacklo_epi16(low, zero));
+			__m128 g = _mm_cvtepi32_ps(_mm_unpackhi_epi16(low, zero));
+			__m128 b = _mm_cvtepi32_ps(_mm_unpacklo_epi16(high, zero));
+			__m128 a = _mm_cvtepi32_ps(_mm_unpackhi_epi16(high, zero));
+			_MM_TRANSPOSE4_PS(r, g, b, a);
+
+			__m128 outR = _mm_add_ps(_mm_add_ps(_mm_mul_ps(r, m0), _mm_mul_ps(g, m1)), _mm_add_ps(_mm_mul_ps(b, m2), m3));
+			__m128 outG = _mm_add_ps(_mm_add_ps(_mm_mul_ps(r, m4), _mm_mul_ps(g, m5)), _mm_add_ps(_mm_mul_ps(b, m6), m7));
+			__m128 outB = _mm_add_ps(_mm_add_ps(_mm_mul_ps(r, m8), _mm_mul_ps(g, m9)), _mm_add_ps(_mm_mul_ps(b, m10), m11));
+			_MM_TRANSPOSE4_PS(outR, outG, outB, a);
+
+			// Saturating packs clamp to [0, 255].
+			const __m128i out01 = _mm_packs_epi32(_mm_cvtps_epi32(outR), _mm_cvtps_epi32(outG));
+			const __m128i out23 = _mm_packs_epi32(_mm_cvtps_epi32(outB), _mm_cvtps_epi32(a));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(rgba + x * 4), _mm_packus_epi16(out01, out23));
+		}
+		for (; x < width; x++)
+		{
+			int packed = 0;
+			memcpy(&packed, rgba + x * 4, 4);
+			__m128i pixel = _mm_cvtsi32_si128(packed);
+			pixel = _mm_unpacklo_epi16(_mm_unpacklo_epi8(pixel, zero), zero);
+			const __m128 value = _mm_cvtepi32_ps(pixel);
+
+			__m128 result = offset;
+			result = _mm_add_ps(result, _mm_mul_ps(_mm_shuffle_ps(value, value, _MM_SHUFFLE(0, 0, 0, 0)), red));
+			result = _mm_add_ps(result, _mm_mul_ps(_mm_shuffle_ps(value, value, _MM_SHUFFLE(1, 1, 1, 1)), green));
+			result = _mm_add_ps(result, _mm_mul_ps(_mm_shuffle_ps(value, value, _MM_SHUFFLE(2, 2, 2, 2)), blue));
+			result = _mm_add_ps(result, _mm_mul_ps(_mm_shuffle_ps(value, value, _MM_SHUFFLE(3, 3, 3, 3)), alpha));
+
+			// Saturating packs clamp to [0, 255].
+			__m128i out = _mm_cvtps_epi32(result);
+			out = _mm_packs_epi32(out, out);
+			out = _mm_packus_epi16(out, out);
+			packed = _mm_cvtsi128_si32(out);
+			memcpy(rgba + x * 4, &packed, 4);
+		}
+#else
+		for (int x = 0; x < width; x++)
+		{
+			unsigned char* pixel = rgba + x * 4;
+			const float r = pixel[0];
+			const float g = pixel[1];
+			const float b = pixel[2];
+			for (int c = 0; c < 3; c++)
+			{
+				const float value = matrix[c * 4 + 0] * r + matrix[c * 4 + 1] * g + matrix[c * 4 + 2] * b + matrix[c * 4 + 3] * 255.0f;
+				pixel[c] = static_cast<unsigned char>(std::min(std::max(lroundf(value), 0L), 255L));
+			}
+		}
+#endif
+	}
+
+	std::array<float, 12> ColorMatrixEffect::identity()
+	{
+		return { 1.0f, 0.0f, 0.0f, 0.0f,
+			0.0f, 1.0f, 0.0f, 0.0f,
+			0.0f, 0.0f, 1.0f, 0.0f };
+	}
+
+	std::array<float, 12> ColorMatrixEffect::concat(const std::array<float, 12>& first, const std::array<float, 12>& second)
+	{
+		std::array<float, 12> matrix;
+		for (int row = 0; row < 3; row++)
+		{
+			for (int column = 0; column < 4; column++)
+			{
+				float value = column == 3 ? second[row * 4 + 3] : 0.0f;
+				for (int k = 0; k < 3; k++)
+				{
+					value += second[row * 4 + k] * first[k * 4 + column];
+				}
+				matrix[row * 4 + column] = value;
+			}
+		}
+		return matrix;
+	}
+
+	BrightnessContrastEffect::BrightnessContrastEffect(const float brightness, const float contrast)
+		: ColorMatrixEffect(makeMatrix(brightness, contrast))
+	{
+	}
+
+	std::array<float, 12> BrightnessContrastEffect::makeMatrix(const float brightness, const float contrast)
+	{
+		// Contrast pivots around mid grey, brightness is added afterwards.
+		const float offset = 0.5f * (1.0f - contrast) + brightness;
+		return { contrast, 0.0f, 0.0f, offset,
+			0.0f, contrast, 0.0f, offset,
+			0.0f, 0.0f, contrast, offset };
+	}
+
+	LUT3DEffect* LUT3DEffect::New(const std::string & cubeFilePath)
+	{
+		std::ifstream file(cubeFilePath);
+		if (file.is_open() == false)
+		{
+			spdlog::error("can not open lut {}", cubeFilePath);
+			return nullptr;
+		}
+
+		LUT3DEffect* effect = new LUT3DEffect();
+		std::string line;
+		while (std::getline(file, line))
+		{
+			std::istringstream stream(line);
+			std::string keyword;
+			if (!(stream >> keyword) || keyword[0] == '#')
+			{
+				continue;
+			}
+			if (keyword == "LUT_3D_SIZE")
+			{
+				stream >> effect->size;
+				effect->table.reserve(effect->size * effect->size * effect->size * 3);
+			}
+			else if (keyword == "LUT_1D_SIZE")
+			{
+				spdlog::error("1D lut is not supported {}", cubeFilePath);
+				delete effect;
+				return nullptr;
+			}
+			else if (isdigit(static_cast<unsigned char>(keyword[0])) || keyword[0] == '-' || keyword[0] == '.')
+			{
+				// Red changes fastest, then green, then blue.
+				float green = 0.0f;
+				float blue = 0.0f;
+				stream >> green >> blue;
+				effect->table.push_back(std::stof(keyword));
+				effect->table.push_back(green);
+				effect->table.push_back(blue);
+			}
+		}
+
+		const size_t entryCount = static_cast<size_t>(effect->size) * effect->size * effect->size;
+		if (effect->size < 2 || effect->table.size() != entryCount * 3)
+		{
+			spdlog::error("invalid lut {}", cubeFilePath);
+			delete effect;
+			return nullptr;
+		}
+		// Entries are loaded four floats at a time, the last one reads one past its end.
+		effect->table.push_back(0.0f);
+		return effect;
+	}
+
+	bool LUT3DEffect::isPointEffect() const
+	{
+		return true;
+	}
+
+	void LUT3DEffect::processRow(unsigned char * rgba, const int width) const
+	{
+		const float scale = static_cast<float>(size - 1) / 255.0f;
+		const int strideG = size * 3;
+		const int strideB = size * size * 3;
+
+		for (int x = 0; x < width; x++)
+		{
+			unsigned char* pixel = rgba + x * 4;
+			const float r = pixel[0] * scale;
+			const float g = pixel[1] * scale;
+			const float b = pixel[2] * scale;
+			const int r0 = std::min(static_cast<int>(r), size - 2);
+			const int g0 = std::min(static_cast<int>(g), size - 2);
+			const int b0 = std::min(static_cast<int>(b), size - 2);
+			const float dr = r - r0;
+			const float dg = g - g0;
+			const float db = b - b0;
+
+			// Tetrahedral interpolation: walk from c000 to c111 along the edges ordered by the fractions.
+			const float* c000 = table.data() + b0 * strideB + g0 * strideG + r0 * 3;
+			const float* c111 = c000 + strideB + strideG + 3;
+			const float* first = nullptr;
+			const float* second = nullptr;
+			float w0 = 0.0f;
+			float w1 = 0.0f;
+			float w2 = 0.0f;
+			if (dr >= dg)
+			{
+				if (dg >= db)
+				{
+					first = c000 + 3;
+					second = c000 + strideG + 3;
+					w0 = dr; w1 = dg; w2 = db;
+				}
+				else if (dr >= db)
+				{
+					first = c000 + 3;
+					second = c000 + strideB + 3;
+					w0 = dr; w1 = db; w2 = dg;
+				}
+				else
+				{
+					first = c000 + strideB;
+					second = c000 + strideB + 3;
+					w0 = db; w1 = dr; w2 = dg;
+				}
+			}
+			else
+			{
+				if (db >= dg)
+				{
+					first = c000 + strideB;
+					second = c000 + strideB + strideG;
+					w0 = db; w1 = dg; w2 = dr;
+				}
+				else if (db >= dr)
+				{
+					first = c000 + strideG;
+					second = c000 + strideB + strideG;
+					w0 = dg; w1 = db; w2 = dr;
+				}
+				else
+				{
+					first = c000 + strideG;
+					second = c000 + strideG + 3;
+					w0 = dg; w1 = dr; w2 = db;
+				}
+			}
+
+#ifdef VideoEditor_ImageEffect_SSE2
+			// The three channels of the four corners are blended in one register, the fourth lane is ignored.
+			__m128 value = _mm_mul_ps(_mm_loadu_ps(c000), _mm_set1_ps(1.0f - w0));
+			value = _mm_add_ps(value, _mm_mul_ps(_mm_loadu_ps(first), _mm_set1_ps(w0 - w1)));
+			value = _mm_add_ps(value, _mm_mul_ps(_mm_loadu_ps(second), _mm_set1_ps(w1 - w2)));
+			value = _mm_add_ps(value, _mm_mul_ps(_mm_loadu_ps(c111), _mm_set1_ps(w2)));
+			__m128i out = _mm_cvtps_epi32(_mm_mul_ps(value, _mm_set1_ps(255.0f)));
+			out = _mm_packs_epi32(out, out);
+			out = _mm_packus_epi16(out, out);
+			const int packed = _mm_cvtsi128_si32(out);
+			memcpy(pixel, &packed, 3);
+#else
+			for (int c = 0; c < 3; c++)
+			{
+				const float value = (1.0f - w0) * c000[c] + (w0 - w1) * first[c] + (w1 - w2) * second[c] + w2 * c111[c];
+				pixel[c] = static_cast<unsigned char>(std::min(std::max(lroundf(value * 255.0f), 0L), 255L));
+			}
+#endif
+		}
+	}
+
+	BoxBlurEffect::BoxBlurEffect(const int radius)
+		: radius(std::max(radius, 0))
+	{
+	}
+
+	bool BoxBlurEffect::isPointEffect() const
+	{
+		return false;
+	}
+
+	void BoxBlurEffect::process(const PixelPlane & plane) const
+	{
+		thread_local std::vector<unsigned char> scratch;
+		thread_local std::vector<unsigned int> sums;
+		blur(plane, radius, scratch, sums);
+	}
+
+	void BoxBlurEffect::blur(const PixelPlane & plane, const int radius, std::vector<unsigned char>& scratch, std::vector<unsigned int>& sums)
+	{
+		assert(plane.bytesPerPixel == 4);
+		if (radius <= 0 || plane.width <= 0 || plane.height <= 0)
+		{
+			return;
+		}
+		const int width = plane.width;
+		const int height = plane.height;
+		const int rowLength = width * 4;
+		// Division by the window size as a 16 bit fixed point multiply.
+		const unsigned int scale = (65536u + radius) / (2u * radius + 1u);
+
+		scratch.resize(static_cast<size_t>(rowLength) * height);
+		sums.resize(rowLength);
+
+		// Horizontal running sums, edges clamped.
+#ifdef VideoEditor_ImageEffect_SSE2
+		// The four channels of a pixel run in one register. sum * scale stays below 2^24,
+		// so the float multiply is exact and the result matches the integer path bit for bit.
+		const __m128i zero = _mm_setzero_si128();
+		const __m128 scaleVector = _mm_set1_ps(static_cast<float>(scale));
+		const __m128 half = _mm_set1_ps(32768.0f);
+		const __m128 unit = _mm_set1_ps(1.0f / 65536.0f);
+		auto loadPixel = [&zero](const unsigned char* pixel)
+		{
+			int packed = 0;
+			memcpy(&packed, pixel, 4);
+			return _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(packed), zero), zero);
+		};
+		for (int y = 0; y < height; y++)
+		{
+			const unsigned char* src = plane.data + y * plane.bytesPerRow;
+			unsigned char* dst = scratch.data() + y * rowLength;
+			__m128i sum = zero;
+			for (int i = -radius; i <= radius; i++)
+			{
+				sum = _mm_add_epi32(sum, loadPixel(src + std::min(std::max(i, 0), width - 1) * 4));
+			}
+			for (int x = 0; x < width; x++)
+			{
+				const __m128 scaled = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(sum), scaleVector), half), unit);
+				__m128i out = _mm_cvttps_epi32(scaled);
+				out = _mm_packs_epi32(out, out);
+				out = _mm_packus_epi16(out, out);
+				const int packed = _mm_cvtsi128_si32(out);
+				memcpy(dst + x * 4, &packed, 4);
+				sum = _mm_add_epi32(sum, loadPixel(src + std::min(x + radius + 1, width - 1) * 4));
+				sum = _mm_sub_epi32(sum, loadPixel(src + std::max(x - radius, 0) * 4));
+			}
+		}
+#else
+		for (int y = 0; y < height; y++)
+		{
+			const unsigned char* src = plane.data + y * plane.bytesPerRow;
+			unsigned char* dst = scratch.data() + y * rowLength;
+			for (int c = 0; c < 4; c++)
+			{
+				unsigned int sum = src[c] * (radius + 1);
+				for (int i = 1; i <= radius; i++)
+				{
+					sum += src[std::min(i, width - 1) * 4 + c];
+				}
+				for (int x = 0; x < width; x++)
+				{
+					dst[x * 4 + c] = static_cast<unsigned char>((sum * scale + 32768u) >> 16);
+					sum += src[std::min(x + radius + 1, width - 1) * 4 + c];
+					sum -= src[std::max(x - radius, 0) * 4 + c];
+				}
+			}
+		}
+#endif
+
+		// Vertical running sums over whole rows, the inner loops are contiguous and vectorize.
+		const unsigned char* first = scratch.data();
+		for (int i = 0; i < rowLength; i++)
+		{
+			sums[i] = first[i] * (radius + 1);
+		}
+		for (int j = 1; j <= radius; j++)
+		{
+			const unsigned char* row = scratch.data() + std::min(j, height - 1) * rowLength;
+			for (int i = 0; i < rowLength; i++)
+			{
+				sums[i] += row[i];
+			}
+		}
+		for (int y = 0; y < height; y++)
+		{
+			unsigned char* dst = plane.data + y * plane.bytesPerRow;
+			const unsigned char* added = scratch.data() + std::min(y + radius + 1, height - 1) * rowLength;
+			const unsigned char* removed = scratch.data() + std::max(y - radius, 0) * rowLength;
+			for (int i = 0; i < rowLength; i++)
+			{
+				dst[i] = static_cast<unsigned char>((sums[i] * scale + 32768u) >> 16);
+				sums[i] += added[i];
+				sums[i] -= removed[i];
+			}
+		}
+	}
+
+	GaussianBlurEffect::GaussianBlurEffect(const float sigma)
+	{
+		// Box widths whose three passes match the variance of the gaussian.
+		const int passCount = static_cast<int>(radii.size());
+		const float variance = std::max(sigma, 0.0f) * std::max(sigma, 0.0f);
+		int lower = static_cast<int>(floorf(sqrtf(12.0f * variance / passCount + 1.0f)));
+		if (lower % 2 == 0)
+		{
+			lower--;
+		}
+		const int upper = lower + 2;
+		const int lowerCount = static_cast<int>(lroundf((12.0f * variance - passCount * lower * lower - 4.0f * passCount * lower - 3.0f * passCount) /
+			(-4.0f * lower - 4.0f)));
+		for (int i = 0; i < passCount; i++)
+		{
+			radii[i] = ((i < lowerCount ? lower : upper) - 1) / 2;
+		}
+	}
+
+	bool GaussianBlurEffect::isPointEffect() const
+	{
+		return false;
+	}
+
+	void GaussianBlurEffect::process(const PixelPlane & plane) const
+	{
+		thread_local std::vector<unsigned char> scratch;
+		thread_local std::vector<unsigned int> sums;
+		for (const int radius : radii)
+		{
+			BoxBlurEffect::blur(plane, radius, scratch, sums);
+		}
+	}
+
+	void ImageEffectChain::append(std::shared_ptr<IImageEffect> effect)
+	{
+		assert(effect);
+		effects.push_back(effect);
+		compile();
+	}
+
+	bool ImageEffectChain::isEmpty() const
+	{
+		return effects.empty();
+	}
+
+	void ImageEffectChain::compile()
+	{
+		// Neighbouring affine effects fold into one matrix, neighbouring point effects share one pass over the rows.
+		stages.clear();
+		Stage stage;
+		std::array<float, 12> pendingMatrix = ColorMatrixEffect::identity();
+		bool hasPendingMatrix = false;
+
+		auto flushMatrix = [&]()
+		{
+			if (hasPendingMatrix)
+			{
+				stage.pointEffects.push_back(std::make_shared<ColorMatrixEffect>(pendingMatrix));
+				pendingMatrix = ColorMatrixEffect::identity();
+				hasPendingMatrix = false;
+			}
+		};
+
+		for (const std::shared_ptr<IImageEffect>& effect : effects)
+		{
+			std::array<float, 12> matrix;
+			if (effect->isPointEffect() && effect->colorMatrix(matrix))
+			{
+				pendingMatrix = ColorMatrixEffect::concat(pendingMatrix, matrix);
+				hasPendingMatrix = true;
+			}
+			else if (effect->isPointEffect())
+			{
+				flushMatrix();
+				stage.pointEffects.push_back(effect);
+			}
+			else
+			{
+				flushMatrix();
+				stage.planeEffect = effect;
+				stages.push_back(stage);
+				stage = Stage();
+			}
+		}
+		flushMatrix();
+		if (stage.pointEffects.empty() == false)
+		{
+			stages.push_back(stage);
+		}
+	}
+
+	void ImageEffectChain::apply(PixelBuffer & pixelBuffer) const
+	{
+		const PixelPlane plane = PixelKernels::plane(pixelBuffer, PixelBuffer::FormatType::rgba8, 0);
+		for (const Stage& stage : stages)
+		{
+			if (stage.pointEffects.empty() == false)
+			{
+				// Every point effect runs on a row while it is still in cache.
+				for (int y = 0; y < plane.height; y++)
+				{
+					unsigned char* row = plane.data + y * plane.bytesPerRow;
+					for (const std::shared_ptr<IImageEffect>& effect : stage.pointEffects)
+					{
+						effect->processRow(row, plane.width);
+					}
+				}
+			}
+			if (stage.planeEffect)
+			{
+				stage.planeEffect->process(plane);
+			}
+		}
+	}
+}
@@ -36,6 +36,7 @@ namespace ks
 			timer->invalidate();
 			timer = nullptr;
 		}
+		sourceFrameLoader.cancelPrewarms();
 	}
 
 	void FImagePlayer::play()
@@ -70,6 +71,16 @@ namespace ks
 			timer->invalidate();
 			timer = nullptr;
 		}
+		// Prewarms of the old description's tracks must not outlive them.
+		sourceFrameLoader.cancelPrewarms();
+		{
+			// Earlier outputs live in the pool reset below and were composed from the old tracks.
+			std::lock_guard<std::mutex> lock(pipelineMutex);
+			if (pipeline)
+			{
+				pipeline->flush();
+			}
+		}
 
 		if (videoDescription)
 		{
@@ -79,7 +90,7 @@ namespace ks
 			resetPixelBufferPool(videoRenderContext);
 			openDecodeImageThreadIfNeed();
 
-			const MediaTime fps = MediaTime(1.0 / videoDescription->renderContext.videoRenderContext.fps, timeScale);
+			const MediaTime fps = getFrameDuration(videoDescription->renderContext.videoRenderContext.fps);
 
 			timer = new SimpleTimer(25, [this, fps](SimpleTimer& timer)
 			{
@@ -154,7 +165,7 @@ namespace ks
 	void FImagePlayer::openDecodeImageThread()
 	{
 		assert(videoDescription);
-		const MediaTime fps = MediaTime(1.0 / videoDescription->renderContext.videoRenderContext.fps, timeScale);
+		const MediaTime fps = getFrameDuration(videoDescription->renderContext.videoRenderContext.fps);
 
 		std::thread([this, fps]()
 		{
@@ -179,11 +190,13 @@ namespace ks
 				bool isTracing = false;
 				bool isRequestsEmpty = false;
 				bool isLargeThanCacheSize = false;
+				size_t requestCount = 0;
 				std::optional<AsyncImageCompositionRequest> frontRequest = std::nullopt;
 				{
 					std::lock_guard<std::mutex> lock(requestsMutex);
 					isRequestsEmpty = requests.empty();
 					isLargeThanCacheSize = requests.size() >= cacheSize;
+					requestCount = requests.size();
 					if (isRequestsEmpty == false)
 					{
 						frontRequest = requests.front();
@@ -212,16 +225,49 @@ namespace ks
 					{
 						imageTrack->onSeeking(compositionTime);
 					}
+					if (pipeline)
+					{
+						// Outputs of earlier requests live in recycled pool buffers.
+						pipeline->flush();
+					}
 				}
 				std::optional<AsyncImageCompositionRequest> nextRequest = getNextRequest(compositionTime);
 				if (nextRequest && pipeline)
 				{
+					// The first frame after a seek is waited on, render it across all cores.
+					nextRequest->isLowLatency = isTracing;
+					std::vector<AsyncImageCompositionRequest> nextRequests = { *nextRequest };
+
+					// While prefetching, following frames of the same instruction go to the pipeline as one batch.
+					while (isTracing == false &&
+						nextRequests.size() < compositionBatchSize &&
+						requestCount + nextRequests.size() < cacheSize)
+					{
+						MediaTime nextTime = MediaTime(compositionTime.timeValue() + fps.timeValue(), timeScale);
+						nextTime = round(nextTime, fps);
+						VideoInstruction nextInstruction;
+						if (nextTime >= currentVideoDuration ||
+							videoDescription->videoInstuction(nextTime, nextInstruction) == false ||
+							nextInstruction.timeRange.start != nextRequest->instruction.timeRange.start)
+						{
+							break;
+						}
+						std::optional<AsyncImageCompositionRequest> runRequest = getNextRequest(nextTime);
+						if (runRequest == std::nullopt)
+						{
+							break;
+						}
+						nextRequests.push_back(*runRequest);
+						compositionTime = nextTime;
+					}
+
 					std::lock_guard<std::mutex> lock(requestsMutex);
-					pipeline->composition(*nextRequest, [this]()
+					pipeline->batchComposition(nextRequests, [this]()
 					{
 						return pixelBufferPool->pixelBuffer();
-					});
-					requests.emplace_back(*nextRequest);
+					}, pixelBufferPool);
+					nextRequest = nextRequests.front();
+					requests.insert(requests.end(), nextRequests.begin(), nextRequests.end());
 				}
 				if (isTracing)
 				{
@@ -259,11 +305,8 @@ namespace ks
 			request.compositionTime = compositionTime;
 			request.videoRenderContext = &videoRenderContext;
 			request.instruction = videoInstuction;
-			for (IImageTrack *imageTrack : videoInstuction.imageTracks)
-			{
-				const PixelBuffer *sourceFrame = imageTrack->sourceFrame(compositionTime, videoRenderContext);
-				request.sourceFrames[imageTrack->trackID] = sourceFrame;
-			}
+			request.pixelBufferFormat = PixelBuffer::FormatType::rgba8;
+			sourceFrameLoader.load(request, videoRenderContext, videoDescription);
 			return request;
 		}
 		else
@@ -297,7 +340,8 @@ namespace ks
 		}
 		const unsigned int width = videoRenderContext.renderSize.width * videoRenderContext.renderScale;
 		const unsigned int height = videoRenderContext.renderSize.height * videoRenderContext.renderScale;
-		pixelBufferPool = new PixelBufferPool(width, height, cacheSize + 1, videoRenderContext.format);
+		// Frames are handed to the display as rgba whatever format the composition works in.
+		pixelBufferPool = new PixelBufferPool(width, height, cacheSize + ImageCompositionPipeline::spareOutputCount, PixelBuffer::FormatType::rgba8);
 	}
 
 	void FImagePlayer::openDecodeImageThreadIfNeed()
@@ -0,0 +1,366 @@
+// Copyright (C) 2021 lmc
+// 
+// This file is part of VideoEditor.
+// 
+// VideoEditor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+// 
+// VideoEditor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with VideoEditor.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "ImageSequenceTrack.hpp"
+#include <assert.h>
+#include <limits.h>
+#include <algorithm>
+#include <math.h>
+#include <ctype.h>
+#include <stdio.h>
+#include <vector>
+#include <spdlog/spdlog.h>
+#include "Util.hpp"
+
+namespace ks
+{
+	ImageSequenceTrack::ImageSequenceTrack()
+	{
+	}
+
+	ImageSequenceTrack::~ImageSequenceTrack()
+	{
+		{
+			// Queued decodes still point at the track, they return at once now.
+			std::unique_lock<std::mutex> lock(framesMutex);
+			isStopping = true;
+			framesCondition.wait(lock, [this]()
+			{
+				return queuedDecodeCount == 0;
+			});
+		}
+		for (auto& item : frames)
+		{
+			if (item.second.pixelBuffer)
+			{
+				delete item.second.pixelBuffer;
+			}
+		}
+		assert(retainCounts.empty());
+		for (PixelBuffer* frame : detachedFrames)
+		{
+			delete frame;
+		}
+	}
+
+	const PixelBuffer * ImageSequenceTrack::sourceFrame(const MediaTime & compositionTime, const VideoRenderContext & renderContext)
+	{
+		const int number = frameNumber(compositionTime);
+		std::unique_lock<std::mutex> lock(framesMutex);
+		return currentFrame(number, lock);
+	}
+
+	SourceFrameHandle ImageSequenceTrack::retainSourceFrame(const MediaTime & compositionTime, const VideoRenderContext & renderContext)
+	{
+		const int number = frameNumber(compositionTime);
+		std::unique_lock<std::mutex> lock(framesMutex);
+
+		const PixelBuffer* frame = currentFrame(number, lock);
+		if (frame == nullptr)
+		{
+			return nullptr;
+		}
+		retainCounts[frame]++;
+		return SourceFrameHandle(frame, [this](const PixelBuffer* retainedFrame)
+		{
+			std::lock_guard<std::mutex> lock(framesMutex);
+			releaseRetainedFrame(retainedFrame);
+		});
+	}
+
+	const PixelBuffer * ImageSequenceTrack::currentFrame(const int number, std::unique_lock<std::mutex>& lock)
+	{
+		lastSourceFrameDisplayTime = frameDisplayTime(number);
+		while (true)
+		{
+			auto iter = frames.find(number);
+			if (iter == frames.end())
+			{
+				// Not prefetched: decode on the calling thread rather than queue behind the look-ahead.
+				// A frame asked for is kept even below the last flush, e.g. when the player trails the export.
+				firstKeptFrameNumber = std::min(firstKeptFrameNumber, number);
+				Frame frame;
+				frame.generation = generation;
+				frames[number] = frame;
+				lock.unlock();
+				decodeFrame(number, frame.generation);
+				lock.lock();
+				continue;
+			}
+			if (iter->second.isDecoding && iter->second.isClaimed == false)
+			{
+				// Still queued behind other work of the shared pool, decode it here instead of waiting.
+				const unsigned int frameGeneration = iter->second.generation;
+				lock.unlock();
+				decodeFrame(number, frameGeneration);
+				lock.lock();
+				continue;
+			}
+			if (iter->second.isDecoding)
+			{
+				framesCondition.wait(lock);
+				continue;
+			}
+			prefetch(number);
+			return iter->second.pixelBuffer;
+		}
+	}
+
+	MediaTime ImageSequenceTrack::sourceFrameDisplayTime(const MediaTime & compositionTime)
+	{
+		std::lock_guard<std::mutex> lock(framesMutex);
+		return lastSourceFrameDisplayTime;
+	}
+
+	const PixelBuffer * ImageSequenceTrack::compositionImage(const PixelBuffer & sourceFrame, const MediaTime & compositionTime, const VideoRenderContext & renderContext)
+	{
+		return &sourceFrame;
+	}
+
+	PixelBuffer::FormatType ImageSequenceTrack::compositionImageFormat(const VideoRenderContext & renderContext) const
+	{
+		// png, tiff and exr plates may carry alpha.
+		return PixelBuffer::FormatType::rgba8;
+	}
+
+	void ImageSequenceTrack::prepare(const VideoRenderContext & renderContext)
+	{
+		{
+			std::lock_guard<std::mutex> lock(framesMutex);
+			if (makeFramePathFormat(filePattern, framePathFormat) == false)
+			{
+				spdlog::error("image sequence pattern {} needs exactly one integer conversion", filePattern);
+				framePathFormat.clear();
+			}
+		}
+	}
+
+	void ImageSequenceTrack::onSeeking(const MediaTime & compositionTime)
+	{
+		flush();
+	}
+
+	void ImageSequenceTrack::flush(const MediaTime & compositionTime)
+	{
+		std::lock_guard<std::mutex> lock(framesMutex);
+		releaseFrames(frameNumber(compositionTime));
+	}
+
+	void ImageSequenceTrack::flush()
+	{
+		std::lock_guard<std::mutex> lock(framesMutex);
+		generation++;
+		releaseFrames(INT_MAX);
+		firstKeptFrameNumber = INT_MIN;
+		// Decodes in flight belong to the old generation and drop their frames.
+		for (auto iter = frames.begin(); iter != frames.end();)
+		{
+			iter = iter->second.isDecoding ? frames.erase(iter) : std::next(iter);
+		}
+		framesCondition.notify_all();
+	}
+
+	void ImageSequenceTrack::releaseFrames(const int endFrameNumber)
+	{
+		firstKeptFrameNumber = std::max(firstKeptFrameNumber, endFrameNumber);
+		for (auto iter = frames.begin(); iter != frames.end() && iter->first < endFrameNumber;)
+		{
+			if (iter->second.isDecoding)
+			{
+				++iter;
+				continue;
+			}
+			PixelBuffer* pixelBuffer = iter->second.pixelBuffer;
+			if (pixelBuffer && retainCounts.find(pixelBuffer) != retainCounts.end())
+			{
+				detachedFrames.push_back(pixelBuffer);
+			}
+			else if (pixelBuffer)
+			{
+				delete pixelBuffer;
+			}
+			iter = frames.erase(iter);
+		}
+	}
+
+	void ImageSequenceTrack::releaseRetainedFrame(const PixelBuffer * frame)
+	{
+		auto iter = retainCounts.find(frame);
+		assert(iter != retainCounts.end());
+		if (--iter->second > 0)
+		{
+			return;
+		}
+		retainCounts.erase(iter);
+
+		auto detachedIter = std::find(detachedFrames.begin(), detachedFrames.end(), frame);
+		if (detachedIter != detachedFrames.end())
+		{
+			delete *detachedIter;
+			detachedFrames.erase(detachedIter);
+		}
+	}
+
+	int ImageSequenceTrack::frameNumber(const MediaTime & compositionTime) const
+	{
+		const MediaTime sourceTime = getSourceTime(timeMapping, compositionTime);
+		return firstFrameNumber + static_cast<int>(floor(sourceTime.seconds() * frameRate + 1e-6));
+	}
+
+	MediaTime ImageSequenceTrack::frameDisplayTime(const int frameNumber) const
+	{
+		const MediaTime sourceTime = MediaTime(static_cast<double>(frameNumber - firstFrameNumber) / frameRate, 600);
+		return getTargetTime(timeMapping, sourceTime);
+	}
+
+	std::string ImageSequenceTrack::framePath(const int frameNumber) const
+	{
+		if (framePathFormat.empty())
+		{
+			return std::string();
+		}
+		const int length = snprintf(nullptr, 0, framePathFormat.c_str(), frameNumber);
+		std::vector<char> path(std::max(length, 0) + 1);
+		snprintf(path.data(), path.size(), framePathFormat.c_str(), frameNumber);
+		return std::string(path.data());
+	}
+
+	bool ImageSequenceTrack::makeFramePathFormat(const std::string & pattern, std::string & outFormat)
+	{
+		outFormat.clear();
+		unsigned int conversionCount = 0;
+		for (size_t i = 0; i < pattern.size(); i++)
+		{
+			if (pattern[i] != '%')
+			{
+				outFormat += pattern[i];
+				continue;
+			}
+			if (i + 1 < pattern.size() && pattern[i + 1] == '%')
+			{
+				outFormat += "%%";
+				i++;
+				continue;
+			}
+			// Flags and width, then d, i or u. Anything else is a literal %.
+			size_t end = i + 1;
+			while (end < pattern.size() && std::string("-+ #0").find(pattern[end]) != std::string::npos)
+			{
+				end++;
+			}
+			while (end < pattern.size() && isdigit(static_cast<unsigned char>(pattern[end])))
+			{
+				end++;
+			}
+			if (end < pattern.size() && std::string("diu").find(pattern[end]) != std::string::npos)
+			{
+				outFormat += pattern.substr(i, end - i) + "d";
+				conversionCount++;
+				i = end;
+			}
+			else
+			{
+				outFormat += "%%";
+			}
+		}
+		return conversionCount == 1;
+	}
+
+	void ImageSequenceTrack::prefetch(const int frameNumber)
+	{
+		// Without threads the pool would decode inline while prefetch holds framesMutex.
+		WorkerPool& workerPool = WorkerPool::shared();
+		if (decodeThreadCount == 0 || workerPool.getThreadCount() == 0)
+		{
+			return;
+		}
+		const int lastFrameNumber = frameNumber + static_cast<int>(lookAhead);
+		for (int number = frameNumber + 1; number <= lastFrameNumber; number++)
+		{
+			if (queuedDecodeCount >= decodeThreadCount || (frameBytes > 0 && (frames.size() + 1) * frameBytes > memoryCapacity))
+			{
+				break;
+			}
+			if (frames.find(number) != frames.end())
+			{
+				continue;
+			}
+			Frame frame;
+			frame.generation = generation;
+			frames[number] = frame;
+			queuedDecodeCount++;
+			workerPool.dispatch([this, number, frameGeneration = generation]()
+			{
+				decodeFrame(number, frameGeneration);
+				std::lock_guard<std::mutex> lock(framesMutex);
+				queuedDecodeCount--;
+				framesCondition.notify_all();
+			});
+		}
+	}
+
+	void ImageSequenceTrack::decodeFrame(const int frameNumber, const unsigned int frameGeneration)
+	{
+		{
+			std::lock_guard<std::mutex> lock(framesMutex);
+			auto iter = frames.find(frameNumber);
+			if (isStopping || frameGeneration != generation || iter == frames.end() || iter->second.generation != frameGeneration || iter->second.isClaimed)
+			{
+				return;
+			}
+			iter->second.isClaimed = true;
+		}
+
+		PixelBuffer* pixelBuffer = nullptr;
+		const std::string path = framePath(frameNumber);
+		std::unique_ptr<VideoDecoder> decoder = path.empty() ? nullptr : std::unique_ptr<VideoDecoder>(VideoDecoder::New(path, PixelBuffer::FormatType::rgba8));
+		if (decoder)
+		{
+			MediaTime pts;
+			pixelBuffer = decoder->newFrame(pts);
+		}
+		if (pixelBuffer == nullptr)
+		{
+			spdlog::warn("can not decode {}", path);
+		}
+
+		std::lock_guard<std::mutex> lock(framesMutex);
+		auto iter = frames.find(frameNumber);
+		if (iter == frames.end() || iter->second.generation != frameGeneration || iter->second.isDecoding == false || frameNumber < firstKeptFrameNumber)
+		{
+			// Sought or flushed meanwhile.
+			if (pixelBuffer)
+			{
+				delete pixelBuffer;
+			}
+			if (iter != frames.end() && iter->second.generation == frameGeneration && iter->second.isDecoding)
+			{
+				frames.erase(iter);
+			}
+		}
+		else
+		{
+			iter->second.pixelBuffer = pixelBuffer;
+			iter->second.isDecoding = false;
+			if (pixelBuffer && frameBytes == 0)
+			{
+				frameBytes = static_cast<size_t>(pixelBuffer->getWidth()) * pixelBuffer->getHeight() * 4;
+			}
+		}
+		framesCondition.notify_all();
+	}
+}
@@ -0,0 +1,159 @@
+// Copyright (C) 2021 lmc
+// 
+// This file is part of VideoEditor.
+// 
+// VideoEditor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+// 
+// VideoEditor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with VideoEditor.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "MappedFile.hpp"
+#include <algorithm>
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace ks
+{
+#ifdef _WIN32
+	MappedFile* MappedFile::New(const std::string& filePath)
+	{
+		HANDLE fileHandle = CreateFileA(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		if (fileHandle == INVALID_HANDLE_VALUE)
+		{
+			return nullptr;
+		}
+		LARGE_INTEGER fileSize;
+		if (GetFileSizeEx(fileHandle, &fileSize) == FALSE || fileSize.QuadPart == 0)
+		{
+			CloseHandle(fileHandle);
+			return nullptr;
+		}
+		HANDLE mappingHandle = CreateFileMappingA(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (mappingHandle == nullptr)
+		{
+			CloseHandle(fileHandle);
+			return nullptr;
+		}
+		void* bytes = MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0);
+		if (bytes == nullptr)
+		{
+			CloseHandle(mappingHandle);
+			CloseHandle(fileHandle);
+			return nullptr;
+		}
+		MappedFile* mappedFile = new MappedFile();
+		mappedFile->bytes = static_cast<const unsigned char*>(bytes);
+		mappedFile->length = static_cast<size_t>(fileSize.QuadPart);
+		mappedFile->fileHandle = fileHandle;
+		mappedFile->mappingHandle = mappingHandle;
+		return mappedFile;
+	}
+
+	MappedFile::~MappedFile()
+	{
+		UnmapViewOfFile(bytes);
+		CloseHandle(mappingHandle);
+		CloseHandle(fileHandle);
+	}
+
+	void MappedFile::advise(const size_t offset, const size_t length, const Advice advice) const
+	{
+		if (offset >= this->length)
+		{
+			return;
+		}
+#if _WIN32_WINNT >= 0x0602
+		if (advice == Advice::willNeed)
+		{
+			WIN32_MEMORY_RANGE_ENTRY range;
+			range.VirtualAddress = const_cast<unsigned char*>(bytes + offset);
+			range.NumberOfBytes = std::min(length, this->length - offset);
+			PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+		}
+#endif
+	}
+#else
+	MappedFile* MappedFile::New(const std::string& filePath)
+	{
+		const int fileDescriptor = open(filePath.c_str(), O_RDONLY);
+		if (fileDescriptor < 0)
+		{
+			return nullptr;
+		}
+		struct stat fileStat;
+		if (fstat(fileDescriptor, &fileStat) != 0 || fileStat.st_size == 0)
+		{
+			close(fileDescriptor);
+			return nullptr;
+		}
+		void* bytes = mmap(nullptr, static_cast<size_t>(fileStat.st_size), PROT_READ, MAP_SHARED, fileDescriptor, 0);
+		if (bytes == MAP_FAILED)
+		{
+			close(fileDescriptor);
+			return nullptr;
+		}
+		MappedFile* mappedFile = new MappedFile();
+		mappedFile->bytes = static_cast<const unsigned char*>(bytes);
+		mappedFile->length = static_cast<size_t>(fileStat.st_size);
+		mappedFile->fileDescriptor = fileDescriptor;
+		return mappedFile;
+	}
+
+	MappedFile::~MappedFile()
+	{
+		munmap(const_cast<unsigned char*>(bytes), length);
+		close(fileDescriptor);
+	}
+
+	void MappedFile::advise(const size_t offset, const size_t length, const Advice advice) const
+	{
+		if (offset >= this->length)
+		{
+			return;
+		}
+		static const size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+		const size_t begin = offset / pageSize * pageSize;
+		const size_t end = std::min(offset + length, this->length);
+		int flag = POSIX_MADV_NORMAL;
+		switch (advice)
+		{
+		case Advice::sequential:
+			flag = POSIX_MADV_SEQUENTIAL;
+			break;
+		case Advice::willNeed:
+			flag = POSIX_MADV_WILLNEED;
+			break;
+		case Advice::dontNeed:
+			flag = POSIX_MADV_DONTNEED;
+			break;
+		default:
+			break;
+		}
+		posix_madvise(const_cast<unsigned char*>(bytes + begin), end - begin, flag);
+	}
+#endif
+
+	const unsigned char* MappedFile::data() const
+	{
+		return bytes;
+	}
+
+	size_t MappedFile::size() const
+	{
+		return length;
+	}
+}
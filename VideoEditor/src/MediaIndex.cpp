@@ -0,0 +1,207 @@
+// Copyright (C) 2021 lmc
+// 
+// This file is part of VideoEditor.
+// 
+// VideoEditor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+// 
+// VideoEditor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with VideoEditor.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include "MediaIndex.hpp"
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <stdio.h>
+#include <nlohmann/json.hpp>
+#include <spdlog/spdlog.h>
+
+namespace ks
+{
+	typedef nlohmann::json Json;
+
+	static const double mediaIndexTolerance = 1e-6;
+
+	MediaIndex::MediaIndex(const std::string& filePath)
+		: filePath(filePath)
+	{
+	}
+
+	void MediaIndex::recordSeek(const MediaTime& target, const MediaTime& pts)
+	{
+		std::lock_guard<std::mutex> lock(indexMutex);
+
+		const double keyframeSeconds = pts.seconds();
+		// A target before the first keyframe lands on it.
+		const double coveredUntil = std::max(target.seconds(), keyframeSeconds);
+
+		// Keyframes recorded between the two are stale, from a file of the same size and time.
+		auto first = keyframes.upper_bound(keyframeSeconds + mediaIndexTolerance);
+		auto last = keyframes.upper_bound(coveredUntil + mediaIndexTolerance);
+		if (first != last)
+		{
+			keyframes.erase(first, last);
+			isDirty = true;
+		}
+
+		auto iter = keyframes.lower_bound(keyframeSeconds - mediaIndexTolerance);
+		if (iter == keyframes.end() || iter->first > keyframeSeconds + mediaIndexTolerance)
+		{
+			Keyframe keyframe;
+			keyframe.pts = pts;
+			keyframe.coveredUntil = coveredUntil;
+			keyframes.emplace(keyframeSeconds, keyframe);
+			isDirty = true;
+		}
+		else if (iter->second.coveredUntil < coveredUntil)
+		{
+			iter->second.coveredUntil = coveredUntil;
+			isDirty = true;
+		}
+	}
+
+	bool MediaIndex::keyframeBefore(const MediaTime& time, MediaTime& outKeyframe) const
+	{
+		std::lock_guard<std::mutex> lock(indexMutex);
+
+		auto iter = keyframes.upper_bound(time.seconds() + mediaIndexTolerance);
+		if (iter == keyframes.begin())
+		{
+			return false;
+		}
+		--iter;
+		if (iter->second.coveredUntil < time.seconds() - mediaIndexTolerance)
+		{
+			// A keyframe between the two may not have been seen yet.
+			return false;
+		}
+		outKeyframe = iter->second.pts;
+		return true;
+	}
+
+	MediaIndexCache::MediaIndexCache(const std::string& directory)
+		: directory(directory)
+	{
+	}
+
+	MediaIndexCache::~MediaIndexCache()
+	{
+		save();
+	}
+
+	std::shared_ptr<MediaIndex> MediaIndexCache::index(const std::string& filePath)
+	{
+		std::lock_guard<std::mutex> lock(cacheMutex);
+
+		auto iter = indexes.find(filePath);
+		if (iter != indexes.end())
+		{
+			return iter->second;
+		}
+		std::shared_ptr<MediaIndex> index = std::make_shared<MediaIndex>(filePath);
+		if (fileIdentity(filePath, index->fileSize, index->fileModified))
+		{
+			load(*index);
+		}
+		indexes[filePath] = index;
+		return index;
+	}
+
+	void MediaIndexCache::save()
+	{
+		std::lock_guard<std::mutex> lock(cacheMutex);
+
+		for (auto& item : indexes)
+		{
+			save(*item.second);
+		}
+	}
+
+	std::string MediaIndexCache::indexFilePath(const std::string& filePath) const
+	{
+		char name[32];
+		snprintf(name, sizeof(name), "%016llx.json", static_cast<unsigned long long>(std::hash<std::string>()(filePath)));
+		return directory + "/" + name;
+	}
+
+	void MediaIndexCache::load(MediaIndex& index) const
+	{
+		std::ifstream file(indexFilePath(index.filePath));
+		if (file.is_open() == false)
+		{
+			return;
+		}
+		const Json json = Json::parse(file, nullptr, false);
+		if (json.is_discarded() ||
+			json.value("path", std::string()) != index.filePath ||
+			json.value("size", -1LL) != index.fileSize ||
+			json.value("modified", -1LL) != index.fileModified)
+		{
+			return;
+		}
+		for (const Json& keyframeJson : json.at("keyframes"))
+		{
+			MediaIndex::Keyframe keyframe;
+			keyframe.pts = MediaTime(keyframeJson.at(0).get<long long>(), keyframeJson.at(1).get<int>());
+			keyframe.coveredUntil = keyframeJson.at(2);
+			index.keyframes.emplace(keyframe.pts.seconds(), keyframe);
+		}
+	}
+
+	void MediaIndexCache::save(MediaIndex& index) const
+	{
+		std::lock_guard<std::mutex> lock(index.indexMutex);
+
+		if (index.isDirty == false || index.fileSize < 0)
+		{
+			return;
+		}
+		Json json;
+		json["path"] = index.filePath;
+		json["size"] = index.fileSize;
+		json["modified"] = index.fileModified;
+		json["keyframes"] = Json::array();
+		for (const auto& item : index.keyframes)
+		{
+			json["keyframes"].push_back({ item.second.pts.timeValue(), item.second.pts.timeScale(), item.second.coveredUntil });
+		}
+
+		std::error_code error;
+		std::filesystem::create_directories(directory, error);
+		std::ofstream file(indexFilePath(index.filePath), std::ios::trunc);
+		if (file.is_open() == false)
+		{
+			spdlog::warn("can not write the media index of {} to {}", index.filePath, directory);
+			return;
+		}
+		file << json.dump();
+		index.isDirty = false;
+	}
+
+	bool MediaIndexCache::fileIdentity(const std::string& filePath, long long& outSize, long long& outModified)
+	{
+		std::error_code error;
+		const auto size = std::filesystem::file_size(filePath, error);
+		if (error)
+		{
+			return false;
+		}
+		const auto modified = std::filesystem::last_write_time(filePath, error);
+		if (error)
+		{
+			return false;
+		}
+		outSize = static_cast<long long>(size);
+		outModified = static_cast<long long>(modified.time_since_epoch().count());
+		return true;
+	}
+}
@@ -0,0 +1,78 @@
+// Copyright (C) 2021 lmc
+// 
+// This file is part of VideoEditor.
+// 
+// VideoEditor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+// 
+// VideoEditor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with VideoEditor.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "MediaInput.hpp"
+
+namespace ks
+{
+	bool MediaInput::isRemote(const std::string& path)
+	{
+		return path.rfind("http://", 0) == 0 || path.rfind("https://", 0) == 0;
+	}
+
+	bool MediaInput::isCachedURL(const std::string& url)
+	{
+		return url.rfind("cache:", 0) == 0 || url.rfind("async:cache:", 0) == 0;
+	}
+
+	std::string MediaInput::decoderURL(const std::string& directory, const std::string& path, const MediaInputOptions& options, const bool isStream)
+	{
+		if (isRemote(path) == false)
+		{
+			const std::string filePath = directory + "/" + path;
+			return isStream && options.isLocalReadAhead ? "async:file:" + filePath : filePath;
+		}
+		std::string url = path;
+		if (options.isCached)
+		{
+			url = "cache:" + url;
+		}
+		if (options.isReadAhead)
+		{
+			url = "async:" + url;
+		}
+		return url;
+	}
+
+	void DecodeLatencyStatistics::record(const std::chrono::steady_clock::duration& decodeDuration)
+	{
+		if (decodeDuration < slowThreshold)
+		{
+			fastCount++;
+		}
+		else
+		{
+			slowCount++;
+			slowMicroseconds += std::chrono::duration_cast<std::chrono::microseconds>(decodeDuration).count();
+		}
+	}
+
+	unsigned int DecodeLatencyStatistics::getFastCount() const
+	{
+		return fastCount;
+	}
+
+	unsigned int DecodeLatencyStatistics::getSlowCount() const
+	{
+		return slowCount;
+	}
+
+	std::chrono::microseconds DecodeLatencyStatistics::getSlowDuration() const
+	{
+		return std::chrono::microseconds(slowMicroseconds.load());
+	}
+}
@@ -0,0 +1,522 @@
+// Copyright (C) 2021 lmc
+//
+// This file is part of VideoEditor.
+//
+// VideoEditor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// VideoEditor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with VideoEditor.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "PixelKernels.hpp"
+#include <assert.h>
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define VideoEditor_PixelKernels_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace ks
+{
+	static inline unsigned char clampToByte(const int value)
+	{
+		return static_cast<unsigned char>(std::min(std::max(value, 0), 255));
+	}
+
+	struct ScaleAxis
+	{
+		std::vector<int> index0;
+		std::vector<int> index1;
+		std::vector<int> weight;
+
+		// Maps destination pixels [begin, end) of an axis of length dstLength onto a source axis with 8 bit weights.
+		void make(const int srcLength, const int dstLength, const int offset, const int begin, const int end)
+		{
+			const int count = std::max(end - begin, 0);
+			index0.resize(count);
+			index1.resize(count);
+			weight.resize(count);
+			const double ratio = static_cast<double>(srcLength) / static_cast<double>(dstLength);
+			for (int i = 0; i < count; i++)
+			{
+				const double position = std::max((static_cast<double>(begin + i - offset) + 0.5) * ratio - 0.5, 0.0);
+				const int i0 = std::min(static_cast<int>(position), srcLength - 1);
+				index0[i] = i0;
+				index1[i] = std::min(i0 + 1, srcLength - 1);
+				weight[i] = static_cast<int>((position - static_cast<double>(i0)) * 256.0);
+			}
+		}
+	};
+
+	PixelRect PixelRect::make(const Rect & rect, const float scale)
+	{
+		PixelRect pixelRect;
+		pixelRect.x = static_cast<int>(lround(rect.x * scale));
+		pixelRect.y = static_cast<int>(lround(rect.y * scale));
+		pixelRect.width = static_cast<int>(lround(rect.width * scale));
+		pixelRect.height = static_cast<int>(lround(rect.height * scale));
+		return pixelRect;
+	}
+
+	PixelRect PixelRect::intersection(const PixelRect & rect) const
+	{
+		PixelRect pixelRect;
+		pixelRect.x = std::max(x, rect.x);
+		pixelRect.y = std::max(y, rect.y);
+		pixelRect.width = std::max(std::min(x + width, rect.x + rect.width) - pixelRect.x, 0);
+		pixelRect.height = std::max(std::min(y + height, rect.y + rect.height) - pixelRect.y, 0);
+		return pixelRect;
+	}
+
+	PixelRect PixelRect::chroma() const
+	{
+		PixelRect pixelRect;
+		pixelRect.x = x / 2;
+		pixelRect.y = y / 2;
+		pixelRect.width = (x + width + 1) / 2 - pixelRect.x;
+		pixelRect.height = (y + height + 1) / 2 - pixelRect.y;
+		return pixelRect;
+	}
+
+	bool PixelRect::isEmpty() const
+	{
+		return width <= 0 || height <= 0;
+	}
+
+	int PixelKernels::planeCount(const PixelBuffer::FormatType format)
+	{
+		return format == PixelBuffer::FormatType::yuv420p ? 3 : 1;
+	}
+
+	PixelPlane PixelKernels::plane(const PixelBuffer & pixelBuffer, const PixelBuffer::FormatType format, const int index)
+	{
+		assert(index < planeCount(format));
+		PixelPlane plane;
+		plane.data = const_cast<unsigned char*>(pixelBuffer.getImmutableData()[index]);
+		if (format == PixelBuffer::FormatType::yuv420p)
+		{
+			const bool isChroma = index > 0;
+			plane.width = isChroma ? (pixelBuffer.getWidth() + 1) / 2 : pixelBuffer.getWidth();
+			plane.height = isChroma ? (pixelBuffer.getHeight() + 1) / 2 : pixelBuffer.getHeight();
+			plane.bytesPerPixel = 1;
+		}
+		else
+		{
+			assert(format == PixelBuffer::FormatType::rgba8);
+			plane.width = pixelBuffer.getWidth();
+			plane.height = pixelBuffer.getHeight();
+			plane.bytesPerPixel = 4;
+		}
+		plane.bytesPerRow = plane.width * plane.bytesPerPixel;
+		return plane;
+	}
+
+	void PixelKernels::clear(PixelBuffer & pixelBuffer, const PixelBuffer::FormatType format, const int rowBegin, const int rowEnd)
+	{
+		if (format == PixelBuffer::FormatType::yuv420p)
+		{
+			const unsigned char values[3] = { 16, 128, 128 };
+			for (int i = 0; i < 3; i++)
+			{
+				const PixelPlane dst = plane(pixelBuffer, format, i);
+				const int begin = i == 0 ? rowBegin : rowBegin / 2;
+				const int end = std::min(i == 0 ? rowEnd : (rowEnd + 1) / 2, dst.height);
+				for (int y = begin; y < end; y++)
+				{
+					memset(dst.data + y * dst.bytesPerRow, values[i], dst.bytesPerRow);
+				}
+			}
+		}
+		else
+		{
+			const PixelPlane dst = plane(pixelBuffer, format, 0);
+			for (int y = rowBegin; y < std::min(rowEnd, dst.height); y++)
+			{
+				fillRow(reinterpret_cast<unsigned int*>(dst.data + y * dst.bytesPerRow), dst.width, 0xFF000000u);
+			}
+		}
+	}
+
+	void PixelKernels::fillRow(unsigned int * row, const int count, const unsigned int value)
+	{
+		int x = 0;
+#ifdef VideoEditor_PixelKernels_SSE2
+		const __m128i pixels = _mm_set1_epi32(static_cast<int>(value));
+		for (; x + 4 <= count; x += 4)
+		{
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(row + x), pixels);
+		}
+#endif
+		std::fill(row + x, row + std::max(count, x), value);
+	}
+
+	template<int Channels>
+	static void scaleRows(const PixelPlane& src, const PixelPlane& dst, const PixelRect& dstRect, const int rowBegin, const int rowEnd, const bool isSourceOver)
+	{
+		PixelRect bounds;
+		bounds.y = rowBegin;
+		bounds.width = dst.width;
+		bounds.height = std::min(rowEnd, dst.height) - rowBegin;
+		const PixelRect clipRect = dstRect.intersection(bounds);
+		if (clipRect.isEmpty() || src.width <= 0 || src.height <= 0)
+		{
+			return;
+		}
+
+		const bool isIdentity = src.width == dstRect.width && src.height == dstRect.height;
+		if (isIdentity && isSourceOver == false)
+		{
+			for (int y = clipRect.y; y < clipRect.y + clipRect.height; y++)
+			{
+				const unsigned char* srcRow = src.data + (y - dstRect.y) * src.bytesPerRow + (clipRect.x - dstRect.x) * Channels;
+				unsigned char* dstRow = dst.data + y * dst.bytesPerRow + clipRect.x * Channels;
+				memcpy(dstRow, srcRow, clipRect.width * Channels);
+			}
+			return;
+		}
+
+		ScaleAxis xAxis;
+		ScaleAxis yAxis;
+		xAxis.make(src.width, dstRect.width, dstRect.x, clipRect.x, clipRect.x + clipRect.width);
+		yAxis.make(src.height, dstRect.height, dstRect.y, clipRect.y, clipRect.y + clipRect.height);
+
+		for (int j = 0; j < clipRect.height; j++)
+		{
+			const unsigned char* row0 = src.data + yAxis.index0[j] * src.bytesPerRow;
+			const unsigned char* row1 = src.data + yAxis.index1[j] * src.bytesPerRow;
+			const int wy = yAxis.weight[j];
+			unsigned char* dstRow = dst.data + (clipRect.y + j) * dst.bytesPerRow + clipRect.x * Channels;
+
+			for (int i = 0; i < clipRect.width; i++)
+			{
+				const int x0 = xAxis.index0[i] * Channels;
+				const int x1 = xAxis.index1[i] * Channels;
+				const int wx = xAxis.weight[i];
+				int pixel[Channels];
+				for (int c = 0; c < Channels; c++)
+				{
+					const int top = row0[x0 + c] * (256 - wx) + row0[x1 + c] * wx;
+					const int bottom = row1[x0 + c] * (256 - wx) + row1[x1 + c] * wx;
+					pixel[c] = (top * (256 - wy) + bottom * wy + 32768) >> 16;
+				}
+				unsigned char* out = dstRow + i * Channels;
+				if (Channels == 4 && isSourceOver)
+				{
+					const int alpha = pixel[3];
+					for (int c = 0; c < 3; c++)
+					{
+						out[c] = static_cast<unsigned char>((pixel[c] * alpha + out[c] * (255 - alpha) + 127) / 255);
+					}
+					out[3] = static_cast<unsigned char>(alpha + (out[3] * (255 - alpha) + 127) / 255);
+				}
+				else
+				{
+					for (int c = 0; c < Channels; c++)
+					{
+						out[c] = static_cast<unsigned char>(pixel[c]);
+					}
+				}
+			}
+		}
+	}
+
+	void PixelKernels::scalePlane(const PixelPlane & src, const PixelPlane & dst, const PixelRect & dstRect, const int rowBegin, const int rowEnd)
+	{
+		assert(src.bytesPerPixel == dst.bytesPerPixel);
+		if (src.bytesPerPixel == 4)
+		{
+			scaleRows<4>(src, dst, dstRect, rowBegin, rowEnd, false);
+		}
+		else
+		{
+			assert(src.bytesPerPixel == 1);
+			scaleRows<1>(src, dst, dstRect, rowBegin, rowEnd, false);
+		}
+	}
+
+	void PixelKernels::downsamplePlane2x(const PixelPlane & src, const PixelPlane & dst)
+	{
+		assert(src.bytesPerPixel == dst.bytesPerPixel);
+		const int channels = dst.bytesPerPixel;
+		for (int y = 0; y < dst.height; y++)
+		{
+			const unsigned char* row0 = src.data + std::min(y * 2, src.height - 1) * src.bytesPerRow;
+			const unsigned char* row1 = src.data + std::min(y * 2 + 1, src.height - 1) * src.bytesPerRow;
+			unsigned char* out = dst.data + y * dst.bytesPerRow;
+			for (int x = 0; x < dst.width; x++)
+			{
+				const int x0 = std::min(x * 2, src.width - 1) * channels;
+				const int x1 = std::min(x * 2 + 1, src.width - 1) * channels;
+				for (int c = 0; c < channels; c++)
+				{
+					out[x * channels + c] = static_cast<unsigned char>((row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c] + 2) >> 2);
+				}
+			}
+		}
+	}
+
+	void PixelKernels::scaleSourceOverRGBA8(const PixelPlane & src, const PixelPlane & dst, const PixelRect & dstRect, const int rowBegin, const int rowEnd)
+	{
+		assert(src.bytesPerPixel == 4 && dst.bytesPerPixel == 4);
+		scaleRows<4>(src, dst, dstRect, rowBegin, rowEnd, true);
+	}
+
+	template<int Channels>
+	static void scaleBlendRows(const PixelPlane& from, const PixelPlane& to, const PixelPlane& dst, const PixelRect& dstRect, const PixelBlend& blend, const int rowBegin, const int rowEnd)
+	{
+		PixelRect bounds;
+		bounds.y = rowBegin;
+		bounds.width = dst.width;
+		bounds.height = std::min(rowEnd, dst.height) - rowBegin;
+		const PixelRect clipRect = dstRect.intersection(bounds);
+		if (clipRect.isEmpty() || from.width <= 0 || from.height <= 0 || to.width <= 0 || to.height <= 0)
+		{
+			return;
+		}
+
+		ScaleAxis fromXAxis;
+		ScaleAxis fromYAxis;
+		ScaleAxis toXAxis;
+		ScaleAxis toYAxis;
+		fromXAxis.make(from.width, dstRect.width, dstRect.x, clipRect.x, clipRect.x + clipRect.width);
+		fromYAxis.make(from.height, dstRect.height, dstRect.y, clipRect.y, clipRect.y + clipRect.height);
+		toXAxis.make(to.width, dstRect.width, dstRect.x, clipRect.x, clipRect.x + clipRect.width);
+		toYAxis.make(to.height, dstRect.height, dstRect.y, clipRect.y, clipRect.y + clipRect.height);
+
+		auto sample = [](const unsigned char* row0, const unsigned char* row1, const ScaleAxis& xAxis, const int wy, const int i, const int c)
+		{
+			const int x0 = xAxis.index0[i] * Channels + c;
+			const int x1 = xAxis.index1[i] * Channels + c;
+			const int wx = xAxis.weight[i];
+			const int top = row0[x0] * (256 - wx) + row0[x1] * wx;
+			const int bottom = row1[x0] * (256 - wx) + row1[x1] * wx;
+			return (top * (256 - wy) + bottom * wy + 32768) >> 16;
+		};
+
+		for (int j = 0; j < clipRect.height; j++)
+		{
+			const unsigned char* fromRow0 = from.data + fromYAxis.index0[j] * from.bytesPerRow;
+			const unsigned char* fromRow1 = from.data + fromYAxis.index1[j] * from.bytesPerRow;
+			const unsigned char* toRow0 = to.data + toYAxis.index0[j] * to.bytesPerRow;
+			const unsigned char* toRow1 = to.data + toYAxis.index1[j] * to.bytesPerRow;
+			const int fromWeightY = fromYAxis.weight[j];
+			const int toWeightY = toYAxis.weight[j];
+			unsigned char* out = dst.data + (clipRect.y + j) * dst.bytesPerRow + clipRect.x * Channels;
+
+			for (int i = 0; i < clipRect.width; i++)
+			{
+				const PixelBlend::Weights& weights = clipRect.x + i - dstRect.x < blend.edge ? blend.leading : blend.trailing;
+				const int backgroundWeight = 256 - weights.from - weights.to;
+				for (int c = 0; c < Channels; c++)
+				{
+					// A source with no weight, e.g. either side of a wipe, is not read at all.
+					int value = blend.background[c] * backgroundWeight;
+					if (weights.from > 0)
+					{
+						value += sample(fromRow0, fromRow1, fromXAxis, fromWeightY, i, c) * weights.from;
+					}
+					if (weights.to > 0)
+					{
+						value += sample(toRow0, toRow1, toXAxis, toWeightY, i, c) * weights.to;
+					}
+					out[i * Channels + c] = static_cast<unsigned char>((value + 128) >> 8);
+				}
+			}
+		}
+	}
+
+	void PixelKernels::scaleBlendPlanes(const PixelPlane & from, const PixelPlane & to, const PixelPlane & dst, const PixelRect & dstRect, const PixelBlend & blend, const int rowBegin, const int rowEnd)
+	{
+		assert(from.bytesPerPixel == dst.bytesPerPixel && to.bytesPerPixel == dst.bytesPerPixel);
+		if (dst.bytesPerPixel == 4)
+		{
+			scaleBlendRows<4>(from, to, dst, dstRect, blend, rowBegin, rowEnd);
+		}
+		else
+		{
+			assert(dst.bytesPerPixel == 1);
+			scaleBlendRows<1>(from, to, dst, dstRect, blend, rowBegin, rowEnd);
+		}
+	}
+
+	void PixelKernels::scaleYUV420PToRGBA8(const PixelBuffer & src, const PixelPlane & dst, const PixelRect & dstRect, const int rowBegin, const int rowEnd)
+	{
+		assert(dst.bytesPerPixel == 4);
+		const PixelPlane yPlane = plane(src, PixelBuffer::FormatType::yuv420p, 0);
+		const PixelPlane uPlane = plane(src, PixelBuffer::FormatType::yuv420p, 1);
+		const PixelPlane vPlane = plane(src, PixelBuffer::FormatType::yuv420p, 2);
+
+		PixelRect bounds;
+		bounds.y = rowBegin;
+		bounds.width = dst.width;
+		bounds.height = std::min(rowEnd, dst.height) - rowBegin;
+		const PixelRect clipRect = dstRect.intersection(bounds);
+		if (clipRect.isEmpty() || yPlane.width <= 0 || yPlane.height <= 0)
+		{
+			return;
+		}
+
+		ScaleAxis xAxis;
+		ScaleAxis yAxis;
+		ScaleAxis xChromaAxis;
+		ScaleAxis yChromaAxis;
+		xAxis.make(yPlane.width, dstRect.width, dstRect.x, clipRect.x, clipRect.x + clipRect.width);
+		yAxis.make(yPlane.height, dstRect.height, dstRect.y, clipRect.y, clipRect.y + clipRect.height);
+		xChromaAxis.make(uPlane.width, dstRect.width, dstRect.x, clipRect.x, clipRect.x + clipRect.width);
+		yChromaAxis.make(uPlane.height, dstRect.height, dstRect.y, clipRect.y, clipRect.y + clipRect.height);
+
+		auto sample = [](const PixelPlane& plane, const ScaleAxis& xAxis, const ScaleAxis& yAxis, const int i, const int j)
+		{
+			const unsigned char* row0 = plane.data + yAxis.index0[j] * plane.bytesPerRow;
+			const unsigned char* row1 = plane.data + yAxis.index1[j] * plane.bytesPerRow;
+			const int wx = xAxis.weight[i];
+			const int wy = yAxis.weight[j];
+			const int top = row0[xAxis.index0[i]] * (256 - wx) + row0[xAxis.index1[i]] * wx;
+			const int bottom = row1[xAxis.index0[i]] * (256 - wx) + row1[xAxis.index1[i]] * wx;
+			return (top * (256 - wy) + bottom * wy + 32768) >> 16;
+		};
+
+		for (int j = 0; j < clipRect.height; j++)
+		{
+			unsigned char* out = dst.data + (clipRect.y + j) * dst.bytesPerRow + clipRect.x * 4;
+			for (int i = 0; i < clipRect.width; i++)
+			{
+				const int c = 298 * (sample(yPlane, xAxis, yAxis, i, j) - 16);
+				const int d = sample(uPlane, xChromaAxis, yChromaAxis, i, j) - 128;
+				const int e = sample(vPlane, xChromaAxis, yChromaAxis, i, j) - 128;
+				out[i * 4 + 0] = clampToByte((c + 409 * e + 128) >> 8);
+				out[i * 4 + 1] = clampToByte((c - 100 * d - 208 * e + 128) >> 8);
+				out[i * 4 + 2] = clampToByte((c + 516 * d + 128) >> 8);
+				out[i * 4 + 3] = 255;
+			}
+		}
+	}
+
+	void PixelKernels::convertYUV420PToRGBA8(const PixelBuffer & src, PixelBuffer & dst, const int width, const int height, const int rowBegin, const int rowEnd)
+	{
+		const PixelPlane yPlane = plane(src, PixelBuffer::FormatType::yuv420p, 0);
+		const PixelPlane uPlane = plane(src, PixelBuffer::FormatType::yuv420p, 1);
+		const PixelPlane vPlane = plane(src, PixelBuffer::FormatType::yuv420p, 2);
+		const PixelPlane rgbaPlane = plane(dst, PixelBuffer::FormatType::rgba8, 0);
+
+		// BT.601, limited range.
+		for (int y = rowBegin; y < std::min(rowEnd, height); y++)
+		{
+			const unsigned char* yRow = yPlane.data + y * yPlane.bytesPerRow;
+			const unsigned char* uRow = uPlane.data + (y / 2) * uPlane.bytesPerRow;
+			const unsigned char* vRow = vPlane.data + (y / 2) * vPlane.bytesPerRow;
+			unsigned char* out = rgbaPlane.data + y * rgbaPlane.bytesPerRow;
+			int x = 0;
+#ifdef VideoEditor_PixelKernels_SSE2
+			// Eight pixels at a time, each channel is two 16 bit multiply-adds of (luma, chroma) pairs,
+			// rounded and saturated exactly like the scalar path.
+			const __m128i zero = _mm_setzero_si128();
+			const __m128i lumaOffset = _mm_set1_epi16(16);
+			const __m128i chromaOffset = _mm_set1_epi16(128);
+			const __m128i rounding = _mm_set1_epi32(128);
+			const __m128i alpha = _mm_set1_epi16(255);
+			const __m128i redWeights = _mm_set_epi16(409, 298, 409, 298, 409, 298, 409, 298);
+			const __m128i greenWeightsU = _mm_set_epi16(-100, 298, -100, 298, -100, 298, -100, 298);
+			const __m128i greenWeightsV = _mm_set_epi16(0, -208, 0, -208, 0, -208, 0, -208);
+			const __m128i blueWeights = _mm_set_epi16(516, 298, 516, 298, 516, 298, 516, 298);
+			for (; x + 8 <= width; x += 8)
+			{
+				int u4 = 0;
+				int v4 = 0;
+				memcpy(&u4, uRow + x / 2, 4);
+				memcpy(&v4, vRow + x / 2, 4);
+				const __m128i luma = _mm_sub_epi16(_mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(yRow + x)), zero), lumaOffset);
+				__m128i d = _mm_sub_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(u4), zero), chromaOffset);
+				__m128i e = _mm_sub_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(v4), zero), chromaOffset);
+				d = _mm_unpacklo_epi16(d, d);
+				e = _mm_unpacklo_epi16(e, e);
+
+				const __m128i lumaE[2] = { _mm_unpacklo_epi16(luma, e), _mm_unpackhi_epi16(luma, e) };
+				const __m128i lumaD[2] = { _mm_unpacklo_epi16(luma, d), _mm_unpackhi_epi16(luma, d) };
+				const __m128i eZero[2] = { _mm_unpacklo_epi16(e, zero), _mm_unpackhi_epi16(e, zero) };
+				__m128i channels[3][2];
+				for (int i = 0; i < 2; i++)
+				{
+					channels[0][i] = _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(lumaE[i], redWeights), rounding), 8);
+					channels[1][i] = _mm_srai_epi32(_mm_add_epi32(_mm_add_epi32(_mm_madd_epi16(lumaD[i], greenWeightsU),
+						_mm_madd_epi16(eZero[i], greenWeightsV)), rounding), 8);
+					channels[2][i] = _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(lumaD[i], blueWeights), rounding), 8);
+				}
+				const __m128i red = _mm_packs_epi32(channels[0][0], channels[0][1]);
+				const __m128i green = _mm_packs_epi32(channels[1][0], channels[1][1]);
+				const __m128i blue = _mm_packs_epi32(channels[2][0], channels[2][1]);
+
+				const __m128i redGreen = _mm_packus_epi16(red, green);
+				const __m128i blueAlpha = _mm_packus_epi16(blue, alpha);
+				const __m128i rg = _mm_unpacklo_epi8(redGreen, _mm_unpackhi_epi64(redGreen, redGreen));
+				const __m128i ba = _mm_unpacklo_epi8(blueAlpha, _mm_unpackhi_epi64(blueAlpha, blueAlpha));
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(out + x * 4), _mm_unpacklo_epi16(rg, ba));
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(out + x * 4 + 16), _mm_unpackhi_epi16(rg, ba));
+			}
+#endif
+			for (; x < width; x++)
+			{
+				const int c = 298 * (yRow[x] - 16);
+				const int d = uRow[x / 2] - 128;
+				const int e = vRow[x / 2] - 128;
+				out[x * 4 + 0] = clampToByte((c + 409 * e + 128) >> 8);
+				out[x * 4 + 1] = clampToByte((c - 100 * d - 208 * e + 128) >> 8);
+				out[x * 4 + 2] = clampToByte((c + 516 * d + 128) >> 8);
+				out[x * 4 + 3] = 255;
+			}
+		}
+	}
+
+	void PixelKernels::convertRGBA8ToYUV420P(const PixelBuffer & src, PixelBuffer & dst, const int width, const int height, const int rowBegin, const int rowEnd)
+	{
+		assert(rowBegin % 2 == 0);
+		const PixelPlane rgbaPlane = plane(src, PixelBuffer::FormatType::rgba8, 0);
+		const PixelPlane yPlane = plane(dst, PixelBuffer::FormatType::yuv420p, 0);
+		const PixelPlane uPlane = plane(dst, PixelBuffer::FormatType::yuv420p, 1);
+		const PixelPlane vPlane = plane(dst, PixelBuffer::FormatType::yuv420p, 2);
+
+		for (int y = rowBegin; y < std::min(rowEnd, height); y += 2)
+		{
+			const int y1 = std::min(y + 1, height - 1);
+			const unsigned char* rows[2] = { rgbaPlane.data + y * rgbaPlane.bytesPerRow, rgbaPlane.data + y1 * rgbaPlane.bytesPerRow };
+			unsigned char* yRows[2] = { yPlane.data + y * yPlane.bytesPerRow, yPlane.data + y1 * yPlane.bytesPerRow };
+			unsigned char* uRow = uPlane.data + (y / 2) * uPlane.bytesPerRow;
+			unsigned char* vRow = vPlane.data + (y / 2) * vPlane.bytesPerRow;
+
+			for (int x = 0; x < width; x += 2)
+			{
+				int r = 0;
+				int g = 0;
+				int b = 0;
+				for (int j = 0; j < 2; j++)
+				{
+					for (int i = 0; i < 2; i++)
+					{
+						const int xi = std::min(x + i, width - 1);
+						const unsigned char* pixel = rows[j] + xi * 4;
+						yRows[j][xi] = clampToByte(((66 * pixel[0] + 129 * pixel[1] + 25 * pixel[2] + 128) >> 8) + 16);
+						r += pixel[0];
+						g += pixel[1];
+						b += pixel[2];
+					}
+				}
+				r = (r + 2) >> 2;
+				g = (g + 2) >> 2;
+				b = (b + 2) >> 2;
+				uRow[x / 2] = clampToByte(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+				vRow[x / 2] = clampToByte(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+			}
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,131 @@
+// Copyright (C) 2021 lmc
+// 
+// This file is part of VideoEditor.
+// 
+// VideoEditor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+// 
+// VideoEditor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with VideoEditor.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include "RGBAFrameCache.hpp"
+#include <assert.h>
+#include <algorithm>
+#include "PixelKernels.hpp"
+
+namespace ks
+{
+	RGBAFrameCache::RGBAFrameCache(WorkerPool* workerPool)
+		: workerPool(workerPool)
+	{
+	}
+
+	RGBAFrameCache::~RGBAFrameCache()
+	{
+	}
+
+	PixelBuffer* RGBAFrameCache::rgbaFrame(const PixelBuffer& frame, bool* outIsConverted)
+	{
+		std::lock_guard<std::mutex> lock(entriesMutex);
+
+		auto iter = entries.find(&frame);
+		if (iter != entries.end())
+		{
+			if (outIsConverted)
+			{
+				*outIsConverted = false;
+			}
+			return iter->second.pixelBuffer;
+		}
+
+		const int width = frame.getWidth();
+		const int height = frame.getHeight();
+		Entry entry;
+		if (spareEntries.empty() == false && spareEntries.back().width == width && spareEntries.back().height == height)
+		{
+			entry = std::move(spareEntries.back());
+			spareEntries.pop_back();
+		}
+		else
+		{
+			entry = makeEntry(width, height);
+		}
+		convert(frame, *entry.pixelBuffer, workerPool);
+
+		PixelBuffer* pixelBuffer = entry.pixelBuffer;
+		entries[&frame] = std::move(entry);
+		if (outIsConverted)
+		{
+			*outIsConverted = true;
+		}
+		return pixelBuffer;
+	}
+
+	void RGBAFrameCache::release(const PixelBuffer* frame)
+	{
+		std::lock_guard<std::mutex> lock(entriesMutex);
+
+		auto iter = entries.find(frame);
+		if (iter == entries.end())
+		{
+			return;
+		}
+		Entry entry = std::move(iter->second);
+		entries.erase(iter);
+
+		if (spareEntries.empty() == false &&
+			(spareEntries.back().width != entry.width || spareEntries.back().height != entry.height))
+		{
+			spareEntries.clear();
+		}
+		if (spareEntries.size() < spareCapacity)
+		{
+			spareEntries.push_back(std::move(entry));
+		}
+	}
+
+	void RGBAFrameCache::clear()
+	{
+		std::lock_guard<std::mutex> lock(entriesMutex);
+
+		entries.clear();
+	}
+
+	void RGBAFrameCache::convert(const PixelBuffer& src, PixelBuffer& dst, WorkerPool* workerPool)
+	{
+		const int width = src.getWidth();
+		const int height = src.getHeight();
+		const int chunkCount = workerPool ? static_cast<int>(workerPool->getThreadCount()) + 1 : 1;
+		int chunkHeight = (height + chunkCount - 1) / chunkCount;
+		chunkHeight = std::max((chunkHeight + rowAlignment - 1) / rowAlignment * rowAlignment, rowAlignment);
+		const int count = (height + chunkHeight - 1) / chunkHeight;
+
+		if (workerPool == nullptr || count <= 1)
+		{
+			PixelKernels::convertYUV420PToRGBA8(src, dst, width, height, 0, height);
+			return;
+		}
+		workerPool->parallelFor(count, [&](const int index)
+		{
+			PixelKernels::convertYUV420PToRGBA8(src, dst, width, height, index * chunkHeight, (index + 1) * chunkHeight);
+		});
+	}
+
+	RGBAFrameCache::Entry RGBAFrameCache::makeEntry(const int width, const int height)
+	{
+		Entry entry;
+		entry.width = width;
+		entry.height = height;
+		entry.pixelBufferPool = std::make_unique<PixelBufferPool>(width, height, 1, PixelBuffer::FormatType::rgba8);
+		entry.pixelBuffer = entry.pixelBufferPool->pixelBuffer();
+		return entry;
+	}
+}
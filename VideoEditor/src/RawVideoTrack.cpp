@@ -0,0 +1,380 @@
+// Copyright (C) 2021 lmc
+// 
+// This file is part of VideoEditor.
+// 
+// VideoEditor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+// 
+// VideoEditor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with VideoEditor.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "RawVideoTrack.hpp"
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <sstream>
+#include <spdlog/spdlog.h>
+#include "Util.hpp"
+#include "PixelKernels.hpp"
+
+namespace ks
+{
+	RawVideoTrack::RawVideoTrack()
+	{
+	}
+
+	RawVideoTrack::~RawVideoTrack()
+	{
+		// The slot buffers belong to pixelBufferPools.
+		for (const Slot& slot : slots)
+		{
+			assert(slot.retainCount == 0);
+		}
+	}
+
+	const PixelBuffer * RawVideoTrack::sourceFrame(const MediaTime & compositionTime, const VideoRenderContext & renderContext)
+	{
+		std::lock_guard<std::mutex> lock(framesMutex);
+		Slot* slot = currentSlot(compositionTime);
+		return slot ? slot->pixelBuffer : nullptr;
+	}
+
+	SourceFrameHandle RawVideoTrack::retainSourceFrame(const MediaTime & compositionTime, const VideoRenderContext & renderContext)
+	{
+		std::lock_guard<std::mutex> lock(framesMutex);
+		Slot* slot = currentSlot(compositionTime);
+		if (slot == nullptr)
+		{
+			return nullptr;
+		}
+		slot->retainCount++;
+		return SourceFrameHandle(slot->pixelBuffer, [this](const PixelBuffer* retainedFrame)
+		{
+			std::lock_guard<std::mutex> lock(framesMutex);
+			for (Slot& slot : slots)
+			{
+				if (slot.pixelBuffer == retainedFrame)
+				{
+					assert(slot.retainCount > 0);
+					slot.retainCount--;
+					break;
+				}
+			}
+		});
+	}
+
+	RawVideoTrack::Slot * RawVideoTrack::currentSlot(const MediaTime & compositionTime)
+	{
+		if (mappedFile == nullptr || frameCount == 0 || slots.empty())
+		{
+			return nullptr;
+		}
+		const int index = frameIndex(compositionTime);
+		lastSourceFrameDisplayTime = getTargetTime(timeMapping, MediaTime(static_cast<double>(index) / frameRate, 600));
+		readAhead(index);
+
+		Slot* slot = nullptr;
+		for (Slot& candidate : slots)
+		{
+			if (candidate.frameIndex == index)
+			{
+				slot = &candidate;
+				break;
+			}
+		}
+		if (slot == nullptr)
+		{
+			slot = freeSlot();
+			slot->frameIndex = -1;
+			if (copyFrame(index, *slot->pixelBuffer) == false)
+			{
+				return nullptr;
+			}
+			slot->frameIndex = index;
+		}
+		slot->lastUse = ++useCount;
+		return slot;
+	}
+
+	MediaTime RawVideoTrack::sourceFrameDisplayTime(const MediaTime & compositionTime)
+	{
+		std::lock_guard<std::mutex> lock(framesMutex);
+		return lastSourceFrameDisplayTime;
+	}
+
+	const PixelBuffer * RawVideoTrack::compositionImage(const PixelBuffer & sourceFrame, const MediaTime & compositionTime, const VideoRenderContext & renderContext)
+	{
+		return &sourceFrame;
+	}
+
+	PixelBuffer::FormatType RawVideoTrack::compositionImageFormat(const VideoRenderContext & renderContext) const
+	{
+		return format;
+	}
+
+	bool RawVideoTrack::isOpaque() const
+	{
+		return format == PixelBuffer::FormatType::yuv420p;
+	}
+
+	void RawVideoTrack::prepare(const VideoRenderContext & renderContext)
+	{
+		std::lock_guard<std::mutex> lock(framesMutex);
+		if (mappedFile == nullptr && open() == false)
+		{
+			spdlog::error("can not open {}", filePath);
+			return;
+		}
+		if (slots.empty())
+		{
+			pixelBufferPools.push_back(std::make_unique<PixelBufferPool>(width, height, slotCapacity, format));
+			slots.resize(slotCapacity);
+			for (Slot& slot : slots)
+			{
+				slot.pixelBuffer = pixelBufferPools.back()->pixelBuffer();
+			}
+		}
+	}
+
+	void RawVideoTrack::onSeeking(const MediaTime & compositionTime)
+	{
+		std::lock_guard<std::mutex> lock(framesMutex);
+		lastFrameIndex = -1;
+		firstKeptFrameIndex = 0;
+	}
+
+	void RawVideoTrack::flush(const MediaTime & compositionTime)
+	{
+		std::lock_guard<std::mutex> lock(framesMutex);
+		if (frameCount > 0)
+		{
+			firstKeptFrameIndex = frameIndex(compositionTime);
+		}
+	}
+
+	void RawVideoTrack::flush()
+	{
+		std::lock_guard<std::mutex> lock(framesMutex);
+		for (Slot& slot : slots)
+		{
+			slot.frameIndex = -1;
+		}
+		firstKeptFrameIndex = 0;
+	}
+
+	bool RawVideoTrack::open()
+	{
+		mappedFile = std::unique_ptr<MappedFile>(MappedFile::New(filePath));
+		if (mappedFile == nullptr)
+		{
+			return false;
+		}
+		if (parseY4MHeader() == false)
+		{
+			width = rawWidth;
+			height = rawHeight;
+			format = rawFormat;
+			frameRate = rawFrameRate;
+			firstFrameOffset = 0;
+			frameHeaderSize = 0;
+		}
+		if (width <= 0 || height <= 0 || frameRate <= 0.0f)
+		{
+			mappedFile.reset();
+			return false;
+		}
+		if (format == PixelBuffer::FormatType::yuv420p)
+		{
+			const size_t chromaSize = static_cast<size_t>((width + 1) / 2) * ((height + 1) / 2);
+			frameSize = static_cast<size_t>(width) * height + chromaSize * 2;
+		}
+		else
+		{
+			frameSize = static_cast<size_t>(width) * height * 4;
+		}
+		const size_t stride = frameHeaderSize + frameSize;
+		frameCount = static_cast<int>((mappedFile->size() - firstFrameOffset) / stride);
+		mappedFile->advise(0, mappedFile->size(), MappedFile::Advice::sequential);
+		return true;
+	}
+
+	bool RawVideoTrack::parseY4MHeader()
+	{
+		const char signature[] = "YUV4MPEG2 ";
+		const size_t signatureSize = sizeof(signature) - 1;
+		const char* bytes = reinterpret_cast<const char*>(mappedFile->data());
+		const size_t size = mappedFile->size();
+		if (size < signatureSize || memcmp(bytes, signature, signatureSize) != 0)
+		{
+			return false;
+		}
+		const char* headerEnd = static_cast<const char*>(memchr(bytes, '\n', size));
+		if (headerEnd == nullptr)
+		{
+			return false;
+		}
+
+		std::istringstream header(std::string(bytes + signatureSize, headerEnd));
+		std::string token;
+		std::string colorSpace = "420jpeg";
+		while (header >> token)
+		{
+			switch (token[0])
+			{
+			case 'W':
+				width = atoi(token.c_str() + 1);
+				break;
+			case 'H':
+				height = atoi(token.c_str() + 1);
+				break;
+			case 'F':
+			{
+				const int numerator = atoi(token.c_str() + 1);
+				const size_t colon = token.find(':');
+				const int denominator = colon == std::string::npos ? 1 : atoi(token.c_str() + colon + 1);
+				frameRate = denominator > 0 ? static_cast<float>(numerator) / denominator : 0.0f;
+				break;
+			}
+			case 'C':
+				colorSpace = token.substr(1);
+				break;
+			default:
+				break;
+			}
+		}
+		if (colorSpace != "420jpeg" && colorSpace != "420paldv" && colorSpace != "420mpeg2" && colorSpace != "420")
+		{
+			spdlog::error("unsupported y4m color space {} in {}", colorSpace, filePath);
+			width = 0;
+			return true;
+		}
+		format = PixelBuffer::FormatType::yuv420p;
+
+		// Frame headers may carry parameters, the first one sets the size assumed for all.
+		firstFrameOffset = static_cast<size_t>(headerEnd - bytes) + 1;
+		const char* frameHeaderEnd = static_cast<const char*>(memchr(bytes + firstFrameOffset, '\n', size - firstFrameOffset));
+		if (frameHeaderEnd == nullptr)
+		{
+			width = 0;
+			return true;
+		}
+		frameHeaderSize = static_cast<size_t>(frameHeaderEnd - bytes) + 1 - firstFrameOffset;
+		return true;
+	}
+
+	int RawVideoTrack::frameIndex(const MediaTime & compositionTime) const
+	{
+		const MediaTime sourceTime = getSourceTime(timeMapping, compositionTime);
+		const int index = static_cast<int>(floor(sourceTime.seconds() * frameRate + 1e-6));
+		return std::max(0, std::min(index, frameCount - 1));
+	}
+
+	size_t RawVideoTrack::frameOffset(const int frameIndex) const
+	{
+		return firstFrameOffset + static_cast<size_t>(frameIndex) * (frameHeaderSize + frameSize);
+	}
+
+	RawVideoTrack::Slot * RawVideoTrack::freeSlot()
+	{
+		// Frames before the last flush are done with, otherwise the least recently used one goes.
+		// Retained frames stay as they are.
+		Slot* oldest = nullptr;
+		for (Slot& slot : slots)
+		{
+			if (slot.retainCount > 0)
+			{
+				continue;
+			}
+			if (slot.frameIndex < 0 || slot.frameIndex < firstKeptFrameIndex)
+			{
+				return &slot;
+			}
+			if (oldest == nullptr || slot.lastUse < oldest->lastUse)
+			{
+				oldest = &slot;
+			}
+		}
+		if (oldest)
+		{
+			return oldest;
+		}
+
+		spdlog::debug("all {} frames of {} are retained, adding one", slots.size(), filePath);
+		pixelBufferPools.push_back(std::make_unique<PixelBufferPool>(width, height, 1, format));
+		Slot slot;
+		slot.pixelBuffer = pixelBufferPools.back()->pixelBuffer();
+		slots.push_back(slot);
+		return &slots.back();
+	}
+
+	bool RawVideoTrack::copyFrame(const int frameIndex, PixelBuffer & pixelBuffer) const
+	{
+		const size_t offset = frameOffset(frameIndex);
+		const unsigned char* frame = mappedFile->data() + offset;
+		if (frameHeaderSize > 0 && memcmp(frame, "FRAME", 5) != 0)
+		{
+			spdlog::error("frame {} of {} has an unexpected header", frameIndex, filePath);
+			return false;
+		}
+		const unsigned char* src = frame + frameHeaderSize;
+		for (int i = 0; i < PixelKernels::planeCount(format); i++)
+		{
+			const PixelPlane dst = PixelKernels::plane(pixelBuffer, format, i);
+			const size_t rowSize = static_cast<size_t>(dst.width) * dst.bytesPerPixel;
+			for (int y = 0; y < dst.height; y++)
+			{
+				memcpy(dst.data + static_cast<size_t>(y) * dst.bytesPerRow, src, rowSize);
+				src += rowSize;
+			}
+		}
+		return true;
+	}
+
+	void RawVideoTrack::readAhead(const int frameIndex)
+	{
+		const int direction = lastFrameIndex >= 0 && frameIndex < lastFrameIndex ? -1 : 1;
+		const bool isStep = lastFrameIndex >= 0 && abs(frameIndex - lastFrameIndex) <= 1;
+		lastFrameIndex = frameIndex;
+		const size_t stride = frameHeaderSize + frameSize;
+		const int count = static_cast<int>(readAheadCount);
+
+		if (direction > 0)
+		{
+			// While playing forward only the newest frame of the window is new.
+			const int first = isStep ? std::min(frameIndex + count, frameCount) : frameIndex + 1;
+			const int last = std::min(frameIndex + count, frameCount - 1);
+			if (first <= last)
+			{
+				mappedFile->advise(frameOffset(first), (last - first + 1) * stride, MappedFile::Advice::willNeed);
+			}
+			const int behind = frameIndex - count - 1;
+			if (behind >= 0)
+			{
+				mappedFile->advise(frameOffset(behind), stride, MappedFile::Advice::dontNeed);
+			}
+		}
+		else
+		{
+			const int first = std::max(frameIndex - count, 0);
+			const int last = isStep ? first : frameIndex - 1;
+			if (first <= last)
+			{
+				mappedFile->advise(frameOffset(first), (last - first + 1) * stride, MappedFile::Advice::willNeed);
+			}
+			const int behind = frameIndex + count + 1;
+			if (behind < frameCount)
+			{
+				mappedFile->advise(frameOffset(behind), stride, MappedFile::Advice::dontNeed);
+			}
+		}
+	}
+}
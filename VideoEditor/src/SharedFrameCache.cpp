@@ -0,0 +1,247 @@
+// Copyright (C) 2021 lmc
+// 
+// This file is part of VideoEditor.
+// 
+// VideoEditor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+// 
+// VideoEditor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with VideoEditor.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "SharedFrameCache.hpp"
+#include <assert.h>
+#include <math.h>
+#include <iterator>
+#include <spdlog/spdlog.h>
+
+namespace ks
+{
+	// Pts of one stream come from the same decoder, they only differ by rounding.
+	static const double ptsTolerance = 1e-6;
+
+	SharedFrameCache::SharedFrameCache(const size_t capacity)
+		: capacity(capacity)
+	{
+	}
+
+	SharedFrameCache::~SharedFrameCache()
+	{
+		spdlog::info("shared frame cache: {} hits, {} misses", hitCount, missCount);
+		for (auto& item : entries)
+		{
+			assert(item.second.retainCount == 0);
+			item.second.deleter(item.second.frame);
+		}
+	}
+
+	std::string SharedFrameCache::streamKey(const std::string& filePath, const PixelBuffer::FormatType format, const int width, const int height)
+	{
+		return filePath + "|" + std::to_string(static_cast<int>(format)) + "|" + std::to_string(width) + "x" + std::to_string(height);
+	}
+
+	void SharedFrameCache::insert(const std::string& streamKey,
+		const PixelBuffer::FormatType format,
+		const MediaTime& pts,
+		const MediaTime* previousPts,
+		PixelBuffer* frame,
+		std::function<void(PixelBuffer*)> deleter)
+	{
+		std::lock_guard<std::mutex> lock(cacheMutex);
+
+		Entry& entry = entries[frame];
+		entry.streamKey = streamKey;
+		entry.pts = pts.seconds();
+		entry.frame = frame;
+		entry.deleter = deleter;
+		entry.bytes = frameBytes(*frame, format);
+		entry.retainCount = 1;
+
+		if (previousPts)
+		{
+			PixelBuffer* previous = lookup(streamKey, previousPts->seconds());
+			if (previous)
+			{
+				Entry& previousEntry = entries.at(previous);
+				previousEntry.nextPts = entry.pts;
+				previousEntry.hasNext = true;
+			}
+		}
+
+		// Two tracks may decode the same frame at once, the first one stays indexed.
+		PixelBuffer* existing = lookup(streamKey, entry.pts);
+		if (existing)
+		{
+			entry.isIndexed = false;
+			return;
+		}
+		streams[streamKey][entry.pts] = frame;
+		size += entry.bytes;
+		evict();
+	}
+
+	PixelBuffer* SharedFrameCache::next(const std::string& streamKey, const MediaTime& previousPts, MediaTime& outPts)
+	{
+		std::lock_guard<std::mutex> lock(cacheMutex);
+
+		PixelBuffer* previous = lookup(streamKey, previousPts.seconds());
+		PixelBuffer* frame = nullptr;
+		if (previous && entries.at(previous).hasNext)
+		{
+			frame = lookup(streamKey, entries.at(previous).nextPts);
+		}
+		if (frame == nullptr)
+		{
+			missCount++;
+			return nullptr;
+		}
+		hitCount++;
+		Entry& entry = entries.at(frame);
+		retain(entry);
+		outPts = MediaTime(entry.pts, previousPts.timeScale());
+		return frame;
+	}
+
+	PixelBuffer* SharedFrameCache::find(const std::string& streamKey, const MediaTime& sourceTime, MediaTime& outPts)
+	{
+		std::lock_guard<std::mutex> lock(cacheMutex);
+
+		const double time = sourceTime.seconds();
+		PixelBuffer* frame = nullptr;
+		auto streamIter = streams.find(streamKey);
+		if (streamIter != streams.end())
+		{
+			auto iter = streamIter->second.upper_bound(time + ptsTolerance);
+			if (iter != streamIter->second.begin())
+			{
+				const Entry& entry = entries.at(std::prev(iter)->second);
+				// Only a frame known to be shown at time, not one before a gap in the cached run.
+				if (fabs(entry.pts - time) < ptsTolerance || (entry.hasNext && entry.nextPts > time))
+				{
+					frame = entry.frame;
+				}
+			}
+		}
+		if (frame == nullptr)
+		{
+			missCount++;
+			return nullptr;
+		}
+		hitCount++;
+		Entry& entry = entries.at(frame);
+		retain(entry);
+		outPts = MediaTime(entry.pts, sourceTime.timeScale());
+		return frame;
+	}
+
+	bool SharedFrameCache::contains(const PixelBuffer* frame) const
+	{
+		std::lock_guard<std::mutex> lock(cacheMutex);
+		return entries.find(frame) != entries.end();
+	}
+
+	void SharedFrameCache::release(PixelBuffer* frame)
+	{
+		std::lock_guard<std::mutex> lock(cacheMutex);
+
+		auto iter = entries.find(frame);
+		assert(iter != entries.end());
+		Entry& entry = iter->second;
+		assert(entry.retainCount > 0);
+		if (--entry.retainCount > 0)
+		{
+			return;
+		}
+		if (entry.isIndexed)
+		{
+			entry.lruIterator = lru.insert(lru.end(), frame);
+			evict();
+		}
+		else
+		{
+			entry.deleter(frame);
+			entries.erase(iter);
+		}
+	}
+
+	unsigned int SharedFrameCache::getHitCount() const
+	{
+		std::lock_guard<std::mutex> lock(cacheMutex);
+		return hitCount;
+	}
+
+	unsigned int SharedFrameCache::getMissCount() const
+	{
+		std::lock_guard<std::mutex> lock(cacheMutex);
+		return missCount;
+	}
+
+	size_t SharedFrameCache::getSize() const
+	{
+		std::lock_guard<std::mutex> lock(cacheMutex);
+		return size;
+	}
+
+	PixelBuffer* SharedFrameCache::lookup(const std::string& streamKey, const double pts) const
+	{
+		auto streamIter = streams.find(streamKey);
+		if (streamIter == streams.end())
+		{
+			return nullptr;
+		}
+		auto iter = streamIter->second.lower_bound(pts - ptsTolerance);
+		if (iter == streamIter->second.end() || iter->first > pts + ptsTolerance)
+		{
+			return nullptr;
+		}
+		return iter->second;
+	}
+
+	void SharedFrameCache::retain(Entry& entry)
+	{
+		if (entry.retainCount == 0 && entry.isIndexed)
+		{
+			lru.erase(entry.lruIterator);
+		}
+		entry.retainCount++;
+	}
+
+	void SharedFrameCache::unindex(Entry& entry)
+	{
+		auto streamIter = streams.find(entry.streamKey);
+		assert(streamIter != streams.end());
+		streamIter->second.erase(entry.pts);
+		if (streamIter->second.empty())
+		{
+			streams.erase(streamIter);
+		}
+		size -= entry.bytes;
+		entry.isIndexed = false;
+	}
+
+	void SharedFrameCache::evict()
+	{
+		// Frames still held by tracks stay, the cache may then run over capacity until they are released.
+		while (size > capacity && lru.empty() == false)
+		{
+			PixelBuffer* frame = lru.front();
+			lru.pop_front();
+			Entry& entry = entries.at(frame);
+			unindex(entry);
+			entry.deleter(frame);
+			entries.erase(frame);
+		}
+	}
+
+	size_t SharedFrameCache::frameBytes(const PixelBuffer& frame, const PixelBuffer::FormatType format)
+	{
+		const size_t pixels = static_cast<size_t>(frame.getWidth()) * frame.getHeight();
+		return format == PixelBuffer::FormatType::yuv420p ? pixels * 3 / 2 : pixels * 4;
+	}
+}
@@ -0,0 +1,153 @@
+// Copyright (C) 2021 lmc
+// 
+// This file is part of VideoEditor.
+// 
+// VideoEditor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+// 
+// VideoEditor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with VideoEditor.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "SourceFrameLoader.hpp"
+#include <algorithm>
+
+namespace ks
+{
+	SourceFrameLoader::SourceFrameLoader()
+	{
+	}
+
+	SourceFrameLoader::~SourceFrameLoader()
+	{
+		cancelPrewarms();
+	}
+
+	void SourceFrameLoader::cancelPrewarms()
+	{
+		std::unique_lock<std::mutex> lock(prewarmMutex);
+		prewarmGeneration++;
+		prewarmedTime = MediaTime(-1, 600);
+		prewarmCondition.wait(lock, [this]()
+		{
+			return queuedPrewarmCount == 0;
+		});
+	}
+
+	void SourceFrameLoader::load(AsyncImageCompositionRequest& request, const VideoRenderContext& videoRenderContext, const VideoDescription* videoDescription)
+	{
+		rebalance(request);
+		if (videoDescription)
+		{
+			prewarm(request, videoRenderContext, *videoDescription);
+		}
+
+		const MediaTime compositionTime = request.compositionTime;
+		std::function<void(const int index)> loadTrack = [this, &compositionTime, &videoRenderContext](const int index)
+		{
+			TrackLoad& load = loads[index];
+			load.sourceFrame = load.imageTrack->retainSourceFrame(compositionTime, videoRenderContext);
+			if (load.sourceFrame)
+			{
+				// An image other than the source frame shares the source frame's handle.
+				const PixelBuffer* image = load.imageTrack->compositionImage(*load.sourceFrame, compositionTime, videoRenderContext);
+				if (image != load.sourceFrame.get())
+				{
+					load.sourceFrame = SourceFrameHandle(load.sourceFrame, image);
+				}
+			}
+			load.displayTime = load.imageTrack->sourceFrameDisplayTime(compositionTime);
+		};
+		WorkerPool::shared().parallelFor(static_cast<int>(loads.size()), loadTrack, videoRenderContext.decodeThreadBudget);
+
+		for (TrackLoad& load : loads)
+		{
+			request.sourceFrames[load.imageTrack->trackID] = load.sourceFrame.get();
+			request.sourceFrameDisplayTimes[load.imageTrack->trackID] = load.displayTime;
+			request.sourceFrameHandles[load.imageTrack->trackID] = std::move(load.sourceFrame);
+			load.sourceFrame = nullptr;
+		}
+	}
+
+	void SourceFrameLoader::rebalance(const AsyncImageCompositionRequest& request)
+	{
+		const std::vector<IImageTrack*>& imageTracks = request.instruction.imageTracks;
+		// Tracks are compared as well, another description may have an instruction at the same times.
+		const bool isSameInstruction = instructionTracks == imageTracks &&
+			instructionTimeRange.start == request.instruction.timeRange.start &&
+			instructionTimeRange.end == request.instruction.timeRange.end;
+		if (isSameInstruction == false)
+		{
+			instructionTimeRange = request.instruction.timeRange;
+			instructionTracks = imageTracks;
+			loads.clear();
+			for (IImageTrack* imageTrack : imageTracks)
+			{
+				TrackLoad load;
+				load.imageTrack = imageTrack;
+				loads.push_back(load);
+			}
+			// Decode cost follows the drawn area now that frames are scaled to it.
+			std::stable_sort(loads.begin(), loads.end(), [](const TrackLoad& lhs, const TrackLoad& rhs)
+			{
+				return lhs.imageTrack->rect.width * lhs.imageTrack->rect.height > rhs.imageTrack->rect.width * rhs.imageTrack->rect.height;
+			});
+		}
+	}
+
+	void SourceFrameLoader::prewarm(const AsyncImageCompositionRequest& request, const VideoRenderContext& videoRenderContext, const VideoDescription& videoDescription)
+	{
+		const MediaTime instructionEnd = request.instruction.timeRange.end;
+		std::unique_lock<std::mutex> lock(prewarmMutex);
+		if (instructionEnd == prewarmedTime || (instructionEnd - request.compositionTime).seconds() > prewarmLead)
+		{
+			return;
+		}
+		prewarmedTime = instructionEnd;
+
+		VideoInstruction nextInstruction;
+		if (videoDescription.videoInstuction(instructionEnd, nextInstruction) == false)
+		{
+			return;
+		}
+		const std::vector<IImageTrack*>& currentTracks = request.instruction.imageTracks;
+		const bool isBackground = videoRenderContext.decodeThreadBudget != 1 && WorkerPool::shared().getThreadCount() > 0;
+		for (IImageTrack* imageTrack : nextInstruction.imageTracks)
+		{
+			if (std::find(currentTracks.begin(), currentTracks.end(), imageTrack) != currentTracks.end())
+			{
+				continue;
+			}
+			if (isBackground)
+			{
+				queuedPrewarmCount++;
+				WorkerPool::shared().dispatch([this, imageTrack, videoRenderContext, generation = prewarmGeneration]()
+				{
+					{
+						std::lock_guard<std::mutex> lock(prewarmMutex);
+						if (generation != prewarmGeneration)
+						{
+							queuedPrewarmCount--;
+							prewarmCondition.notify_all();
+							return;
+						}
+					}
+					imageTrack->prewarm(videoRenderContext);
+					std::lock_guard<std::mutex> lock(prewarmMutex);
+					queuedPrewarmCount--;
+					prewarmCondition.notify_all();
+				});
+			}
+			else
+			{
+				imageTrack->prewarm(videoRenderContext);
+			}
+		}
+	}
+}
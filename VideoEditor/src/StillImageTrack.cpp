@@ -0,0 +1,216 @@
+// Copyright (C) 2021 lmc
+// 
+// This file is part of VideoEditor.
+// 
+// VideoEditor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+// 
+// VideoEditor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with VideoEditor.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "StillImageTrack.hpp"
+#include <assert.h>
+#include <math.h>
+#include <algorithm>
+#include <spdlog/spdlog.h>
+
+namespace ks
+{
+	StillImageTrack::StillImageTrack()
+	{
+	}
+
+	StillImageTrack::~StillImageTrack()
+	{
+		if (image)
+		{
+			delete image;
+		}
+	}
+
+	const PixelBuffer * StillImageTrack::sourceFrame(const MediaTime & compositionTime, const VideoRenderContext & renderContext)
+	{
+		std::lock_guard<std::mutex> lock(imageMutex);
+
+		if (image == nullptr)
+		{
+			return nullptr;
+		}
+		const int width = std::max(static_cast<int>(lround(rect.width * renderContext.renderScale)), 1);
+		const int height = std::max(static_cast<int>(lround(rect.height * renderContext.renderScale)), 1);
+		return scaledImage(width, height, compositionImageFormat(renderContext))->pixelBuffer;
+	}
+
+	SourceFrameHandle StillImageTrack::retainSourceFrame(const MediaTime & compositionTime, const VideoRenderContext & renderContext)
+	{
+		std::lock_guard<std::mutex> lock(imageMutex);
+
+		if (image == nullptr)
+		{
+			return nullptr;
+		}
+		const int width = std::max(static_cast<int>(lround(rect.width * renderContext.renderScale)), 1);
+		const int height = std::max(static_cast<int>(lround(rect.height * renderContext.renderScale)), 1);
+		const std::shared_ptr<ScaledImage> scaled = scaledImage(width, height, compositionImageFormat(renderContext));
+		return SourceFrameHandle(scaled, scaled->pixelBuffer);
+	}
+
+	MediaTime StillImageTrack::sourceFrameDisplayTime(const MediaTime & compositionTime)
+	{
+		return timeMapping.target.start;
+	}
+
+	const PixelBuffer * StillImageTrack::compositionImage(const PixelBuffer & sourceFrame, const MediaTime & compositionTime, const VideoRenderContext & renderContext)
+	{
+		return &sourceFrame;
+	}
+
+	PixelBuffer::FormatType StillImageTrack::compositionImageFormat(const VideoRenderContext & renderContext) const
+	{
+		return isImageOpaque ? renderContext.format : PixelBuffer::FormatType::rgba8;
+	}
+
+	bool StillImageTrack::isOpaque() const
+	{
+		return isImageOpaque;
+	}
+
+	void StillImageTrack::prepare(const VideoRenderContext & renderContext)
+	{
+		std::lock_guard<std::mutex> lock(imageMutex);
+
+		if (image == nullptr)
+		{
+			load(renderContext);
+		}
+	}
+
+	void StillImageTrack::onSeeking(const MediaTime & compositionTime)
+	{
+	}
+
+	void StillImageTrack::flush(const MediaTime & compositionTime)
+	{
+	}
+
+	void StillImageTrack::flush()
+	{
+	}
+
+	void StillImageTrack::load(const VideoRenderContext & renderContext)
+	{
+		// The decoder only lives for the single frame of the image.
+		std::unique_ptr<VideoDecoder> decoder = std::unique_ptr<VideoDecoder>(VideoDecoder::New(filePath, PixelBuffer::FormatType::rgba8));
+		if (decoder == nullptr)
+		{
+			spdlog::error("can not open image {}", filePath);
+			return;
+		}
+		MediaTime pts;
+		image = decoder->newFrame(pts);
+		if (image == nullptr)
+		{
+			spdlog::error("can not decode image {}", filePath);
+			return;
+		}
+
+		const PixelPlane plane = PixelKernels::plane(*image, PixelBuffer::FormatType::rgba8, 0);
+		isImageOpaque = true;
+		for (int y = 0; y < plane.height && isImageOpaque; y++)
+		{
+			const unsigned char* row = plane.data + y * plane.bytesPerRow;
+			for (int x = 0; x < plane.width; x++)
+			{
+				if (row[x * 4 + 3] != 255)
+				{
+					isImageOpaque = false;
+					break;
+				}
+			}
+		}
+
+		std::unique_ptr<ScaledImage> level = std::make_unique<ScaledImage>();
+		level->width = plane.width;
+		level->height = plane.height;
+		level->pixelBuffer = image;
+		mipLevels.push_back(std::move(level));
+	}
+
+	const StillImageTrack::ScaledImage * StillImageTrack::mipLevel(const int width, const int height)
+	{
+		// The smallest level still at least as large as the target, so the final bilinear pass never skips source pixels.
+		while (mipLevels.back()->width / 2 >= width && mipLevels.back()->height / 2 >= height)
+		{
+			const ScaledImage& source = *mipLevels.back();
+			std::unique_ptr<ScaledImage> level = makeScaledImage(source.width / 2, source.height / 2, PixelBuffer::FormatType::rgba8);
+			PixelKernels::downsamplePlane2x(PixelKernels::plane(*source.pixelBuffer, PixelBuffer::FormatType::rgba8, 0),
+				PixelKernels::plane(*level->pixelBuffer, PixelBuffer::FormatType::rgba8, 0));
+			mipLevels.push_back(std::move(level));
+		}
+		for (const std::unique_ptr<ScaledImage>& level : mipLevels)
+		{
+			if (level->width / 2 < width || level->height / 2 < height)
+			{
+				return level.get();
+			}
+		}
+		return mipLevels.back().get();
+	}
+
+	std::shared_ptr<StillImageTrack::ScaledImage> StillImageTrack::scaledImage(const int width, const int height, const PixelBuffer::FormatType format)
+	{
+		for (const std::shared_ptr<ScaledImage>& scaled : scaledImages)
+		{
+			if (scaled->width == width && scaled->height == height && scaled->format == format)
+			{
+				return scaled;
+			}
+		}
+
+		const ScaledImage* level = mipLevel(width, height);
+		const PixelPlane source = PixelKernels::plane(*level->pixelBuffer, PixelBuffer::FormatType::rgba8, 0);
+		PixelRect targetRect;
+		targetRect.width = width;
+		targetRect.height = height;
+
+		std::unique_ptr<ScaledImage> rgbaImage = makeScaledImage(width, height, PixelBuffer::FormatType::rgba8);
+		PixelKernels::scalePlane(source, PixelKernels::plane(*rgbaImage->pixelBuffer, PixelBuffer::FormatType::rgba8, 0), targetRect, 0, height);
+
+		std::unique_ptr<ScaledImage> scaled;
+		if (format == PixelBuffer::FormatType::rgba8)
+		{
+			scaled = std::move(rgbaImage);
+		}
+		else
+		{
+			scaled = makeScaledImage(width, height, format);
+			PixelKernels::convertRGBA8ToYUV420P(*rgbaImage->pixelBuffer, *scaled->pixelBuffer, width, height, 0, height);
+		}
+
+		// Player and export usually differ in render scale, a few sizes are enough.
+		if (scaledImages.size() >= scaledImageCapacity)
+		{
+			scaledImages.erase(scaledImages.begin());
+		}
+		scaledImages.push_back(std::move(scaled));
+		return scaledImages.back();
+	}
+
+	std::unique_ptr<StillImageTrack::ScaledImage> StillImageTrack::makeScaledImage(const int width, const int height, const PixelBuffer::FormatType format)
+	{
+		std::unique_ptr<ScaledImage> scaled = std::make_unique<ScaledImage>();
+		scaled->width = std::max(width, 1);
+		scaled->height = std::max(height, 1);
+		scaled->format = format;
+		scaled->pixelBufferPool = std::make_unique<PixelBufferPool>(scaled->width, scaled->height, 1, format);
+		scaled->pixelBuffer = scaled->pixelBufferPool->pixelBuffer();
+		return scaled;
+	}
+}
@@ -0,0 +1,210 @@
+// Copyright (C) 2021 lmc
+// 
+// This file is part of VideoEditor.
+// 
+// VideoEditor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+// 
+// VideoEditor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with VideoEditor.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "TextTrack.hpp"
+#include <assert.h>
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+#include <sstream>
+
+namespace ks
+{
+	TextTrack::TextTrack()
+	{
+	}
+
+	TextTrack::~TextTrack()
+	{
+	}
+
+	const PixelBuffer * TextTrack::sourceFrame(const MediaTime & compositionTime, const VideoRenderContext & renderContext)
+	{
+		std::lock_guard<std::mutex> lock(textMutex);
+
+		if (textImage == nullptr)
+		{
+			render(renderContext);
+		}
+		return textImage;
+	}
+
+	SourceFrameHandle TextTrack::retainSourceFrame(const MediaTime & compositionTime, const VideoRenderContext & renderContext)
+	{
+		std::lock_guard<std::mutex> lock(textMutex);
+
+		if (textImage == nullptr)
+		{
+			render(renderContext);
+		}
+		return SourceFrameHandle(pixelBufferPool, textImage);
+	}
+
+	MediaTime TextTrack::sourceFrameDisplayTime(const MediaTime & compositionTime)
+	{
+		// The image never changes, so every composition time shows the same frame.
+		return timeMapping.target.start;
+	}
+
+	const PixelBuffer * TextTrack::compositionImage(const PixelBuffer & sourceFrame, const MediaTime & compositionTime, const VideoRenderContext & renderContext)
+	{
+		return &sourceFrame;
+	}
+
+	PixelBuffer::FormatType TextTrack::compositionImageFormat(const VideoRenderContext & renderContext) const
+	{
+		return PixelBuffer::FormatType::rgba8;
+	}
+
+	void TextTrack::prepare(const VideoRenderContext & renderContext)
+	{
+		std::lock_guard<std::mutex> lock(textMutex);
+
+		const int width = std::max(static_cast<int>(lround(rect.width * renderContext.renderScale)), 1);
+		const int height = std::max(static_cast<int>(lround(rect.height * renderContext.renderScale)), 1);
+		const int glyphSize = std::max(static_cast<int>(lround(fontSize * renderContext.renderScale)), 1);
+		if (width != imageWidth || height != imageHeight || atlas == nullptr || atlas->getGlyphSize() != glyphSize)
+		{
+			textImage = nullptr;
+		}
+	}
+
+	void TextTrack::onSeeking(const MediaTime & compositionTime)
+	{
+	}
+
+	void TextTrack::flush(const MediaTime & compositionTime)
+	{
+	}
+
+	void TextTrack::flush()
+	{
+	}
+
+	std::vector<TextTrack::GlyphRun> TextTrack::layout(const int width, const int glyphSize) const
+	{
+		// Monospaced, wrapped at spaces, one run per line.
+		const int lineHeight = glyphSize * 5 / 4;
+		const int maxCharacters = std::max(width / glyphSize, 1);
+		std::vector<std::string> lines;
+
+		std::istringstream paragraphs(text);
+		std::string paragraph;
+		while (std::getline(paragraphs, paragraph))
+		{
+			std::istringstream words(paragraph);
+			std::string word;
+			std::string line;
+			while (words >> word)
+			{
+				if (line.empty() == false && line.size() + 1 + word.size() > static_cast<size_t>(maxCharacters))
+				{
+					lines.push_back(line);
+					line.clear();
+				}
+				line += line.empty() ? word : " " + word;
+			}
+			lines.push_back(line);
+		}
+
+		std::vector<GlyphRun> runs;
+		for (size_t i = 0; i < lines.size(); i++)
+		{
+			GlyphRun run;
+			run.characters = lines[i];
+			run.y = static_cast<int>(i) * lineHeight;
+			const int runWidth = static_cast<int>(run.characters.size()) * glyphSize;
+			switch (alignment)
+			{
+			case Alignment::left:
+				run.x = 0;
+				break;
+			case Alignment::center:
+				run.x = (width - runWidth) / 2;
+				break;
+			case Alignment::right:
+				run.x = width - runWidth;
+				break;
+			}
+			runs.push_back(run);
+		}
+		return runs;
+	}
+
+	void TextTrack::render(const VideoRenderContext & renderContext)
+	{
+		imageWidth = std::max(static_cast<int>(lround(rect.width * renderContext.renderScale)), 1);
+		imageHeight = std::max(static_cast<int>(lround(rect.height * renderContext.renderScale)), 1);
+		const int glyphSize = std::max(static_cast<int>(lround(fontSize * renderContext.renderScale)), 1);
+
+		if (atlas == nullptr || atlas->getGlyphSize() != glyphSize)
+		{
+			atlas = GlyphAtlas::shared(glyphSize);
+		}
+		pixelBufferPool = std::make_shared<PixelBufferPool>(imageWidth, imageHeight, 1, PixelBuffer::FormatType::rgba8);
+		textImage = pixelBufferPool->pixelBuffer();
+
+		const PixelPlane plane = PixelKernels::plane(*textImage, PixelBuffer::FormatType::rgba8, 0);
+		unsigned int background = 0;
+		memcpy(&background, backgroundColor.data(), sizeof(background));
+		for (int y = 0; y < plane.height; y++)
+		{
+			unsigned int* row = reinterpret_cast<unsigned int*>(plane.data + y * plane.bytesPerRow);
+			std::fill(row, row + plane.width, background);
+		}
+
+		for (const GlyphRun& run : layout(imageWidth, glyphSize))
+		{
+			blitRun(run, plane);
+		}
+	}
+
+	void TextTrack::blitRun(const GlyphRun & run, const PixelPlane & plane) const
+	{
+		const int glyphSize = atlas->getGlyphSize();
+		for (int y = std::max(-run.y, 0); y < glyphSize && run.y + y < plane.height; y++)
+		{
+			unsigned char* row = plane.data + (run.y + y) * plane.bytesPerRow;
+			for (size_t i = 0; i < run.characters.size(); i++)
+			{
+				const unsigned char* coverage = atlas->glyphRow(run.characters[i], y);
+				const int left = run.x + static_cast<int>(i) * glyphSize;
+				if (coverage == nullptr || left >= plane.width || left + glyphSize <= 0)
+				{
+					continue;
+				}
+				for (int x = std::max(-left, 0); x < glyphSize && left + x < plane.width; x++)
+				{
+					const int alpha = (coverage[x] * color[3] + 127) / 255;
+					if (alpha == 0)
+					{
+						continue;
+					}
+					// Straight alpha over the background, which may itself be translucent.
+					unsigned char* out = row + (left + x) * 4;
+					const int backgroundAlpha = (out[3] * (255 - alpha) + 127) / 255;
+					const int outAlpha = alpha + backgroundAlpha;
+					for (int c = 0; c < 3; c++)
+					{
+						out[c] = static_cast<unsigned char>((color[c] * alpha + out[c] * backgroundAlpha + outAlpha / 2) / outAlpha);
+					}
+					out[3] = static_cast<unsigned char>(outAlpha);
+				}
+			}
+		}
+	}
+}
@@ -18,6 +18,8 @@
 #include "VideoDescription.hpp"
 #include <algorithm>
 #include <unordered_map>
+#include <unordered_set>
+#include <spdlog/spdlog.h>
 
 namespace ks
 {
@@ -55,6 +57,10 @@ namespace ks
 
 		removeAllVideoInstuctions();
 
+		// A track spanning several instructions is prepared once.
+		std::unordered_set<IImageTrack*> preparedImageTracks;
+		std::unordered_set<FAudioTrack*> preparedAudioTracks;
+
 		for (MediaTimeRange timeRange : instructionTimeRanges)
 		{
 			VideoInstruction videoInstruction;
@@ -64,20 +70,34 @@ namespace ks
 			{
 				if (imageTrack->timeMapping.target.intersection(timeRange).isEmpty() == false)
 				{
-					imageTrack->prepare(renderContext.videoRenderContext);
+					if (preparedImageTracks.insert(imageTrack).second)
+					{
+						imageTrack->prepare(renderContext.videoRenderContext);
+					}
 					videoInstruction.imageTracks.push_back(imageTrack);
 				}
 			}
 
+			// imageTracks keeps the project order, transitions refer to tracks by their index in it.
+			std::stable_sort(videoInstruction.imageTracks.begin(), videoInstruction.imageTracks.end(), [](const IImageTrack* lhs, const IImageTrack* rhs)
+			{
+				return lhs->layer < rhs->layer;
+			});
+
 			for (FAudioTrack *audioTrack : audioTracks)
 			{
 				if (audioTrack->timeMapping.target.intersection(timeRange).isEmpty() == false)
 				{
-					audioTrack->prepare(renderContext.audioRenderContext);
+					if (preparedAudioTracks.insert(audioTrack).second)
+					{
+						audioTrack->prepare(renderContext.audioRenderContext);
+					}
 					videoInstruction.audioTracks.push_back(audioTrack);
 				}
 			}
 
+			videoInstruction.transitions = instructionTransitions(videoInstruction);
+
 			_duration = std::max(timeRange.end, _duration);
 			videoInstructions.push_back(videoInstruction);
 		}
@@ -145,6 +165,43 @@ namespace ks
 		return _duration;
 	}
 
+	std::vector<VideoInstructionTransition> VideoDescription::instructionTransitions(const VideoInstruction & videoInstruction) const
+	{
+		std::vector<VideoInstructionTransition> instructionTransitions;
+		for (const VideoTransition& transition : transitions)
+		{
+			if (transition.fromTrackIndex >= imageTracks.size() || transition.toTrackIndex >= imageTracks.size())
+			{
+				spdlog::warn("transition between missing tracks {} and {}", transition.fromTrackIndex, transition.toTrackIndex);
+				continue;
+			}
+			IImageTrack *fromTrack = imageTracks[transition.fromTrackIndex];
+			IImageTrack *toTrack = imageTracks[transition.toTrackIndex];
+			const auto& tracks = videoInstruction.imageTracks;
+			if (std::find(tracks.begin(), tracks.end(), fromTrack) == tracks.end() ||
+				std::find(tracks.begin(), tracks.end(), toTrack) == tracks.end())
+			{
+				continue;
+			}
+			// Both frames are blended in one place, tracks drawn at different rects just stack.
+			if (fromTrack->rect.x != toTrack->rect.x || fromTrack->rect.y != toTrack->rect.y ||
+				fromTrack->rect.width != toTrack->rect.width || fromTrack->rect.height != toTrack->rect.height)
+			{
+				spdlog::warn("transition between tracks {} and {} with different rects is ignored", transition.fromTrackIndex, transition.toTrackIndex);
+				continue;
+			}
+
+			VideoInstructionTransition instructionTransition;
+			instructionTransition.type = transition.type;
+			instructionTransition.fromTrack = fromTrack;
+			instructionTransition.toTrack = toTrack;
+			// The overlap of both tracks, usually the instruction itself unless another track splits it.
+			instructionTransition.timeRange = fromTrack->timeMapping.target.intersection(toTrack->timeMapping.target);
+			instructionTransitions.push_back(instructionTransition);
+		}
+		return instructionTransitions;
+	}
+
 	void VideoDescription::removeAllVideoInstuctions()
 	{
 		videoInstructions.clear();
@@ -15,11 +15,13 @@
 // You should have received a copy of the GNU General Public License
 // along with VideoEditor.  If not, see <http://www.gnu.org/licenses/>.
 
+#include <algorithm>
 #include "VideoProject.hpp"
 #include <fstream>
 #include <iostream>
 #include <assert.h>
 #include <unordered_map>
+#include <spdlog/spdlog.h>
 #include "Util.hpp"
 
 namespace ks
@@ -38,8 +40,56 @@ namespace ks
 		const Json video_tracks = j3.at("video_tracks");
 		const Json audio_tracks = j3.at("audio_tracks");
 
+		if (j3.contains("media_input"))
+		{
+			loadMediaInputOptions(j3.at("media_input"));
+		}
+		const size_t frameCacheMegabytes = j3.contains("frame_cache_mb") ? j3.at("frame_cache_mb").get<size_t>() : 256;
+		if (frameCacheMegabytes > 0)
+		{
+			frameCache = std::make_shared<SharedFrameCache>(frameCacheMegabytes * 1024 * 1024);
+		}
+		const unsigned int maxOpenDecoders = j3.contains("max_open_decoders") ? j3.at("max_open_decoders").get<unsigned int>() : 16;
+		if (maxOpenDecoders > 0)
+		{
+			decoderRegistry = std::make_shared<DecoderRegistry>(maxOpenDecoders);
+		}
+		// Relative to the project, the indexes are written there when the project closes.
+		if (j3.contains("media_index_dir"))
+		{
+			const std::string mediaIndexDir = j3.at("media_index_dir");
+			mediaIndexCache = std::make_shared<MediaIndexCache>(projectDir + "/" + mediaIndexDir);
+		}
 		loadVideoTracks(video_tracks);
+		if (j3.contains("image_tracks"))
+		{
+			loadStillImageTracks(j3.at("image_tracks"));
+		}
+		if (j3.contains("image_sequence_tracks"))
+		{
+			loadImageSequenceTracks(j3.at("image_sequence_tracks"));
+		}
+		if (j3.contains("raw_video_tracks"))
+		{
+			loadRawVideoTracks(j3.at("raw_video_tracks"));
+		}
+		if (j3.contains("generator_tracks"))
+		{
+			loadGeneratorTracks(j3.at("generator_tracks"));
+		}
+		if (j3.contains("text_tracks"))
+		{
+			loadTextTracks(j3.at("text_tracks"));
+		}
 		loadAudioTracks(audio_tracks);
+		if (j3.contains("transitions"))
+		{
+			loadTransitions(j3.at("transitions"));
+		}
+		if (decoderRegistry)
+		{
+			decoderRegistry->reserve(concurrentDecoderCount());
+		}
 
 		loadVideoRenderContext(video_render_context, videoDescription->renderContext.videoRenderContext);
 		loadAudioRenderContext(audio_render_context, videoDescription->renderContext.audioRenderContext);
@@ -78,6 +128,26 @@ namespace ks
 		context.renderScale = json.at("render_scale");
 		context.renderSize = FSize(width, height);
 		context.format = PixelBuffer::FormatType::rgba8;
+
+		if (json.contains("decode_threads"))
+		{
+			context.decodeThreadBudget = json.at("decode_threads");
+		}
+		if (json.contains("pixel_format"))
+		{
+			const std::unordered_map<std::string, PixelBuffer::FormatType> table = {
+				{ "rgba8", PixelBuffer::FormatType::rgba8 },
+				{ "yuv420p", PixelBuffer::FormatType::yuv420p }
+			};
+			const std::string pixel_format = json.at("pixel_format");
+			auto iter = table.find(pixel_format);
+			if (iter == table.end())
+			{
+				spdlog::error("unknown pixel_format {}, rendering in rgba8", pixel_format);
+				return false;
+			}
+			context.format = iter->second;
+		}
 		return true;
 	}
 
@@ -153,16 +223,313 @@ namespace ks
 			const Json target_time_range = videoTrackJson.at("target_time_range");
 			const Json rectJson = videoTrackJson.at("rect");
 			const Rect rect = converRect(rectJson);
-			const std::string filepath = projectDir + "/" + path;
+			const std::string filepath = mediaPath(path, true);
 			VideoTrack *videoTrack = new VideoTrack();
 			videoTrack->rect = rect;
 			videoTrack->filePath = filepath;
+			videoTrack->frameCache = frameCache;
+			videoTrack->decoderRegistry = decoderRegistry;
+			// Indexes are known by the file on disk, not the decoder URL. Remote media has no file identity.
+			if (mediaIndexCache && MediaInput::isRemote(path) == false)
+			{
+				videoTrack->mediaIndex = mediaIndexCache->index(projectDir + "/" + path);
+			}
 			videoTrack->timeMapping = MediaTimeMapping(converTimeRange(source_time_range, 600), converTimeRange(target_time_range, 600));
+			decoderTimeRanges.push_back(videoTrack->timeMapping.target);
+			if (videoTrackJson.contains("effects"))
+			{
+				loadImageEffects(videoTrackJson.at("effects"), videoTrack->effects);
+			}
+			if (videoTrackJson.contains("decode_scale"))
+			{
+				const std::unordered_map<std::string, VideoTrack::DecodeScaleQuality> qualities = {
+					{ "full", VideoTrack::DecodeScaleQuality::full },
+					{ "fast", VideoTrack::DecodeScaleQuality::fast },
+					{ "high", VideoTrack::DecodeScaleQuality::high }
+				};
+				const std::string quality = videoTrackJson.at("decode_scale");
+				assert(qualities.find(quality) != qualities.end());
+				videoTrack->decodeScaleQuality = qualities.at(quality);
+			}
+			if (videoTrackJson.contains("seek_gap"))
+			{
+				videoTrack->seekGap = videoTrackJson.at("seek_gap");
+			}
+			if (videoTrackJson.contains("decode_ahead"))
+			{
+				videoTrack->decodeAheadCount = videoTrackJson.at("decode_ahead");
+			}
+			if (videoTrackJson.contains("layer"))
+			{
+				videoTrack->layer = videoTrackJson.at("layer");
+			}
 			videoDescription->imageTracks.push_back(videoTrack);
 		}
 		return true;
 	}
 
+	bool VideoProject::loadStillImageTracks(const Json & json)
+	{
+		for (size_t i = 0; i < json.size(); i++)
+		{
+			const Json imageTrackJson = json.at(i);
+			const std::string path = imageTrackJson.at("path");
+			const MediaTimeRange targetTimeRange = converTimeRange(imageTrackJson.at("target_time_range"), 600);
+			StillImageTrack *imageTrack = new StillImageTrack();
+			imageTrack->filePath = mediaPath(path, false);
+			imageTrack->rect = converRect(imageTrackJson.at("rect"));
+			imageTrack->timeMapping = MediaTimeMapping(targetTimeRange, targetTimeRange);
+			if (imageTrackJson.contains("layer"))
+			{
+				imageTrack->layer = imageTrackJson.at("layer");
+			}
+			videoDescription->imageTracks.push_back(imageTrack);
+		}
+		return true;
+	}
+
+	bool VideoProject::loadImageSequenceTracks(const Json & json)
+	{
+		for (size_t i = 0; i < json.size(); i++)
+		{
+			const Json sequenceTrackJson = json.at(i);
+			const std::string path = sequenceTrackJson.at("path");
+			const MediaTimeRange sourceTimeRange = converTimeRange(sequenceTrackJson.at("source_time_range"), 600);
+			const MediaTimeRange targetTimeRange = converTimeRange(sequenceTrackJson.at("target_time_range"), 600);
+			ImageSequenceTrack *sequenceTrack = new ImageSequenceTrack();
+			sequenceTrack->filePattern = mediaPath(path, false);
+			sequenceTrack->rect = converRect(sequenceTrackJson.at("rect"));
+			sequenceTrack->timeMapping = MediaTimeMapping(sourceTimeRange, targetTimeRange);
+			if (sequenceTrackJson.contains("first_frame"))
+			{
+				sequenceTrack->firstFrameNumber = sequenceTrackJson.at("first_frame");
+			}
+			if (sequenceTrackJson.contains("frame_rate"))
+			{
+				sequenceTrack->frameRate = sequenceTrackJson.at("frame_rate");
+			}
+			if (sequenceTrackJson.contains("look_ahead"))
+			{
+				sequenceTrack->lookAhead = sequenceTrackJson.at("look_ahead");
+			}
+			if (sequenceTrackJson.contains("memory_capacity_mb"))
+			{
+				const size_t megabytes = sequenceTrackJson.at("memory_capacity_mb");
+				sequenceTrack->memoryCapacity = megabytes * 1024 * 1024;
+			}
+			if (sequenceTrackJson.contains("decode_threads"))
+			{
+				sequenceTrack->decodeThreadCount = sequenceTrackJson.at("decode_threads");
+			}
+			if (sequenceTrackJson.contains("layer"))
+			{
+				sequenceTrack->layer = sequenceTrackJson.at("layer");
+			}
+			videoDescription->imageTracks.push_back(sequenceTrack);
+		}
+		return true;
+	}
+
+	bool VideoProject::loadRawVideoTracks(const Json & json)
+	{
+		bool isLoaded = true;
+		for (size_t i = 0; i < json.size(); i++)
+		{
+			const Json rawTrackJson = json.at(i);
+			const std::string path = rawTrackJson.at("path");
+			const MediaTimeRange sourceTimeRange = converTimeRange(rawTrackJson.at("source_time_range"), 600);
+			const MediaTimeRange targetTimeRange = converTimeRange(rawTrackJson.at("target_time_range"), 600);
+			if (MediaInput::isRemote(path))
+			{
+				spdlog::error("raw video track {} is skipped, mapped files must be local", path);
+				isLoaded = false;
+				continue;
+			}
+			RawVideoTrack *rawTrack = new RawVideoTrack();
+			rawTrack->filePath = projectDir + "/" + path;
+			rawTrack->rect = converRect(rawTrackJson.at("rect"));
+			rawTrack->timeMapping = MediaTimeMapping(sourceTimeRange, targetTimeRange);
+			// Only needed for headerless files, y4m carries its own.
+			if (rawTrackJson.contains("width"))
+			{
+				rawTrack->rawWidth = rawTrackJson.at("width");
+				rawTrack->rawHeight = rawTrackJson.at("height");
+			}
+			if (rawTrackJson.contains("format"))
+			{
+				const std::string format = rawTrackJson.at("format");
+				assert(format == "yuv420p" || format == "rgba8");
+				rawTrack->rawFormat = format == "rgba8" ? PixelBuffer::FormatType::rgba8 : PixelBuffer::FormatType::yuv420p;
+			}
+			if (rawTrackJson.contains("frame_rate"))
+			{
+				rawTrack->rawFrameRate = rawTrackJson.at("frame_rate");
+			}
+			if (rawTrackJson.contains("read_ahead"))
+			{
+				rawTrack->readAheadCount = rawTrackJson.at("read_ahead");
+			}
+			if (rawTrackJson.contains("layer"))
+			{
+				rawTrack->layer = rawTrackJson.at("layer");
+			}
+			videoDescription->imageTracks.push_back(rawTrack);
+		}
+		return isLoaded;
+	}
+
+	bool VideoProject::loadGeneratorTracks(const Json & json)
+	{
+		const std::unordered_map<std::string, GeneratorTrack::Type> types = {
+			{ "solid", GeneratorTrack::Type::solid },
+			{ "horizontal_gradient", GeneratorTrack::Type::horizontalGradient },
+			{ "vertical_gradient", GeneratorTrack::Type::verticalGradient },
+			{ "test_pattern", GeneratorTrack::Type::testPattern }
+		};
+		for (size_t i = 0; i < json.size(); i++)
+		{
+			const Json generatorTrackJson = json.at(i);
+			const std::string type = generatorTrackJson.at("type");
+			assert(types.find(type) != types.end());
+			const MediaTimeRange targetTimeRange = converTimeRange(generatorTrackJson.at("target_time_range"), 600);
+			GeneratorTrack *generatorTrack = new GeneratorTrack();
+			generatorTrack->type = types.at(type);
+			generatorTrack->rect = converRect(generatorTrackJson.at("rect"));
+			generatorTrack->timeMapping = MediaTimeMapping(targetTimeRange, targetTimeRange);
+			if (generatorTrackJson.contains("colors"))
+			{
+				const Json colorsJson = generatorTrackJson.at("colors");
+				for (size_t j = 0; j < std::min(colorsJson.size(), static_cast<size_t>(2)); j++)
+				{
+					generatorTrack->colors[j] = converColor(colorsJson.at(j));
+				}
+			}
+			if (generatorTrackJson.contains("layer"))
+			{
+				generatorTrack->layer = generatorTrackJson.at("layer");
+			}
+			videoDescription->imageTracks.push_back(generatorTrack);
+		}
+		return true;
+	}
+
+	bool VideoProject::loadTextTracks(const Json & json)
+	{
+		const std::unordered_map<std::string, TextTrack::Alignment> alignments = {
+			{ "left", TextTrack::Alignment::left },
+			{ "center", TextTrack::Alignment::center },
+			{ "right", TextTrack::Alignment::right }
+		};
+		for (size_t i = 0; i < json.size(); i++)
+		{
+			const Json textTrackJson = json.at(i);
+			const std::string text = textTrackJson.at("text");
+			const Json target_time_range = textTrackJson.at("target_time_range");
+			const MediaTimeRange targetTimeRange = converTimeRange(target_time_range, 600);
+			TextTrack *textTrack = new TextTrack();
+			textTrack->text = text;
+			textTrack->rect = converRect(textTrackJson.at("rect"));
+			// Text has no source media, its source time is its target time.
+			textTrack->timeMapping = MediaTimeMapping(targetTimeRange, targetTimeRange);
+			textTrack->fontSize = textTrackJson.value("font_size", textTrack->fontSize);
+			if (textTrackJson.contains("color"))
+			{
+				textTrack->color = converColor(textTrackJson.at("color"));
+			}
+			if (textTrackJson.contains("background_color"))
+			{
+				textTrack->backgroundColor = converColor(textTrackJson.at("background_color"));
+			}
+			if (textTrackJson.contains("alignment"))
+			{
+				const std::string alignment = textTrackJson.at("alignment");
+				assert(alignments.find(alignment) != alignments.end());
+				textTrack->alignment = alignments.at(alignment);
+			}
+			if (textTrackJson.contains("layer"))
+			{
+				textTrack->layer = textTrackJson.at("layer");
+			}
+			videoDescription->imageTracks.push_back(textTrack);
+		}
+		return true;
+	}
+
+	bool VideoProject::loadImageEffects(const Json & json, ImageEffectChain & effects)
+	{
+		for (size_t i = 0; i < json.size(); i++)
+		{
+			const Json effectJson = json.at(i);
+			const std::string type = effectJson.at("type");
+			if (type == "lut3d")
+			{
+				const std::string path = effectJson.at("path");
+				LUT3DEffect* effect = LUT3DEffect::New(projectDir + "/" + path);
+				if (effect == nullptr)
+				{
+					// LUT3DEffect::New logged why, the track is drawn without it.
+					spdlog::warn("skipping lut3d effect {}", path);
+					continue;
+				}
+				effects.append(std::shared_ptr<IImageEffect>(effect));
+			}
+			else if (type == "color_matrix")
+			{
+				const Json matrixJson = effectJson.at("matrix");
+				assert(matrixJson.size() == 12);
+				std::array<float, 12> matrix;
+				for (size_t j = 0; j < matrix.size(); j++)
+				{
+					matrix[j] = matrixJson.at(j);
+				}
+				effects.append(std::make_shared<ColorMatrixEffect>(matrix));
+			}
+			else if (type == "brightness_contrast")
+			{
+				const float brightness = effectJson.value("brightness", 0.0f);
+				const float contrast = effectJson.value("contrast", 1.0f);
+				effects.append(std::make_shared<BrightnessContrastEffect>(brightness, contrast));
+			}
+			else if (type == "box_blur")
+			{
+				const int radius = effectJson.at("radius");
+				effects.append(std::make_shared<BoxBlurEffect>(radius));
+			}
+			else if (type == "gaussian_blur")
+			{
+				const float sigma = effectJson.at("sigma");
+				effects.append(std::make_shared<GaussianBlurEffect>(sigma));
+			}
+			else
+			{
+				assert(false);
+				return false;
+			}
+		}
+		return true;
+	}
+
+	bool VideoProject::loadTransitions(const Json & json)
+	{
+		const std::unordered_map<std::string, VideoTransitionType> types = {
+			{ "cross_dissolve", VideoTransitionType::crossDissolve },
+			{ "dip_to_black", VideoTransitionType::dipToBlack },
+			{ "wipe", VideoTransitionType::wipe }
+		};
+		for (size_t i = 0; i < json.size(); i++)
+		{
+			const Json transitionJson = json.at(i);
+			const std::string type = transitionJson.at("type");
+			assert(types.find(type) != types.end());
+			VideoTransition transition;
+			transition.type = types.at(type);
+			transition.fromTrackIndex = transitionJson.at("from");
+			transition.toTrackIndex = transitionJson.at("to");
+			videoDescription->transitions.push_back(transition);
+		}
+		return true;
+	}
+
 	bool VideoProject::loadAudioTracks(const Json & json)
 	{
 		for (size_t i = 0; i < json.size(); i++)
@@ -171,15 +538,62 @@ namespace ks
 			const std::string path = videoTrackJson.at("path");
 			const Json source_time_range = videoTrackJson.at("source_time_range");
 			const Json target_time_range = videoTrackJson.at("target_time_range");
-			const std::string filepath = projectDir + "/" + path;
+			const std::string filepath = mediaPath(path, true);
 			FAudioTrack *audioTrack = new FAudioTrack();
 			audioTrack->filePath = filepath;
+			audioTrack->decoderRegistry = decoderRegistry;
 			audioTrack->timeMapping = MediaTimeMapping(converTimeRange(source_time_range, 44100), converTimeRange(target_time_range, 44100));
+			decoderTimeRanges.push_back(audioTrack->timeMapping.target);
 			videoDescription->audioTracks.push_back(audioTrack);
 		}
 		return true;
 	}
 
+	unsigned int VideoProject::concurrentDecoderCount() const
+	{
+		// The decoders of an instruction are open together with those of the next one, which is prewarmed before it starts.
+		// Instructions over the decoding tracks alone are coarser than the project's, two of them cover any two of those.
+		const std::vector<MediaTimeRange> instructionTimeRanges = VideoDescription::instructionTimeRanges(decoderTimeRanges);
+		unsigned int maxCount = 0;
+		for (size_t i = 0; i < instructionTimeRanges.size(); i++)
+		{
+			const MediaTime end = i + 1 < instructionTimeRanges.size() ? instructionTimeRanges[i + 1].end : instructionTimeRanges[i].end;
+			const MediaTimeRange timeRange(instructionTimeRanges[i].start, end);
+			unsigned int count = 0;
+			for (const MediaTimeRange& decoderTimeRange : decoderTimeRanges)
+			{
+				if (decoderTimeRange.intersection(timeRange).isEmpty() == false)
+				{
+					count++;
+				}
+			}
+			maxCount = std::max(maxCount, count);
+		}
+		return maxCount;
+	}
+
+	bool VideoProject::loadMediaInputOptions(const Json & json)
+	{
+		if (json.contains("cache"))
+		{
+			mediaInputOptions.isCached = json.at("cache");
+		}
+		if (json.contains("read_ahead"))
+		{
+			mediaInputOptions.isReadAhead = json.at("read_ahead");
+		}
+		if (json.contains("local_read_ahead"))
+		{
+			mediaInputOptions.isLocalReadAhead = json.at("local_read_ahead");
+		}
+		return true;
+	}
+
+	std::string VideoProject::mediaPath(const std::string & path, const bool isStream) const
+	{
+		return MediaInput::decoderURL(projectDir, path, mediaInputOptions, isStream);
+	}
+
 	MediaTimeRange VideoProject::converTimeRange(const Json & json, int timeScale)
 	{
 		assert(json.at("start").is_null() == false);
@@ -202,6 +616,19 @@ namespace ks
 		return Rect(x, y, width, height);
 	}
 
+	std::array<unsigned char, 4> VideoProject::converColor(const Json & json)
+	{
+		// [r, g, b] or [r, g, b, a], 0 to 255.
+		assert(json.size() == 3 || json.size() == 4);
+		std::array<unsigned char, 4> color = { 0, 0, 0, 255 };
+		for (size_t i = 0; i < json.size(); i++)
+		{
+			const int value = json.at(i);
+			color[i] = static_cast<unsigned char>(std::min(std::max(value, 0), 255));
+		}
+		return color;
+	}
+
 	const VideoDescription *VideoProject::getVideoDescription() const
 	{
 		return videoDescription;
@@ -17,6 +17,9 @@
 
 #include "VideoTrack.hpp"
 #include <algorithm>
+#include <functional>
+#include <string>
+#include <spdlog/spdlog.h>
 #include "Util.hpp"
 
 namespace ks
@@ -27,106 +30,726 @@ namespace ks
 
 	VideoTrack::~VideoTrack()
 	{
+		{
+			// A queued decode-ahead task still points at the track, it returns at once now.
+			std::unique_lock<std::mutex> lock(decoderMutex);
+			isStopping = true;
+			decodeAheadCondition.wait(lock, [this]()
+			{
+				return isDecodingAhead == false;
+			});
+		}
+		dropFrame(pendingFrame);
+		if (decoderRegistry)
+		{
+			decoderRegistry->closed(this);
+		}
 		if (decoder)
 		{
 			delete decoder;
 		}
 		flush();
+		for (PixelBuffer* frame : detachedFrames)
+		{
+			deleteFrame(frame);
+		}
 	}
 
 	const PixelBuffer *VideoTrack::sourceFrame(const MediaTime & compositionTime, const VideoRenderContext & renderContext)
 	{
 		std::lock_guard<std::mutex> lock(decoderMutex);
+		return currentFrame(compositionTime, renderContext);
+	}
 
+	SourceFrameHandle VideoTrack::retainSourceFrame(const MediaTime & compositionTime, const VideoRenderContext & renderContext)
+	{
+		std::lock_guard<std::mutex> lock(decoderMutex);
 
-		if (decoder == nullptr)
+		const PixelBuffer* frame = currentFrame(compositionTime, renderContext);
+		if (frame == nullptr)
 		{
 			return nullptr;
 		}
+		retainCounts[frame]++;
+		return SourceFrameHandle(frame, [this](const PixelBuffer* retainedFrame)
+		{
+			std::lock_guard<std::mutex> lock(decoderMutex);
+			releaseRetainedFrame(retainedFrame);
+		});
+	}
 
-		std::function<bool()> decodeNextFrame = [this]()
+	const PixelBuffer * VideoTrack::currentFrame(const MediaTime & compositionTime, const VideoRenderContext & renderContext)
+	{
+		if (isPrepared == false)
 		{
-			MediaTime pts;
-			PixelBuffer* pixelBuffer = decoder->newFrame(pts);
-			if (pixelBuffer)
+			return nullptr;
+		}
+
+		updateFrameSize(renderContext);
+		// A lookup once the worker is ahead, it is only decoded here after a seek or when the worker fell behind.
+		decodeUntil(compositionTime);
+		scheduleDecodeAhead(compositionTime);
+
+		const int index = frameIndex(compositionTime);
+		if (index < 0)
+		{
+			lastSourceFrameDisplayTime = compositionTime;
+			return nullptr;
+		}
+		else
+		{
+			const SourceFrame& frame = videoFrames[index];
+			lastSourceFrameDisplayTime = frame.displayTime;
+			return frame.sourceFrame;
+		}
+	}
+
+	bool VideoTrack::decodeNextFrame()
+	{
+		while (true)
+		{
+			PendingFrame frame;
+			if (readNextFrame(frame) == false)
 			{
-				SourceFrame sourceFrame;
-				sourceFrame.displayTime = getTargetTime(timeMapping, pts);
-				sourceFrame.sourceFrame = pixelBuffer;
-				videoFrameQueue.push_back(sourceFrame);
+				if (pendingFrame.pixelBuffer == nullptr)
+				{
+					return false;
+				}
+				// The last frame of the stream covers whatever comes after it.
+				commitFrame(pendingFrame);
+				pendingFrame = PendingFrame();
 				return true;
 			}
-			else
+			if (pendingFrame.pixelBuffer == nullptr)
+			{
+				pendingFrame = frame;
+				continue;
+			}
+			if (frame.displayTime.seconds() <= pendingFrame.displayTime.seconds())
+			{
+				// From the keyframe before a seek target, already passed.
+				dropFrame(frame);
+				continue;
+			}
+
+			// The first frame after a seek is kept whatever the plan says, it is all a lookup has.
+			const bool isShown = videoFrames.isEmpty() || decodePlan.isShown(pendingFrame.displayTime, frame.displayTime);
+			PendingFrame previous = pendingFrame;
+			pendingFrame = frame;
+			if (isShown)
+			{
+				commitFrame(previous);
+				return true;
+			}
+			// No output time falls in its interval: not scaled, shared or queued.
+			dropFrame(previous);
+		}
+	}
+
+	bool VideoTrack::readNextFrame(PendingFrame & outFrame)
+	{
+		if (isFrameCacheShared())
+		{
+			outFrame.pixelBuffer = hasLastPts ?
+				frameCache->next(frameStreamKey(), lastPts, outFrame.pts) :
+				frameCache->find(frameStreamKey(), seekSourceTime, outFrame.pts);
+			if (outFrame.pixelBuffer)
+			{
+				outFrame.isCached = true;
+				isDecoderBehind = true;
+			}
+		}
+		if (outFrame.pixelBuffer == nullptr)
+		{
+			seekOverGap();
+			outFrame.pixelBuffer = readFrame(outFrame.pts);
+			if (outFrame.pixelBuffer == nullptr)
 			{
 				return false;
 			}
-		};
+		}
+		outFrame.displayTime = getTargetTime(timeMapping, outFrame.pts);
+		if (hasLastPts == false || outFrame.pts.seconds() > lastPts.seconds())
+		{
+			lastPts = outFrame.pts;
+		}
+		hasLastPts = true;
+		return true;
+	}
+
+	void VideoTrack::commitFrame(PendingFrame & frame)
+	{
+		PixelBuffer* pixelBuffer = frame.pixelBuffer;
+		if (frame.isCached)
+		{
+			// The decoder catches up past this frame, so what it decodes next follows it again.
+			cachedFrames.insert(pixelBuffer);
+			isRunBroken = false;
+		}
+		else
+		{
+			pixelBuffer = scaleFrame(pixelBuffer);
+			if (isFrameCacheShared())
+			{
+				shareFrame(pixelBuffer, frame.pts);
+			}
+		}
+		lastCommittedPts = frame.pts;
+		hasLastCommittedPts = true;
+
+		SourceFrame sourceFrame;
+		sourceFrame.displayTime = frame.displayTime;
+		sourceFrame.sourceFrame = pixelBuffer;
+		videoFrames.pushBack(sourceFrame);
+	}
+
+	void VideoTrack::dropFrame(PendingFrame & frame)
+	{
+		if (frame.pixelBuffer == nullptr)
+		{
+			return;
+		}
+		if (frame.isCached)
+		{
+			frameCache->release(frame.pixelBuffer);
+		}
+		else
+		{
+			delete frame.pixelBuffer;
+			isRunBroken = true;
+		}
+		frame = PendingFrame();
+	}
 
+	void VideoTrack::scheduleDecodeAhead(const MediaTime & compositionTime)
+	{
+		decodeAheadTime = compositionTime;
+		// Without threads the pool would decode inline while the caller holds decoderMutex.
+		WorkerPool& workerPool = WorkerPool::shared();
+		if (decodeAheadCount == 0 || workerPool.getThreadCount() == 0 || isDecodingAhead || decodedAheadCount() >= decodeAheadCount)
+		{
+			return;
+		}
+		isDecodingAhead = true;
+		workerPool.dispatch([this]()
+		{
+			decodeAhead();
+		});
+	}
+
+	void VideoTrack::decodeAhead()
+	{
 		while (true)
 		{
-			if (videoFrameQueue.empty())
+			std::lock_guard<std::mutex> lock(decoderMutex);
+			const bool isClipEnd = videoFrames.isEmpty() == false && videoFrames.back().displayTime >= timeMapping.target.end;
+			if (isStopping || isPrepared == false || isClipEnd || decodedAheadCount() >= decodeAheadCount || decodeNextFrame() == false)
 			{
-				if (decodeNextFrame() == false)
-				{
-					break;
-				}
+				isDecodingAhead = false;
+				decodeAheadCondition.notify_all();
+				return;
+			}
+		}
+	}
+
+	unsigned int VideoTrack::decodedAheadCount() const
+	{
+		return static_cast<unsigned int>(videoFrames.countAfter(decodeAheadTime));
+	}
+
+	void VideoTrack::seekOverGap()
+	{
+		MediaTime nextTime;
+		if (hasLastPts == false || decodePlan.nextTime(getTargetTime(timeMapping, lastPts), nextTime) == false)
+		{
+			return;
+		}
+		const MediaTime nextSourceTime = getSourceTime(timeMapping, nextTime);
+		if ((nextSourceTime - lastPts).seconds() < seekGap || isSeekBehindDecoder(nextSourceTime) || openDecoder() == false)
+		{
+			return;
+		}
+		// Frames the seek still returns from the keyframe on are dropped by the plan or as already passed.
+		seekDecoder(nextSourceTime);
+		isDecoderBehind = false;
+		isRunBroken = true;
+	}
+
+	PixelBuffer * VideoTrack::readFrame(MediaTime & pts)
+	{
+		if (openDecoder() == false)
+		{
+			return nullptr;
+		}
+		const bool isCatchingUp = isDecoderBehind;
+		if (isDecoderBehind)
+		{
+			// Frames up to lastPts came from the cache, the decoder picks up from there.
+			seekDecoder(lastPts);
+			isDecoderBehind = false;
+		}
+		while (true)
+		{
+			const auto decodeBegin = std::chrono::steady_clock::now();
+			PixelBuffer* pixelBuffer = decoder->newFrame(pts);
+			decodeLatency.record(std::chrono::steady_clock::now() - decodeBegin);
+			if (pixelBuffer && isDecoderSeekRecorded == false)
+			{
+				mediaIndex->recordSeek(decoderSeekTime, pts);
+				isDecoderSeekRecorded = true;
 			}
-			else
+			if (pixelBuffer == nullptr || isCatchingUp == false || pts.seconds() > lastPts.seconds() + 1e-6)
 			{
-				SourceFrame back = videoFrameQueue.back();
-				if (back.displayTime >= compositionTime)
+				return pixelBuffer;
+			}
+			delete pixelBuffer;
+		}
+	}
+
+	bool VideoTrack::openDecoder()
+	{
+		if (decoder)
+		{
+			if (decoderRegistry)
+			{
+				decoderRegistry->used(this);
+			}
+			return true;
+		}
+		decoder = VideoDecoder::New(filePath, frameFormat);
+		if (decoder == nullptr)
+		{
+			spdlog::error("can not open {}", filePath);
+			return false;
+		}
+		if (decoderRegistry)
+		{
+			decoderRegistry->opened(this);
+		}
+		// Continue after the last frame handed out, or start where the last seek asked for.
+		if (hasLastPts)
+		{
+			isDecoderBehind = true;
+		}
+		else
+		{
+			seekDecoder(seekSourceTime);
+		}
+		return true;
+	}
+
+	void VideoTrack::seekDecoder(const MediaTime & sourceTime)
+	{
+		decoder->seek(sourceTime);
+		decoderSeekTime = sourceTime;
+		isDecoderSeekRecorded = mediaIndex == nullptr;
+	}
+
+	bool VideoTrack::isSeekBehindDecoder(const MediaTime & sourceTime) const
+	{
+		// The decoder stands right after lastPts unless it still has to catch up with the cache.
+		if (mediaIndex == nullptr || decoder == nullptr || hasLastPts == false || isDecoderBehind ||
+			lastPts.seconds() >= sourceTime.seconds())
+		{
+			return false;
+		}
+		// Decoding on from lastPts reads fewer frames than restarting at a keyframe at or before it.
+		MediaTime keyframe;
+		return mediaIndex->keyframeBefore(sourceTime, keyframe) && keyframe.seconds() <= lastPts.seconds() + 1e-6;
+	}
+
+	bool VideoTrack::tryCloseDecoder()
+	{
+		// Closing would drop what cache: downloaded, the reopened decoder would fetch it all again.
+		if (MediaInput::isCachedURL(filePath))
+		{
+			return false;
+		}
+		std::unique_lock<std::mutex> lock(decoderMutex, std::try_to_lock);
+		if (lock.owns_lock() == false)
+		{
+			return false;
+		}
+		closeDecoder();
+		return true;
+	}
+
+	void VideoTrack::closeDecoder()
+	{
+		if (decoder)
+		{
+			delete decoder;
+			decoder = nullptr;
+		}
+		isDecoderSeekRecorded = true;
+	}
+
+	void VideoTrack::prewarm(const VideoRenderContext & renderContext)
+	{
+		std::lock_guard<std::mutex> lock(decoderMutex);
+
+		if (isPrepared == false)
+		{
+			return;
+		}
+		updateFrameSize(renderContext);
+		// The first frame of the clip, so that entering it needs no decoding.
+		decodeUntil(timeMapping.target.start);
+	}
+
+	bool VideoTrack::isFrameCacheShared() const
+	{
+		// Effects run on rgba8 copies, the decoded frames themselves are never written.
+		return frameCache != nullptr;
+	}
+
+	std::string VideoTrack::frameStreamKey() const
+	{
+		const bool isScaled = decodeScaleQuality != DecodeScaleQuality::full;
+		return SharedFrameCache::streamKey(filePath + "@" + std::to_string(static_cast<int>(decodeScaleQuality)),
+			frameFormat,
+			isScaled ? frameWidth : 0,
+			isScaled ? frameHeight : 0);
+	}
+
+	void VideoTrack::shareFrame(PixelBuffer * frame, const MediaTime & pts)
+	{
+		std::function<void(PixelBuffer*)> deleter = [](PixelBuffer* pixelBuffer)
+		{
+			delete pixelBuffer;
+		};
+		auto scaledIter = scaledFrames.find(frame);
+		if (scaledIter != scaledFrames.end())
+		{
+			// The frame belongs to its pool, which now lives as long as the cache keeps the frame.
+			std::shared_ptr<PixelBufferPool> pixelBufferPool = std::move(scaledIter->second.pixelBufferPool);
+			scaledFrames.erase(scaledIter);
+			deleter = [pixelBufferPool](PixelBuffer* pixelBuffer)
+			{
+			};
+		}
+		// Frames after a skip do not follow the previous one in decode order.
+		const bool isRunLinked = hasLastCommittedPts && isRunBroken == false;
+		isRunBroken = false;
+		frameCache->insert(frameStreamKey(), frameFormat, pts, isRunLinked ? &lastCommittedPts : nullptr, frame, deleter);
+		cachedFrames.insert(frame);
+	}
+
+	void VideoTrack::updateFrameSize(const VideoRenderContext & renderContext)
+	{
+		const PixelRect rect = PixelRect::make(this->rect, renderContext.renderScale);
+		if (rect.width != frameWidth || rect.height != frameHeight)
+		{
+			// Frames already queued keep their size, the compositor scales whatever it gets.
+			frameWidth = rect.width;
+			frameHeight = rect.height;
+		}
+	}
+
+	PixelBuffer * VideoTrack::scaleFrame(PixelBuffer * frame)
+	{
+		const int width = std::min(frameWidth, frame->getWidth());
+		const int height = std::min(frameHeight, frame->getHeight());
+		if (decodeScaleQuality == DecodeScaleQuality::full ||
+			width <= 0 || height <= 0 ||
+			(width == frame->getWidth() && height == frame->getHeight()))
+		{
+			return frame;
+		}
+		const int planeCount = PixelKernels::planeCount(frameFormat);
+
+		const PixelBuffer* source = frame;
+		if (decodeScaleQuality == DecodeScaleQuality::high)
+		{
+			// Halve while the next level is still at least the target, the bilinear pass then never skips source pixels.
+			size_t level = 0;
+			while (source->getWidth() / 2 >= width && source->getHeight() / 2 >= height)
+			{
+				const int halfWidth = source->getWidth() / 2;
+				const int halfHeight = source->getHeight() / 2;
+				if (level == halvedFrames.size())
 				{
-					break;
+					halvedFrames.push_back(makeScaledFrame(halfWidth, halfHeight));
 				}
-				else
+				else if (halvedFrames[level].width != halfWidth || halvedFrames[level].height != halfHeight)
 				{
-					if (decodeNextFrame() == false)
-					{
-						break;
-					}
+					halvedFrames[level] = makeScaledFrame(halfWidth, halfHeight);
 				}
+				for (int i = 0; i < planeCount; i++)
+				{
+					PixelKernels::downsamplePlane2x(PixelKernels::plane(*source, frameFormat, i),
+						PixelKernels::plane(*halvedFrames[level].pixelBuffer, frameFormat, i));
+				}
+				source = halvedFrames[level].pixelBuffer;
+				level++;
 			}
 		}
 
-		if (videoFrameQueue.empty())
+		if (width != scaledWidth || height != scaledHeight)
 		{
-			return nullptr;
+			scaledWidth = width;
+			scaledHeight = height;
+			spareScaledFrames.clear();
+		}
+		ScaledFrame scaled;
+		if (spareScaledFrames.empty() == false)
+		{
+			scaled = std::move(spareScaledFrames.back());
+			spareScaledFrames.pop_back();
 		}
 		else
 		{
-			SourceFrame back = videoFrameQueue.back();
-			return back.sourceFrame;
+			scaled = makeScaledFrame(width, height);
+		}
+		PixelRect rect;
+		rect.width = width;
+		rect.height = height;
+		for (int i = 0; i < planeCount; i++)
+		{
+			const PixelPlane dst = PixelKernels::plane(*scaled.pixelBuffer, frameFormat, i);
+			PixelKernels::scalePlane(PixelKernels::plane(*source, frameFormat, i), dst, i > 0 ? rect.chroma() : rect, 0, dst.height);
+		}
+		delete frame;
+
+		PixelBuffer* pixelBuffer = scaled.pixelBuffer;
+		scaledFrames[pixelBuffer] = std::move(scaled);
+		return pixelBuffer;
+	}
+
+	VideoTrack::ScaledFrame VideoTrack::makeScaledFrame(const int width, const int height) const
+	{
+		ScaledFrame scaled;
+		scaled.width = width;
+		scaled.height = height;
+		scaled.pixelBufferPool = std::make_unique<PixelBufferPool>(width, height, 1, frameFormat);
+		scaled.pixelBuffer = scaled.pixelBufferPool->pixelBuffer();
+		return scaled;
+	}
+
+	void VideoTrack::decodeUntil(const MediaTime & compositionTime)
+	{
+		// The frame covering compositionTime is known once a later frame was read.
+		while (true)
+		{
+			const bool isCovered = videoFrames.isEmpty() == false &&
+				(videoFrames.back().displayTime.seconds() >= compositionTime.seconds() ||
+				(pendingFrame.pixelBuffer && pendingFrame.displayTime.seconds() > compositionTime.seconds()));
+			if (isCovered || decodeNextFrame() == false)
+			{
+				break;
+			}
+		}
+	}
+
+	int VideoTrack::frameIndex(const MediaTime & compositionTime) const
+	{
+		// Before the first frame, e.g. right after a seek, the first one stands in.
+		if (videoFrames.isEmpty())
+		{
+			return -1;
+		}
+		return std::max(videoFrames.frameAt(compositionTime), 0);
+	}
+
+	bool VideoTrack::retainSourceFrameWindow(const MediaTime & compositionTime,
+		const unsigned int before,
+		const unsigned int after,
+		const VideoRenderContext & renderContext,
+		SourceFrameWindow & outWindow)
+	{
+		std::lock_guard<std::mutex> lock(decoderMutex);
+
+		if (isPrepared == false)
+		{
+			return false;
+		}
+		windowBeforeCount = std::max(windowBeforeCount, before);
+		updateFrameSize(renderContext);
+
+		decodeUntil(compositionTime);
+		int index = frameIndex(compositionTime);
+		if (index < 0)
+		{
+			return false;
+		}
+		// Frames after the current one continue the sequential decode, nothing is sought.
+		while (static_cast<int>(videoFrames.getCount()) - 1 - index < static_cast<int>(after))
+		{
+			if (decodeNextFrame() == false)
+			{
+				break;
+			}
+		}
+
+		const int first = std::max(index - static_cast<int>(before), 0);
+		const int last = std::min(index + static_cast<int>(after), static_cast<int>(videoFrames.getCount()) - 1);
+		outWindow.compositionTime = compositionTime;
+		outWindow.frames.clear();
+		for (int i = first; i <= last; i++)
+		{
+			outWindow.frames.push_back(videoFrames[i]);
+			retainCounts[videoFrames[i].sourceFrame]++;
 		}
+		outWindow.currentIndex = index - first;
+		return true;
+	}
+
+	void VideoTrack::releaseSourceFrameWindow(const SourceFrameWindow & window)
+	{
+		std::lock_guard<std::mutex> lock(decoderMutex);
+
+		for (const SourceFrame& frame : window.frames)
+		{
+			releaseRetainedFrame(frame.sourceFrame);
+		}
+	}
+
+	void VideoTrack::releaseRetainedFrame(const PixelBuffer * frame)
+	{
+		auto iter = retainCounts.find(frame);
+		assert(iter != retainCounts.end());
+		if (--iter->second > 0)
+		{
+			return;
+		}
+		retainCounts.erase(iter);
+
+		// Flushed while retained, the last user frees it.
+		auto detachedIter = std::find(detachedFrames.begin(), detachedFrames.end(), frame);
+		if (detachedIter != detachedFrames.end())
+		{
+			deleteFrame(*detachedIter);
+			detachedFrames.erase(detachedIter);
+		}
+	}
+
+	void VideoTrack::releaseFrame(PixelBuffer * frame)
+	{
+		if (retainCounts.find(frame) == retainCounts.end())
+		{
+			deleteFrame(frame);
+		}
+		else
+		{
+			detachedFrames.push_back(frame);
+		}
+	}
+
+	void VideoTrack::deleteFrame(PixelBuffer * frame)
+	{
+		rgbaFrames.release(frame);
+		if (cachedFrames.erase(frame) > 0)
+		{
+			frameCache->release(frame);
+			return;
+		}
+		auto iter = scaledFrames.find(frame);
+		if (iter == scaledFrames.end())
+		{
+			delete frame;
+			return;
+		}
+		if (iter->second.width == scaledWidth &&
+			iter->second.height == scaledHeight &&
+			spareScaledFrames.size() < spareScaledFrameCapacity)
+		{
+			spareScaledFrames.push_back(std::move(iter->second));
+		}
+		scaledFrames.erase(iter);
+	}
+
+	const DecodeLatencyStatistics & VideoTrack::getDecodeLatency() const
+	{
+		return decodeLatency;
+	}
+
+	MediaTime VideoTrack::sourceFrameDisplayTime(const MediaTime & compositionTime)
+	{
+		std::lock_guard<std::mutex> lock(decoderMutex);
+		return lastSourceFrameDisplayTime;
 	}
 
 	const PixelBuffer * VideoTrack::compositionImage(const PixelBuffer & sourceFrame, 
 		const MediaTime & compositionTime, 
 		const VideoRenderContext & renderContext)
 	{
-		return &sourceFrame;
+		if (effects.isEmpty())
+		{
+			return &sourceFrame;
+		}
+		std::lock_guard<std::mutex> lock(decoderMutex);
+
+		// The copy lives as long as its source frame, see deleteFrame.
+		bool isConverted = false;
+		PixelBuffer* image = rgbaFrames.rgbaFrame(sourceFrame, &isConverted);
+		if (isConverted)
+		{
+			effects.apply(*image);
+		}
+		return image;
+	}
+
+	PixelBuffer::FormatType VideoTrack::compositionImageFormat(const VideoRenderContext & renderContext) const
+	{
+		// Without effects the compositor draws the planar frame directly, converting only what it covers.
+		// Effects only run on rgba8, a yuv420p render falls back to rgba8 for this track alone.
+		return effects.isEmpty() ? frameFormat : PixelBuffer::FormatType::rgba8;
+	}
+
+	bool VideoTrack::isOpaque() const
+	{
+		// Decoded video carries no alpha and the effects keep it at 255.
+		return true;
 	}
 
 	void VideoTrack::prepare(const VideoRenderContext & renderContext)
 	{
-		if (decoder)
+		// The decoder is opened when the first frame is needed.
+		std::lock_guard<std::mutex> lock(decoderMutex);
+		if (decoder && decoderRegistry)
 		{
-			delete decoder;
+			decoderRegistry->closed(this);
 		}
-		decoder = VideoDecoder::New(filePath, renderContext.format);
-		assert(decoder);
-		flush();
-		onSeeking(timeMapping.source.start);
+		closeDecoder();
+		updateFrameSize(renderContext);
+		decodePlan = DecodePlan(timeMapping, getFrameDuration(renderContext.fps));
+		isPrepared = true;
+		seekFrames(timeMapping.source.start);
 	}
 
 	void VideoTrack::onSeeking(const MediaTime & compositionTime)
 	{
-		flush();
-		const MediaTime seekTime = getSourceTime(timeMapping, compositionTime);
 		std::lock_guard<std::mutex> lock(decoderMutex);
+		seekFrames(compositionTime);
+	}
+
+	void VideoTrack::seekFrames(const MediaTime & compositionTime)
+	{
+		// Called with decoderMutex held: the decode-ahead task commits under the same lock,
+		// so no frame from before the seek reaches the cleared queue.
+		clearFrames();
+		const MediaTime seekTime = getSourceTime(timeMapping, compositionTime);
+
+		seekSourceTime = seekTime;
+		hasLastCommittedPts = false;
+		isRunBroken = false;
+		if (pendingFrame.pixelBuffer && isSeekBehindDecoder(seekTime))
+		{
+			// The decoder reads on to seekTime. Its newest frame is kept, it may be the one shown at seekTime.
+			scheduleDecodeAhead(compositionTime);
+			return;
+		}
+		dropFrame(pendingFrame);
+		hasLastPts = false;
+		isDecoderBehind = false;
+		isRunBroken = false;
 
 		if (decoder)
 		{
-			bool seekRet = decoder->seek(seekTime);
+			seekDecoder(seekTime);
+			// The queue was flushed, the worker refills it from the new position.
+			// Tracks without a decoder are not in use and stay closed.
+			scheduleDecodeAhead(compositionTime);
 		}
 	}
 
@@ -134,29 +757,30 @@ namespace ks
 	{
 		std::lock_guard<std::mutex> lock(decoderMutex);
 
-		videoFrameQueue.erase(std::remove_if(videoFrameQueue.begin(), videoFrameQueue.end(), [&](SourceFrame videoFrame) {
-			if (videoFrame.displayTime < time)
-			{
-				delete videoFrame.sourceFrame;
-				return true;
-			}
-			else
-			{
-				return false;
+		// The frame covering time stays, it is shown again until the next one.
+		// The frames in front of it that windows asked for are kept so the next window needs no decoding.
+		size_t firstKept = static_cast<size_t>(std::max(videoFrames.frameAt(time), 0));
+		firstKept = firstKept > windowBeforeCount ? firstKept - windowBeforeCount : 0;
 
-			}
-		}),
-			videoFrameQueue.end());
+		for (size_t i = 0; i < firstKept; i++)
+		{
+			releaseFrame(videoFrames.front().sourceFrame);
+			videoFrames.popFront();
+		}
 	}
 
 	void VideoTrack::flush()
 	{
 		std::lock_guard<std::mutex> lock(decoderMutex);
+		clearFrames();
+	}
 
-		for (auto item : videoFrameQueue)
+	void VideoTrack::clearFrames()
+	{
+		while (videoFrames.isEmpty() == false)
 		{
-			delete item.sourceFrame;
+			releaseFrame(videoFrames.front().sourceFrame);
+			videoFrames.popFront();
 		}
-		videoFrameQueue.clear();
 	}
 }
\ No newline at end of file
@@ -0,0 +1,33 @@
+// Copyright (C) 2021 lmc
+// 
+// This file is part of VideoEditor.
+// 
+// VideoEditor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+// 
+// VideoEditor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with VideoEditor.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "VideoTransition.hpp"
+#include <algorithm>
+
+namespace ks
+{
+	float VideoInstructionTransition::progress(const MediaTime & time) const
+	{
+		const double duration = timeRange.duration().seconds();
+		if (duration <= 0.0)
+		{
+			return 1.0f;
+		}
+		const double progress = (time - timeRange.start).seconds() / duration;
+		return static_cast<float>(std::min(std::max(progress, 0.0), 1.0));
+	}
+}
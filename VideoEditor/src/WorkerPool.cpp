@@ -0,0 +1,154 @@
+// Copyright (C) 2021 lmc
+//
+// This file is part of VideoEditor.
+//
+// VideoEditor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// VideoEditor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with VideoEditor.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "WorkerPool.hpp"
+#include <atomic>
+#include <memory>
+#include <algorithm>
+
+namespace ks
+{
+	WorkerPool::WorkerPool(const unsigned int threadCount)
+	{
+		for (unsigned int i = 0; i < threadCount; i++)
+		{
+			threads.emplace_back([this]()
+			{
+				run();
+			});
+		}
+	}
+
+	WorkerPool::~WorkerPool()
+	{
+		{
+			std::lock_guard<std::mutex> lock(tasksMutex);
+			isStop = true;
+		}
+		tasksCondition.notify_all();
+		for (std::thread& thread : threads)
+		{
+			thread.join();
+		}
+	}
+
+	void WorkerPool::dispatch(std::function<void()> task)
+	{
+		if (threads.empty())
+		{
+			task();
+			return;
+		}
+		{
+			std::lock_guard<std::mutex> lock(tasksMutex);
+			tasks.push_back(task);
+		}
+		tasksCondition.notify_one();
+	}
+
+	void WorkerPool::parallelFor(const int count, std::function<void(const int index)> body, const unsigned int maxThreadCount)
+	{
+		if (count <= 0)
+		{
+			return;
+		}
+
+		struct Context
+		{
+			std::atomic<int> next = 0;
+			int finished = 0;
+			std::mutex mutex;
+			std::condition_variable condition;
+		};
+		std::shared_ptr<Context> context = std::make_shared<Context>();
+
+		std::function<void()> drain = [context, count, body]()
+		{
+			int done = 0;
+			for (int index = context->next++; index < count; index = context->next++)
+			{
+				body(index);
+				done++;
+			}
+			if (done > 0)
+			{
+				std::lock_guard<std::mutex> lock(context->mutex);
+				context->finished += done;
+				if (context->finished == count)
+				{
+					context->condition.notify_all();
+				}
+			}
+		};
+
+		int helperCount = std::min(static_cast<int>(threads.size()), count - 1);
+		if (maxThreadCount > 0)
+		{
+			helperCount = std::min(helperCount, static_cast<int>(maxThreadCount) - 1);
+		}
+		for (int i = 0; i < helperCount; i++)
+		{
+			dispatch(drain);
+		}
+		drain();
+
+		std::unique_lock<std::mutex> lock(context->mutex);
+		context->condition.wait(lock, [&]()
+		{
+			return context->finished == count;
+		});
+	}
+
+	unsigned int WorkerPool::getThreadCount() const
+	{
+		return static_cast<unsigned int>(threads.size());
+	}
+
+	unsigned int WorkerPool::defaultThreadCount()
+	{
+		const unsigned int concurrency = std::thread::hardware_concurrency();
+		return concurrency > 1 ? concurrency - 1 : 0;
+	}
+
+	WorkerPool& WorkerPool::shared()
+	{
+		static WorkerPool workerPool(defaultThreadCount());
+		return workerPool;
+	}
+
+	void WorkerPool::run()
+	{
+		while (true)
+		{
+			std::function<void()> task;
+			{
+				std::unique_lock<std::mutex> lock(tasksMutex);
+				tasksCondition.wait(lock, [this]()
+				{
+					return isStop || tasks.empty() == false;
+				});
+				if (isStop && tasks.empty())
+				{
+					return;
+				}
+				task = tasks.front();
+				tasks.pop_front();
+			}
+			task();
+		}
+	}
+}